@@ -0,0 +1,228 @@
+/*
+ * PiL0 - PL0 Compiler for Raspberry PI
+ * Copyright (C) 2013  Philipp Wiesner
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file arena.c Library for bump pointer allocation
+ *
+ * An arena hands out memory from large chunks by moving a pointer forward.
+ * Single objects are never freed, all memory of an arena is released at once.
+ * Resetting keeps the chunks, so an arena which is used again and again
+ * does not allocate any more once it reached its largest size.
+ *
+ * @ingroup meta_data
+ */
+
+#include"meta_data_types.h"
+#include<stddef.h>
+
+#define ARENA_ERR "Arena"
+#define ARENA_CHUNK_MIN 4096
+#define ARENA_CHUNK_MAX (4096 * 1024)
+
+/**
+ * @brief strictest alignment of basic types
+ */
+union ARENA_ALIGN {
+	long l;
+	double d;
+	void *p;
+	void (*f)(void);
+};
+
+#define ARENA_ALIGNMENT sizeof(union ARENA_ALIGN)
+#define ARENA_ROUND(n) (((n) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1))
+
+/**
+ * @struct ARENA_CHUNK
+ *
+ * @brief block of memory, objects follow the header
+ */
+struct ARENA_CHUNK {
+	struct ARENA_CHUNK *next; /**< next chunk */
+	size_t size; /**< usable bytes behind header */
+	union ARENA_ALIGN align; /**< start of usable bytes */
+};
+
+#define ARENA_HEADER offsetof(struct ARENA_CHUNK, align)
+
+/**
+ * @struct ARENA
+ *
+ * @brief list of chunks and position of next object
+ */
+struct ARENA {
+	struct ARENA_CHUNK *first; /**< first chunk */
+	struct ARENA_CHUNK *current; /**< chunk objects are taken from */
+	char *next; /**< next free byte in current chunk */
+	char *end; /**< end of current chunk */
+	size_t chunk_size; /**< usable bytes of next new chunk */
+	size_t used; /**< bytes handed out since last reset */
+	size_t peak; /**< most bytes handed out between two resets */
+	size_t reserved; /**< bytes of all chunks */
+	size_t chunks; /**< number of chunks */
+};
+
+/**
+ * @brief create new empty arena
+ *
+ * @param chunk_size usable bytes of first chunk, later chunks double up to ARENA_CHUNK_MAX
+ * @retval ARPTR new arena
+ */
+ARPTR init_arena(size_t chunk_size) {
+	ARPTR ar = NULL;
+
+	if ((ar = pl_malloc(sizeof(*ar))) == NULL)
+		ERROR_EXCEPT(ARENA_ERR, ERR_MEMORY);
+
+	ar->first = ar->current = NULL;
+	ar->next = ar->end = NULL;
+	ar->chunk_size = ARENA_ROUND(
+			(chunk_size < ARENA_CHUNK_MIN) ? ARENA_CHUNK_MIN : chunk_size);
+	ar->used = ar->peak = ar->reserved = ar->chunks = 0;
+	return ar;
+}
+
+/**
+ * @brief make current a chunk with at least size free bytes
+ *
+ * Takes the next kept chunk if it is large enough, otherwise inserts a new one.
+ *
+ * @param ar arena
+ * @param size bytes needed
+ * @retval void
+ */
+static void arena_next_chunk(ARPTR ar, size_t size) {
+	struct ARENA_CHUNK *chunk =
+			(ar->current != NULL) ? ar->current->next : ar->first;
+
+	if (chunk == NULL || chunk->size < size) {
+		size_t bytes = (size > ar->chunk_size) ? size : ar->chunk_size;
+
+		if ((chunk = pl_malloc(ARENA_HEADER + bytes)) == NULL)
+			ERROR_EXCEPT(ARENA_ERR, ERR_MEMORY);
+
+		chunk->size = bytes;
+
+		if (ar->current != NULL) {
+			chunk->next = ar->current->next;
+			ar->current->next = chunk;
+		} else {
+			chunk->next = ar->first;
+			ar->first = chunk;
+		}
+
+		ar->reserved += bytes;
+		ar->chunks++;
+
+		if (ar->chunk_size < ARENA_CHUNK_MAX)
+			ar->chunk_size *= 2;
+	}
+
+	ar->current = chunk;
+	ar->next = (char *) &chunk->align;
+	ar->end = ar->next + chunk->size;
+}
+
+/**
+ * @brief allocate memory from arena
+ *
+ * Memory is aligned for every basic type and stays valid until arena is reset or freed.
+ *
+ * @param ar arena
+ * @param size number of bytes
+ * @retval void* pointer to memory
+ */
+void *arena_alloc(ARPTR ar, size_t size) {
+	void *p;
+
+	size = ARENA_ROUND(size > 0 ? size : 1);
+
+	if ((size_t) (ar->end - ar->next) < size)
+		arena_next_chunk(ar, size);
+
+	p = ar->next;
+	ar->next += size;
+	ar->used += size;
+
+	if (ar->used > ar->peak)
+		ar->peak = ar->used;
+
+	return p;
+}
+
+/**
+ * @brief release all objects, keep chunks for reuse
+ *
+ * @param ar arena
+ * @retval void
+ */
+void arena_reset(ARPTR ar) {
+	ar->current = NULL;
+	ar->next = ar->end = NULL;
+	ar->used = 0;
+}
+
+/**
+ * @brief free arena with all chunks
+ *
+ * @param ar arena
+ * @retval void
+ */
+void free_arena(ARPTR ar) {
+	struct ARENA_CHUNK *chunk, *next;
+
+	if (ar == NULL)
+		return;
+
+	for (chunk = ar->first; chunk != NULL; chunk = next) {
+		next = chunk->next;
+		free(chunk);
+	}
+
+	free(ar);
+}
+
+/**
+ * @brief most bytes handed out between two resets
+ *
+ * @param ar arena
+ * @retval size_t
+ */
+size_t arena_used(const ARPTR ar) {
+	return ar->peak;
+}
+
+/**
+ * @brief bytes allocated for chunks
+ *
+ * @param ar arena
+ * @retval size_t
+ */
+size_t arena_reserved(const ARPTR ar) {
+	return ar->reserved;
+}
+
+/**
+ * @brief number of chunks
+ *
+ * @param ar arena
+ * @retval size_t
+ */
+size_t arena_chunks(const ARPTR ar) {
+	return ar->chunks;
+}
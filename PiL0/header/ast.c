@@ -19,248 +19,320 @@
 /**
  * @file ast.c Library which inherits all necessary functions for creating an abstract syntax tree
  *
+ * Knots of every kind are stored by value in one array per kind and refer to
+ * each other by 32 bit indices. Knots which are always created together, like
+ * the two blocks of a procedure, take neighboring indices, and expressions
+ * are stored in post order, so only one branch has to be stored. Source
+ * lines are kept apart from the knots, so a walk over the tree only touches
+ * the arrays it needs.
+ *
+ * Identifiers are kept apart as well: knots refer to a name, which holds the
+ * symbol and, once resolve() ran, the address of the declaration. Every block
+ * of the main program or a procedure opens a scope, which lists the VAR and
+ * CONST declarations of the block in slot order.
+ *
  * @defgroup ast Abstract-Syntax-Tree
  * @brief creates AST structure during parsing for evaluating of syntax.
  * @ingroup parser ast
  */
 
 #include"frontend.h"
+#include"containers.h"
 
 #define __AST_BLOCK__ "AST Block"
 #define __AST_STMT__ "AST Statement"
 #define __AST_EXPR__ "AST Expression"
 
-#ifdef PL_DEBUG
-
 /**
- * @brief debug-only: print to standard output AST addresses
+ * @struct AST_BLOCK
  *
+ * @brief Block element which can be either refer to a procedure or a statement.
  *
- * @param *desc description for which element in AST is being created
- * @param *root root element of AST knot
- * @param *branch1 first branch of AST knot
- * @param *branch2 secons branch of AST knot
- * @retval void
+ * A procedure stores its name and the block within the procedure, the block
+ * following the procedure has the next index.
  **/
-static void ast_debout(const char *desc, void *root, void *branch1,
-		void *branch2) {
-	printf("%10s->root:    %p\n", desc, root);
-	if (branch1 != NULL)
-		printf("%10s->branch1: %p\n", desc, branch1);
-	if (branch2 != NULL)
-		printf("%10s->branch2: %p\n", desc, branch2);
-}
-
-#define DEB_OUT(dummy1, dummy2, dummy3, dummy4) ast_debout(dummy1, dummy2, dummy3, dummy4)
-#endif
+struct AST_BLOCK {
+	unsigned char tag; 			/**< one of block_ids */
+	SYMBOL identifier; 			/**< procedure name */
+	unsigned int branch; 		/**< block within procedure or statement */
+};
 
 /**
- * @enum block_ids IDs to differ between block knot elements
+ * @struct AST_STMT
  *
- * For internal use only!
- */
-enum block_ids {
-	BLOCK_PROC, BLOCK_STMT
+ * @brief Statement element which represents different statement types
+ *
+ * - IF / WHILE: branch is the condition, operand the statement
+ * - assignment: branch is the expression, operand the name
+ * - list: branch is the first entry of the list array, operand the count
+ * - PRINT: branch is the expression
+ * - CALL / READ: branch is the word ID CALL or READ, operand the name
+ * - PASS: nothing, new statements are empty until they are transformed
+ **/
+struct AST_STMT {
+	unsigned char tag; 			/**< one of stmt_ids */
+	unsigned int branch; 		/**< first branch */
+	unsigned int operand; 		/**< second branch or name */
 };
 
 /**
- * @enum stmt_ids IDs to differ between statement knot elements
+ * @struct AST_EXPR
  *
- * For internal use only!
- */
-enum stmt_ids {
-	STMT_IF, STMT_WHILE, STMT_ASSIGN, STMT_SEQ, STMT_CARE, STMT_PRINT
+ * @brief Expression element which represents different expression types.
+ *
+ * Expressions are created bottom up, so a knot always comes right behind its
+ * last branch: the right side of an operator and the branch of unary and odd
+ * expressions is the knot before, only the left side has to be stored.
+ **/
+struct AST_EXPR {
+	unsigned char tag; 			/**< one of expr_ids */
+	unsigned short operator; 	/**< operator character or word ID of operator */
+	/**
+	 * @union un_operand
+	 *
+	 * @brief number, identifier or branch
+	 */
+	union un_operand {
+		int number; 			/**< number */
+		unsigned int name; 		/**< name of identifier */
+		AST_EXPR_REF branch; 	/**< left side of operator */
+	} operand;
 };
 
 /**
- * @enum expr_ids IDs to differ between expression knot elements
+ * @struct AST_NAME
  *
- * For internal use only!
- */
-enum expr_ids {
-	EXPR_NUMBER, EXPR_IDENTIFIER, EXPR_ARITH, EXPR_UNARY, EXPR_REL, EXPR_ODD
+ * @brief identifier used by an expression, assignment, CALL or READ
+ **/
+struct AST_NAME {
+	SYMBOL identifier; 			/**< name as written */
+	AST_ADDRESS address; 		/**< declaration, depth is AST_NONE until resolved */
 };
 
 /**
- * @struct AST_BLOCK
+ * @struct AST_DECL
  *
- * @brief Block element which can be either refer to a procedure or a statement.
+ * @brief VAR or CONST declaration of a scope
  **/
-struct AST_BLOCK {
-	enum expr_ids tag; /**< union identifier */
-	/**
-	 * @union un_block
-	 *
-	 * @brief Can either represent a procedure or a statement
-	 */
-	union un_block {
-		/**
-		 * @struct st_proc
-		 *
-		 * @brief Represent procedure and stores the following:
-		 *
-		 * Name of the procedure and two branches pointing to the block within the procedure and the following.
-		 */
-		struct st_proc {
-			char identifier[MAX_LENGTH]; 	/**< procedure name */
-			AST_BLOCK_PTR function_path;	/**< pointer to block within procedure */
-			AST_BLOCK_PTR main_path;		/**< pointer to block following procedure */
-		} procedure;
-		AST_STMT_PTR statement; /**< statement */
-	} block;
+struct AST_DECL {
+	SYMBOL identifier; 			/**< declared name */
+	int kind; 					/**< VAR or CONST */
+	int value; 					/**< value of constant */
 };
 
 /**
- * @struct AST_STMT
+ * @struct AST_SCOPE
  *
- * @brief Statement element which represents different statement types
+ * @brief main program or procedure with its declarations
+ *
+ * The declarations of a scope take one run of the declaration array, their
+ * slot is their position inside the run.
  **/
-struct AST_STMT {
-	enum stmt_ids tag; /**< union identifier */
-	/**
-	 * @union un_statement
-	 *
-	 * @brief Can store one of the following types:
-	 *
-	 * Identifier for CALL and READ instructions,
-	 * branch to expression outlined by PRINT,
-	 * branches for IF/WHILE instructions,
-	 * identifier and branch for assignment or
-	 * a sequence for two or more statements.
-	 */
-	union un_statement {
-		char identifier[MAX_LENGTH];		/**< identifier for CALL / READ */
-		AST_EXPR_PTR expression; 			/**< branch to expression for PRINT */
-		/**
-		 * @struct st_jumpbac
-		 *
-		 * @brief Represent WHILE (condition) THEN (statement) instruction.
-		 */
-		struct st_jumpbac {
-			AST_EXPR_PTR condition;			/**< branch to condition */
-			AST_STMT_PTR statement;			/**< branch to statement */
-		} jumpbac;
-		/**
-		 * @struct st_jumpfor
-		 *
-		 * @brief Represent IF (condition) THEN (statement) instruction.
-		 */
-		struct st_jumpfor {
-			AST_EXPR_PTR condition;			/**< branch to condition */
-			AST_STMT_PTR statement;			/**< branch to statement */
-		} jumpfor;
-		/**
-		 * @struct st_assignment
-		 *
-		 * @brief Represent assignment ('=' operator) of valued expression to identifier.
-		 */
-		struct st_assignment {
-			char identifier[MAX_LENGTH];	/**< identifier value stored to*/
-			AST_EXPR_PTR expression;		/**< branch to expression for evaluating */
-		} assignment;
-		/**
-		 * @struct st_sequence
-		 *
-		 * @brief Used for adding additional statements to AST.
-		 */
-		struct st_sequence {
-			AST_STMT_PTR left_statement;	/**< current statement */
-			AST_STMT_PTR right_statement;	/**< next statement */
-		} sequence;
-	} statement;
+struct AST_SCOPE {
+	AST_BLOCK_REF block; 		/**< first block of scope */
+	SYMBOL identifier; 			/**< procedure name, NO_SYMBOL for main program */
+	unsigned int first; 		/**< first declaration */
+	unsigned int size; 			/**< number of declarations */
+	unsigned int depth; 		/**< static nesting depth, 0 for main program */
+	AST_SCOPE_REF parent; 		/**< enclosing scope, AST_NONE for main program */
 };
 
+DEFINE_VECTOR(block_vector, struct AST_BLOCK)
+DEFINE_VECTOR(stmt_vector, struct AST_STMT)
+DEFINE_VECTOR(expr_vector, struct AST_EXPR)
+DEFINE_VECTOR(line_vector, unsigned int)
+DEFINE_VECTOR(ref_vector, AST_STMT_REF)
+DEFINE_VECTOR(name_vector, struct AST_NAME)
+DEFINE_VECTOR(decl_vector, struct AST_DECL)
+DEFINE_VECTOR(scope_vector, struct AST_SCOPE)
+
 /**
- * @struct AST_EXPR
+ * @struct AST
  *
- * @brief Expression element which represents different expression types.
+ * @brief knot arrays of one abstract syntax tree
  **/
-struct AST_EXPR {
-	enum expr_ids tag; /**< union identifier */
-	/**
-	 * @union un_expression
-	 *
-	 * @brief Can store one of the following:
-	 *
-	 * Number or identifier,
-	 * arithmetic operation,
-	 * relational expression,
-	 * unary expression or
-	 * odd (check if defined) expression.
-	 */
-	union un_expression {
-		int number; 						/**< number */
-		char identifier[MAX_LENGTH]; 		/**< identifier */
-		/**
-		 * @struct st_arithmetic
-		 *
-		 * @brief Set operator for arithmetic operation and set branches for expressions left and right of operator.
-		 */
-		struct st_arithmetic {
-			char operator; 					/**< arithmetic operator */
-			AST_EXPR_PTR left_expression;	/**< left side of operator */
-			AST_EXPR_PTR right_expression;	/**< right side of operator */
-		} arithmetic;
-		/**
-		 * @struct st_relation
-		 *
-		 * @brief Set operator for logical operation and set branches for expressions left and right of operator.
-		 */
-		struct st_relation {
-			char operator[3]; 				/**< logical operator */
-			AST_EXPR_PTR left_expression;	/**< left side of operator */
-			AST_EXPR_PTR right_expression;	/**< right side of operator */
-		} relation;
-		/**
-		 * @struct st_unary
-		 *
-		 * @brief Set unary operator and branch for its expression.
-		 */
-		struct st_unary {
-			char operator;					/**< unary operator */
-			AST_EXPR_PTR expression;		/**< branch for expression */
-		} unary;
-		AST_EXPR_PTR odd; 					/**< odd expression */
-	} expression;
+struct AST {
+	struct block_vector block; 	/**< block knots, root has index 0 */
+	struct stmt_vector stmt; 	/**< statement knots */
+	struct expr_vector expr; 	/**< expression knots */
+	struct line_vector line; 	/**< source line of every statement knot */
+	struct ref_vector list; 	/**< statements of all lists, each list in one run */
+	struct ref_vector pending; 	/**< statements of lists which are not finished */
+	struct name_vector name; 	/**< identifiers used by knots */
+	struct decl_vector decl; 	/**< declarations of all scopes */
+	struct scope_vector scope; 	/**< scopes in order of their blocks */
+	const TRACER *trace; 		/**< tracer for created knots */
 };
 
 /**
- * @brief allocates memory for AST block knot
+ * @brief create new empty AST
  *
- * @retval new_knot AST block with allocated memory
+ * @retval ASTPTR new AST
  **/
-AST_BLOCK_PTR init_block() {
-	AST_BLOCK_PTR new_knot;
-	if ((new_knot = malloc(sizeof(*new_knot))) == NULL)
+ASTPTR init_ast() {
+	ASTPTR ast = NULL;
+
+	if ((ast = pl_malloc(sizeof(*ast))) == NULL)
 		error(__AST_BLOCK__, __FILE__, __func__, __LINE__, ERR_MEMORY);
 
-	return new_knot;
+	block_vector_init(&ast->block);
+	stmt_vector_init(&ast->stmt);
+	expr_vector_init(&ast->expr);
+	line_vector_init(&ast->line);
+	ref_vector_init(&ast->list);
+	ref_vector_init(&ast->pending);
+	name_vector_init(&ast->name);
+	decl_vector_init(&ast->decl);
+	scope_vector_init(&ast->scope);
+	ast->trace = &no_trace;
+	return ast;
 }
 
 /**
- * @brief allocates memory for AST statement knot
+ * @brief free AST with all knots
  *
- * @retval new knot AST statement with allocated memory
+ * @param ast AST
+ * @retval void
  **/
-AST_STMT_PTR init_stmt() {
-	AST_STMT_PTR new_knot;
-	if ((new_knot = malloc(sizeof(*new_knot))) == NULL)
-		error(__AST_STMT__, __FILE__, __func__, __LINE__, ERR_MEMORY);
+void free_ast(ASTPTR ast) {
+	if (ast == NULL)
+		return;
 
-	return new_knot;
+	block_vector_free(&ast->block);
+	stmt_vector_free(&ast->stmt);
+	expr_vector_free(&ast->expr);
+	line_vector_free(&ast->line);
+	ref_vector_free(&ast->list);
+	ref_vector_free(&ast->pending);
+	name_vector_free(&ast->name);
+	decl_vector_free(&ast->decl);
+	scope_vector_free(&ast->scope);
+	free(ast);
 }
 
 /**
- * @brief allocates memory for AST expression knot
+ * @brief set tracer which records created knots
  *
- * @retval new_knot AST expression with allocated memory
+ * @param ast AST
+ * @param *tr tracer, has to live as long as the AST
+ * @retval void
  **/
-AST_EXPR_PTR init_expr() {
-	AST_EXPR_PTR new_knot;
-	if ((new_knot = malloc(sizeof(*new_knot))) == NULL)
-		error(__AST_EXPR__, __FILE__, __func__, __LINE__, ERR_MEMORY);
+void ast_set_tracer(ASTPTR ast, const TRACER *tr) {
+	ast->trace = tr;
+}
 
-	return new_knot;
+/**
+ * @brief bytes taken by knots of AST
+ *
+ * @param ast AST
+ * @retval size_t
+ **/
+size_t ast_bytes(const ASTPTR ast) {
+	return block_vector_size(&ast->block) * sizeof(struct AST_BLOCK)
+			+ stmt_vector_size(&ast->stmt) * sizeof(struct AST_STMT)
+			+ expr_vector_size(&ast->expr) * sizeof(struct AST_EXPR)
+			+ line_vector_size(&ast->line) * sizeof(unsigned int)
+			+ ref_vector_size(&ast->list) * sizeof(AST_STMT_REF)
+			+ name_vector_size(&ast->name) * sizeof(struct AST_NAME)
+			+ decl_vector_size(&ast->decl) * sizeof(struct AST_DECL)
+			+ scope_vector_size(&ast->scope) * sizeof(struct AST_SCOPE);
+}
+
+/**
+ * @brief number of knots of AST
+ *
+ * @param ast AST
+ * @retval size_t
+ **/
+size_t ast_knots(const ASTPTR ast) {
+	return block_vector_size(&ast->block) + stmt_vector_size(&ast->stmt)
+			+ expr_vector_size(&ast->expr);
+}
+
+/**
+ * @brief appends n empty block knots
+ *
+ * @param ast AST
+ * @param n number of knots
+ * @retval AST_BLOCK_REF index of first new knot
+ **/
+static AST_BLOCK_REF new_blocks(ASTPTR ast, size_t n) {
+	struct AST_BLOCK empty = { 0, NO_SYMBOL, AST_NONE };
+	size_t first = block_vector_size(&ast->block);
+
+	block_vector_resize(&ast->block, first + n, empty);
+	return (AST_BLOCK_REF) first;
+}
+
+/**
+ * @brief appends n empty statement knots
+ *
+ * @param ast AST
+ * @param n number of knots
+ * @retval AST_STMT_REF index of first new knot
+ **/
+static AST_STMT_REF new_stmts(ASTPTR ast, size_t n) {
+	struct AST_STMT empty = { STMT_PASS, AST_NONE, AST_NONE };
+	size_t first = stmt_vector_size(&ast->stmt);
+
+	stmt_vector_resize(&ast->stmt, first + n, empty);
+	line_vector_resize(&ast->line, first + n, 0);
+	return (AST_STMT_REF) first;
+}
+
+/**
+ * @brief appends expression knot
+ *
+ * @param ast AST
+ * @param tag one of expr_ids
+ * @param operator operator character or word ID, 0 if none
+ * @retval struct AST_EXPR * new knot, valid until the next knot is created
+ **/
+static struct AST_EXPR *new_expr(ASTPTR ast, const enum expr_ids tag,
+		const int operator) {
+	struct AST_EXPR knot;
+
+	knot.tag = tag;
+	knot.operator = (unsigned short) operator;
+	knot.operand.branch = AST_NONE;
+	return expr_vector_push(&ast->expr, knot);
+}
+
+/**
+ * @brief appends unresolved name
+ *
+ * @param ast AST
+ * @param s identifier
+ * @retval unsigned int index of name
+ **/
+static unsigned int new_name(ASTPTR ast, const SYMBOL s) {
+	struct AST_NAME name;
+
+	name.identifier = s;
+	name.address.depth = AST_NONE;
+	name.address.slot = AST_NONE;
+	name_vector_push(&ast->name, name);
+	return (unsigned int) name_vector_size(&ast->name) - 1;
+}
+
+/**
+ * @brief allocates memory for AST block knot
+ *
+ * @param ast AST the knot belongs to
+ * @retval new_knot AST block with allocated memory
+ **/
+AST_BLOCK_REF init_block(ASTPTR ast) {
+	return new_blocks(ast, 1);
+}
+
+/**
+ * @brief allocates memory for AST statement knot
+ *
+ * @param ast AST the knot belongs to
+ * @retval new knot AST statement with allocated memory
+ **/
+AST_STMT_REF init_stmt(ASTPTR ast) {
+	return new_stmts(ast, 1);
 }
 
 /**
@@ -268,39 +340,42 @@ AST_EXPR_PTR init_expr() {
  *
  * Sets procedure identifier and generates two branches, one for the block within the procedure and the other one for the following block.
  *
- * @param bl pointer to block
- * @param *s procedure name
+ * @param ast AST
+ * @param bl block
+ * @param s procedure name
  * @retval void
  **/
-void block_init_procedure(AST_BLOCK_PTR bl, const char *s) {
-	bl->tag = BLOCK_PROC;
-	strcpy(bl->block.procedure.identifier, s);
-	bl->block.procedure.function_path = init_block();
-	bl->block.procedure.main_path = init_block();
-#ifdef PL_DEBUG
-	DEB_OUT("procedure", bl, bl->block.procedure.function_path,
-			bl->block.procedure.main_path);
-#endif
+void block_init_procedure(ASTPTR ast, AST_BLOCK_REF bl, const SYMBOL s) {
+	AST_BLOCK_REF branch = new_blocks(ast, 2);
+	struct AST_BLOCK *knot = block_vector_at(&ast->block, bl);
+
+	knot->tag = BLOCK_PROC;
+	knot->identifier = s;
+	knot->branch = branch;
+	TRACE(ast->trace, TRACE_AST, TRACE_INFO, EV_AST_PROCEDURE, bl, branch,
+			branch + 1);
 }
 
 /**
- * @brief returns pointer to block within procedure
+ * @brief returns block within procedure
  *
+ * @param ast AST
  * @param bl knot
- * @retval bl->block.procedure.function_path pointer branch refers to
+ * @retval AST_BLOCK_REF index branch refers to
  */
-AST_BLOCK_PTR block_get_function(const AST_BLOCK_PTR bl) {
-	return bl->block.procedure.function_path;
+AST_BLOCK_REF block_get_function(const ASTPTR ast, const AST_BLOCK_REF bl) {
+	return block_vector_at(&ast->block, bl)->branch;
 }
 
 /**
- * @brief returns pointer to block after procedure
+ * @brief returns block after procedure
  *
+ * @param ast AST
  * @param bl knot
- * @retval bl->block.procedure.main_path pointer branch refers to
+ * @retval AST_BLOCK_REF index branch refers to
  */
-AST_BLOCK_PTR block_get_main(const AST_BLOCK_PTR bl) {
-	return bl->block.procedure.main_path;
+AST_BLOCK_REF block_get_main(const ASTPTR ast, const AST_BLOCK_REF bl) {
+	return block_vector_at(&ast->block, bl)->branch + 1;
 }
 
 /**
@@ -308,18 +383,41 @@ AST_BLOCK_PTR block_get_main(const AST_BLOCK_PTR bl) {
  *
  * Sets statement identifier and generates statement branch.
  *
+ * @param ast AST
  * @param bl block element
- * @retval bl->block.statement pointer branch refers to
+ * @retval AST_STMT_REF index branch refers to
  */
-AST_STMT_PTR block_init_statement(AST_BLOCK_PTR bl) {
-	bl->tag = BLOCK_STMT;
-#ifdef PL_DEBUG
-	bl->block.statement = init_stmt();
-	DEB_OUT("statement", bl, bl->block.statement, NULL);
-	return bl->block.statement;
-#else
-	return bl->block.statement = init_stmt();
-#endif
+AST_STMT_REF block_init_statement(ASTPTR ast, AST_BLOCK_REF bl) {
+	AST_STMT_REF branch = new_stmts(ast, 1);
+	struct AST_BLOCK *knot = block_vector_at(&ast->block, bl);
+
+	knot->tag = BLOCK_STMT;
+	knot->branch = branch;
+	TRACE(ast->trace, TRACE_AST, TRACE_INFO, EV_AST_STATEMENT, bl, branch, 0);
+	return branch;
+}
+
+/**
+ * @brief store source line of statement
+ *
+ * @param ast AST
+ * @param st statement element
+ * @param line line the statement starts in
+ * @retval void
+ */
+void stmt_set_line(ASTPTR ast, AST_STMT_REF st, const size_t line) {
+	*line_vector_at(&ast->line, st) = (unsigned int) line;
+}
+
+/**
+ * @brief return source line of statement
+ *
+ * @param ast AST
+ * @param st statement element
+ * @retval size_t line the statement starts in
+ */
+size_t stmt_get_line(const ASTPTR ast, const AST_STMT_REF st) {
+	return *line_vector_at(&ast->line, st);
 }
 
 /**
@@ -328,111 +426,141 @@ AST_STMT_PTR block_init_statement(AST_BLOCK_PTR bl) {
  * Attention! This function is used for creating knots for operations like CALL and READ!
  * Sets CALL/READ identifier and stores identifier name.
  *
+ * @param ast AST
  * @param st statement element
- * @param *s identifier name
+ * @param s identifier name
+ * @param word CALL or READ
  * @retval void
  */
-void stmt_init_care(AST_STMT_PTR st, const char *s) {
-	st->tag = STMT_CARE;
-	strcpy(st->statement.identifier, s);
-#ifdef PL_DEBUG
-	DEB_OUT("care", st, NULL, NULL);
-#endif
+void stmt_init_care(ASTPTR ast, AST_STMT_REF st, const SYMBOL s,
+		const int word) {
+	unsigned int name = new_name(ast, s);
+	struct AST_STMT *knot = stmt_vector_at(&ast->stmt, st);
+
+	knot->tag = STMT_CARE;
+	knot->branch = (unsigned int) word;
+	knot->operand = name;
+	TRACE(ast->trace, TRACE_AST, TRACE_INFO, EV_AST_CARE, st, s, 0);
 }
 
 /**
- * @brief transforms statement element to print knot and return expression branch
+ * @brief transforms statement element to print knot
  *
- * Sets PRINT identifier and creates expression branch
+ * @param ast AST
+ * @param st statement element
+ * @param ex expression to print
+ * @retval void
+ */
+void stmt_init_print(ASTPTR ast, AST_STMT_REF st, const AST_EXPR_REF ex) {
+	struct AST_STMT *knot = stmt_vector_at(&ast->stmt, st);
+
+	knot->tag = STMT_PRINT;
+	knot->branch = ex;
+	TRACE(ast->trace, TRACE_AST, TRACE_INFO, EV_AST_PRINT, st, ex, 0);
+}
+
+/**
+ * @brief transforms statement element to a condition and a statement branch
  *
+ * @param ast AST
  * @param st statement element
- * @retval st->statement.expression pointer to branch refers to
+ * @param tag STMT_IF or STMT_WHILE
+ * @param condition condition branch
+ * @retval struct AST_STMT * knot, valid until the next knot is created
  */
-AST_EXPR_PTR stmt_init_print(AST_STMT_PTR st) {
-	st->tag = STMT_PRINT;
-#ifdef PL_DEBUG
-	st->statement.expression = init_expr();
-	DEB_OUT("print", st, st->statement.expression, NULL);
-	return st->statement.expression;
-#else
-	return st->statement.expression = init_expr();
-#endif
+static struct AST_STMT *stmt_init_jump(ASTPTR ast, AST_STMT_REF st,
+		const enum stmt_ids tag, const AST_EXPR_REF condition) {
+	AST_STMT_REF statement = new_stmts(ast, 1);
+	struct AST_STMT *knot = stmt_vector_at(&ast->stmt, st);
+
+	knot->tag = tag;
+	knot->branch = condition;
+	knot->operand = statement;
+	return knot;
 }
 
 /**
  * @brief transforms statement element to whole knot
  *
  * Naming comes from three address code because while implements a jump back to a defined point.
+ * Creates the statement branch, which is returned by stmt_get_jumpbac_statement().
  *
+ * @param ast AST
  * @param st statement element
+ * @param ex condition
  * @retval void
  */
-void stmt_init_jumpbac(AST_STMT_PTR st) {
-	st->tag = STMT_WHILE;
-	st->statement.jumpbac.condition = init_expr();
-	st->statement.jumpbac.statement = init_stmt();
-#ifdef PL_DEBUG
-	DEB_OUT("jumpbac", st, st->statement.jumpbac.condition,
-			st->statement.jumpbac.statement);
-#endif
+void stmt_init_jumpbac(ASTPTR ast, AST_STMT_REF st, const AST_EXPR_REF ex) {
+	struct AST_STMT *knot = stmt_init_jump(ast, st, STMT_WHILE, ex);
+
+	TRACE(ast->trace, TRACE_AST, TRACE_INFO, EV_AST_JUMPBAC, st, knot->branch,
+			knot->operand);
 }
 
 /**
  * @brief returns branch to condition element of while instruction
  *
+ * @param ast AST
  * @param st statement element
- * @retval st->statement.jumpbac.condition condition branch
+ * @retval AST_EXPR_REF condition branch
  */
-AST_EXPR_PTR stmt_get_jumpbac_condition(const AST_STMT_PTR st) {
-	return st->statement.jumpbac.condition;
+AST_EXPR_REF stmt_get_jumpbac_condition(const ASTPTR ast,
+		const AST_STMT_REF st) {
+	return stmt_vector_at(&ast->stmt, st)->branch;
 }
 
 /**
  * @brief returns branch to statement element of while instruction
  *
+ * @param ast AST
  * @param st statement element
- * @return st->statement.jumpbac.statement statement branch
+ * @return AST_STMT_REF statement branch
  */
-AST_STMT_PTR stmt_get_jumpbac_statement(const AST_STMT_PTR st) {
-	return st->statement.jumpbac.statement;
+AST_STMT_REF stmt_get_jumpbac_statement(const ASTPTR ast,
+		const AST_STMT_REF st) {
+	return stmt_vector_at(&ast->stmt, st)->operand;
 }
 
 /**
  * @brief transforms statement element to if knot
  *
  * Naming comes from three address code where if instruction is represented by a jump forwards.
+ * Creates the statement branch, which is returned by stmt_get_jumpfor_statement().
  *
+ * @param ast AST
  * @param st statement element
+ * @param ex condition
  * @retval void
  */
-void stmt_init_jumpfor(AST_STMT_PTR st) {
-	st->tag = STMT_IF;
-	st->statement.jumpfor.condition = init_expr();
-	st->statement.jumpfor.statement = init_stmt();
-#ifdef PL_DEBUG
-	DEB_OUT("jumpfor", st, st->statement.jumpfor.condition,
-			st->statement.jumpfor.statement);
-#endif
+void stmt_init_jumpfor(ASTPTR ast, AST_STMT_REF st, const AST_EXPR_REF ex) {
+	struct AST_STMT *knot = stmt_init_jump(ast, st, STMT_IF, ex);
+
+	TRACE(ast->trace, TRACE_AST, TRACE_INFO, EV_AST_JUMPFOR, st, knot->branch,
+			knot->operand);
 }
 
 /**
  * @brief returns branch to condition element of if instruction
  *
+ * @param ast AST
  * @param st statement element
- * @retval st->statement.jumpfor.condition condition branch
+ * @retval AST_EXPR_REF condition branch
  */
-AST_EXPR_PTR stmt_get_jumpfor_condition(const AST_STMT_PTR st) {
-	return st->statement.jumpfor.condition;
+AST_EXPR_REF stmt_get_jumpfor_condition(const ASTPTR ast,
+		const AST_STMT_REF st) {
+	return stmt_vector_at(&ast->stmt, st)->branch;
 }
 
 /**
  * @brief returns branch to statement element of while instruction
  *
+ * @param ast AST
  * @param st statement element
- * @return st->statement.jumpfor.statement statement branch
+ * @return AST_STMT_REF statement branch
  */
-AST_STMT_PTR stmt_get_jumpfor_statement(const AST_STMT_PTR st) {
-	return st->statement.jumpfor.statement;
+AST_STMT_REF stmt_get_jumpfor_statement(const ASTPTR ast,
+		const AST_STMT_REF st) {
+	return stmt_vector_at(&ast->stmt, st)->operand;
 }
 
 /**
@@ -440,219 +568,777 @@ AST_STMT_PTR stmt_get_jumpfor_statement(const AST_STMT_PTR st) {
  *
  * Stores identifier and branch to expression which value should be stored in identifier.
  *
+ * @param ast AST
  * @param st statement element
- * @param *s name of identifier
- * @retval st->statement.assignment.expression branch to expression
+ * @param s name of identifier
+ * @param ex expression
+ * @retval void
  */
-AST_EXPR_PTR stmt_init_assignment(AST_STMT_PTR st, const char *s) {
-	st->tag = STMT_ASSIGN;
-	strcpy(st->statement.assignment.identifier, s);
-#ifdef PL_DEBUG
-	st->statement.assignment.expression = init_expr();
-	DEB_OUT("assignment", st, st->statement.assignment.expression, NULL);
-	return st->statement.assignment.expression;
-#else
-	return st->statement.assignment.expression = init_expr();
-#endif
+void stmt_init_assignment(ASTPTR ast, AST_STMT_REF st, const SYMBOL s,
+		const AST_EXPR_REF ex) {
+	unsigned int name = new_name(ast, s);
+	struct AST_STMT *knot = stmt_vector_at(&ast->stmt, st);
+
+	knot->tag = STMT_ASSIGN;
+	knot->branch = ex;
+	knot->operand = name;
+	TRACE(ast->trace, TRACE_AST, TRACE_INFO, EV_AST_ASSIGNMENT, st, ex, 0);
 }
 
 /**
- * @brief transforms statement element to sequence for creating multiple statements
+ * @brief transforms statement element to list of statements
  *
+ * Statements are added with stmt_list_append() and the list is closed with
+ * stmt_end_list(). Lists may be nested, inner lists have to be closed first.
+ *
+ * @param ast AST
  * @param st statement element
  * @retval void
  */
-void stmt_init_sequence(AST_STMT_PTR st) {
-	st->tag = STMT_SEQ;
-	st->statement.sequence.left_statement = init_stmt();
-	st->statement.sequence.right_statement = init_stmt();
-#ifdef PL_DEBUG
-	DEB_OUT("sequence", st, st->statement.sequence.left_statement,
-			st->statement.sequence.right_statement);
-#endif
+void stmt_init_list(ASTPTR ast, AST_STMT_REF st) {
+	struct AST_STMT *knot = stmt_vector_at(&ast->stmt, st);
+
+	knot->tag = STMT_LIST;
+	knot->branch = (unsigned int) ref_vector_size(&ast->pending);
+	knot->operand = 0;
 }
 
 /**
- * @brief returns branch for first statement
+ * @brief adds new empty statement to end of unfinished list
  *
- * @param st statement element
- * @retval st->statement.sequence.left_statement first statement branch
+ * @param ast AST
+ * @param st list element
+ * @retval AST_STMT_REF new statement
  */
-AST_STMT_PTR stmt_get_sequence_left(const AST_STMT_PTR st) {
-	return st->statement.sequence.left_statement;
+AST_STMT_REF stmt_list_append(ASTPTR ast, AST_STMT_REF st) {
+	AST_STMT_REF item = new_stmts(ast, 1);
+
+	ref_vector_push(&ast->pending, item);
+	TRACE(ast->trace, TRACE_AST, TRACE_INFO, EV_AST_LIST, st, item, 0);
+	return item;
 }
 
 /**
- * @brief returns branch for second statement
+ * @brief closes list, its statements are moved into one run of the list array
  *
- * @param st statement element
- * @retval st->statement.sequence.right_statement second statement branch
+ * @param ast AST
+ * @param st list element
+ * @retval void
  */
-AST_STMT_PTR stmt_get_sequence_right(const AST_STMT_PTR st) {
-	return st->statement.sequence.right_statement;
-}
+void stmt_end_list(ASTPTR ast, AST_STMT_REF st) {
+	struct AST_STMT *knot = stmt_vector_at(&ast->stmt, st);
+	size_t i, mark = knot->branch, end = ref_vector_size(&ast->pending);
+
+	knot->branch = (unsigned int) ref_vector_size(&ast->list);
+	knot->operand = (unsigned int) (end - mark);
+
+	for (i = mark; i < end; i++)
+		ref_vector_push(&ast->list, *ref_vector_at(&ast->pending, i));
 
+	ref_vector_truncate(&ast->pending, mark);
+}
 
 /**
- * @brief transform expression element to number
+ * @brief returns statements of list
  *
- * @param ex expression element
- * @param n number to store
- * @retval void
+ * The array stays valid until the next list is closed.
+ *
+ * @param ast AST
+ * @param st list element
+ * @param *count returns number of statements
+ * @retval const AST_STMT_REF* array of statements
  */
-void expr_init_number(AST_EXPR_PTR ex, const int n) {
-	ex->tag = EXPR_NUMBER;
-	ex->expression.number = n;
-#ifdef PL_DEBUG
-	DEB_OUT("number", ex, NULL, NULL);
-#endif
+const AST_STMT_REF *stmt_get_list(const ASTPTR ast, const AST_STMT_REF st,
+		size_t *count) {
+	const struct AST_STMT *knot = stmt_vector_at(&ast->stmt, st);
+
+	*count = knot->operand;
+	return (*count > 0) ? ref_vector_at(&ast->list, knot->branch) : NULL;
 }
 
+
 /**
- * @brief transform expression element to identifier
+ * @brief create number expression
  *
- * @param ex expression element
- * @param s name of identifier
- * @retval void
+ * @param ast AST
+ * @param n number to store
+ * @retval AST_EXPR_REF new knot
  */
-void expr_init_identifier(AST_EXPR_PTR ex, const char *s) {
-	ex->tag = EXPR_IDENTIFIER;
-	strcpy(ex->expression.identifier, s);
-#ifdef PL_DEBUG
-	DEB_OUT("identifier", ex, NULL, NULL);
-#endif
+AST_EXPR_REF expr_init_number(ASTPTR ast, const int n) {
+	AST_EXPR_REF ex = (AST_EXPR_REF) expr_vector_size(&ast->expr);
+
+	new_expr(ast, EXPR_NUMBER, 0)->operand.number = n;
+	TRACE(ast->trace, TRACE_AST, TRACE_INFO, EV_AST_NUMBER, ex, n, 0);
+	return ex;
 }
 
 /**
- * @brief transform expression element to arithmetic operation by generating to branches for the left and right side of the arithmetic operator
+ * @brief create identifier expression
  *
- * @param ex expression element
- * @retval void
+ * @param ast AST
+ * @param s name of identifier
+ * @retval AST_EXPR_REF new knot
  */
-void expr_init_arithmetic(AST_EXPR_PTR ex) {
-	ex->tag = EXPR_ARITH;
-	ex->expression.arithmetic.left_expression = init_expr();
-	ex->expression.arithmetic.right_expression = init_expr();
-#ifdef PL_DEBUG
-	DEB_OUT("arithmetic", ex, ex->expression.arithmetic.left_expression,
-			ex->expression.arithmetic.right_expression);
-#endif
+AST_EXPR_REF expr_init_identifier(ASTPTR ast, const SYMBOL s) {
+	AST_EXPR_REF ex = (AST_EXPR_REF) expr_vector_size(&ast->expr);
+	unsigned int name = new_name(ast, s);
+
+	new_expr(ast, EXPR_IDENTIFIER, 0)->operand.name = name;
+	TRACE(ast->trace, TRACE_AST, TRACE_INFO, EV_AST_IDENTIFIER, ex, s, 0);
+	return ex;
 }
 
 /**
- * @brief stores the operator to arithmetic expression object
+ * @brief create arithmetic operation of two expressions
  *
- * Arithmetic object generation and operator storing are separated due to infix parsing
+ * The right side has to be the last expression created.
  *
- * @param ex arithmetic expression object
+ * @param ast AST
  * @param c operator
- * @retval void
+ * @param left left side of operator
+ * @param right right side of operator
+ * @retval AST_EXPR_REF new knot
  */
-void expr_arithmetic_set_op(AST_EXPR_PTR ex, const char c) {
-	ex->expression.arithmetic.operator = c;
+AST_EXPR_REF expr_init_arithmetic(ASTPTR ast, const char c,
+		const AST_EXPR_REF left, const AST_EXPR_REF right) {
+	AST_EXPR_REF ex = (AST_EXPR_REF) expr_vector_size(&ast->expr);
+
+	new_expr(ast, EXPR_ARITH, (unsigned char) c)->operand.branch = left;
+	TRACE(ast->trace, TRACE_AST, TRACE_INFO, EV_AST_ARITHMETIC, ex, left,
+			right);
+	return ex;
 }
 
 /**
  * @brief return left branch of arithmetic expression object
  *
+ * @param ast AST
  * @param ex arithmetic expression object
- * @retval ex->expression.arithmetic.left_expression left branch
+ * @retval AST_EXPR_REF left branch
  */
-AST_EXPR_PTR expr_get_arithmetic_left(const AST_EXPR_PTR ex) {
-	return ex->expression.arithmetic.left_expression;
+AST_EXPR_REF expr_get_arithmetic_left(const ASTPTR ast,
+		const AST_EXPR_REF ex) {
+	return expr_vector_at(&ast->expr, ex)->operand.branch;
 }
 
 /**
  * @brief return right branch of arithmetic expression object
  *
+ * @param ast AST
  * @param ex arithmetic expression object
- * @retval ex->expression.arithmetic.right_expression right branch
+ * @retval AST_EXPR_REF right branch
+ */
+AST_EXPR_REF expr_get_arithmetic_right(const ASTPTR ast,
+		const AST_EXPR_REF ex) {
+	(void) ast;
+
+	return ex - 1;
+}
+
+/**
+ * @brief create logical operation of two expressions
+ *
+ * The right side has to be the last expression created.
+ *
+ * @param ast AST
+ * @param op operator character '<' / '>' or word ID EQ, NE, LE, GE
+ * @param left left side of operator
+ * @param right right side of operator
+ * @retval AST_EXPR_REF new knot
+ */
+AST_EXPR_REF expr_init_relation(ASTPTR ast, const int op,
+		const AST_EXPR_REF left, const AST_EXPR_REF right) {
+	AST_EXPR_REF ex = (AST_EXPR_REF) expr_vector_size(&ast->expr);
+
+	new_expr(ast, EXPR_REL, op)->operand.branch = left;
+	TRACE(ast->trace, TRACE_AST, TRACE_INFO, EV_AST_RELATION, ex, left, right);
+	return ex;
+}
+
+/**
+ * @brief return right branch of logical expression object
+ *
+ * @param ast AST
+ * @param ex logical expression object
+ * @retval AST_EXPR_REF left branch
+ */
+AST_EXPR_REF expr_get_relation_left(const ASTPTR ast, const AST_EXPR_REF ex) {
+	return expr_vector_at(&ast->expr, ex)->operand.branch;
+}
+
+/**
+ * @brief return right branch of logical expression object
+ *
+ * @param ast AST
+ * @param ex logical expression object
+ * @retval AST_EXPR_REF right branch
+ */
+AST_EXPR_REF expr_get_relation_right(const ASTPTR ast, const AST_EXPR_REF ex) {
+	(void) ast;
+
+	return ex - 1;
+}
+
+/**
+ * @brief create unary expression
+ *
+ * The branch has to be the last expression created.
+ *
+ * @param ast AST
+ * @param c unary operator
+ * @param branch expression branch
+ * @retval AST_EXPR_REF new knot
  */
-AST_EXPR_PTR expr_get_arithmetic_right(const AST_EXPR_PTR ex) {
-	return ex->expression.arithmetic.right_expression;
+AST_EXPR_REF expr_init_unary(ASTPTR ast, const char c,
+		const AST_EXPR_REF branch) {
+	AST_EXPR_REF ex = (AST_EXPR_REF) expr_vector_size(&ast->expr);
+
+	new_expr(ast, EXPR_UNARY, (unsigned char) c);
+	TRACE(ast->trace, TRACE_AST, TRACE_INFO, EV_AST_UNARY, ex, branch, 0);
+	return ex;
 }
 
 /**
- * @brief transform expression element to logical operation by generating to branches for the left and right side of the logical operator
+ * @brief create odd expression
+ *
+ * The branch has to be the last expression created.
  *
+ * @param ast AST
+ * @param branch expression branch
+ * @retval AST_EXPR_REF new knot
+ */
+AST_EXPR_REF expr_init_odd(ASTPTR ast, const AST_EXPR_REF branch) {
+	AST_EXPR_REF ex = (AST_EXPR_REF) expr_vector_size(&ast->expr);
+
+	new_expr(ast, EXPR_ODD, 0);
+	TRACE(ast->trace, TRACE_AST, TRACE_INFO, EV_AST_ODD, ex, branch, 0);
+	return ex;
+}
+
+/**
+ * @brief turns expression into number, used for folding
+ *
+ * Branches of the expression stay in the array but are no longer reached.
+ *
+ * @param ast AST
  * @param ex expression element
+ * @param n value of expression
  * @retval void
  */
-void expr_init_relation(AST_EXPR_PTR ex) {
-	ex->tag = EXPR_REL;
-	ex->expression.relation.left_expression = init_expr();
-	ex->expression.relation.right_expression = init_expr();
-#ifdef PL_DEBUG
-	DEB_OUT("relation", ex, ex->expression.relation.left_expression,
-			ex->expression.relation.right_expression);
-#endif
+void expr_set_number(ASTPTR ast, const AST_EXPR_REF ex, const int n) {
+	struct AST_EXPR *knot = expr_vector_at(&ast->expr, ex);
+
+	knot->tag = EXPR_NUMBER;
+	knot->operator = 0;
+	knot->operand.number = n;
 }
 
 /**
- * @brief stores the operator to logical expression object
+ * @brief turns statement into PASS, used for removing dead code
  *
- * Logical object generation and operator storing are separated due to infix parsing
+ * @param ast AST
+ * @param st statement element
+ * @retval void
+ */
+void stmt_set_pass(ASTPTR ast, const AST_STMT_REF st) {
+	struct AST_STMT *knot = stmt_vector_at(&ast->stmt, st);
+
+	knot->tag = STMT_PASS;
+	knot->branch = AST_NONE;
+	knot->operand = AST_NONE;
+}
+
+/**
+ * @brief replaces statement by another one, e.g. IF by its statement
  *
- * @param ex logical expression object
- * @param c operator
+ * @param ast AST
+ * @param st statement element which is overwritten
+ * @param by statement element which takes its place
  * @retval void
  */
-void expr_relation_set_op(AST_EXPR_PTR ex, const char *s) {
-	strcpy(ex->expression.relation.operator, s);
+void stmt_replace(ASTPTR ast, const AST_STMT_REF st, const AST_STMT_REF by) {
+	*stmt_vector_at(&ast->stmt, st) = *stmt_vector_at(&ast->stmt, by);
+	*line_vector_at(&ast->line, st) = *line_vector_at(&ast->line, by);
 }
 
 /**
- * @brief return right branch of logical expression object
+ * @brief removes PASS statements from a closed list
  *
- * @param ex logical expression object
- * @retval ex->expression.relation.left_expression left branch
+ * @param ast AST
+ * @param st list element
+ * @retval void
  */
-AST_EXPR_PTR expr_get_relation_left(const AST_EXPR_PTR ex) {
-	return ex->expression.relation.left_expression;
+void stmt_list_prune(ASTPTR ast, const AST_STMT_REF st) {
+	struct AST_STMT *knot = stmt_vector_at(&ast->stmt, st);
+	AST_STMT_REF *item = (knot->operand > 0) ?
+			ref_vector_at(&ast->list, knot->branch) : NULL;
+	unsigned int i, kept = 0;
+
+	for (i = 0; i < knot->operand; i++)
+		if (stmt_vector_at(&ast->stmt, item[i])->tag != STMT_PASS)
+			item[kept++] = item[i];
+
+	knot->operand = kept;
 }
 
 /**
- * @brief return right branch of logical expression object
+ * @brief returns kind of block knot
  *
- * @param ex logical expression object
- * @retval ex->expression.relation.left_expression right branch
+ * @param ast AST
+ * @param bl block element
+ * @retval int one of block_ids
+ */
+int block_get_tag(const ASTPTR ast, const AST_BLOCK_REF bl) {
+	return block_vector_at(&ast->block, bl)->tag;
+}
+
+/**
+ * @brief returns name of procedure
+ *
+ * @param ast AST
+ * @param bl procedure element
+ * @retval SYMBOL procedure name
+ */
+SYMBOL block_get_identifier(const ASTPTR ast, const AST_BLOCK_REF bl) {
+	return block_vector_at(&ast->block, bl)->identifier;
+}
+
+/**
+ * @brief returns statement of block
+ *
+ * @param ast AST
+ * @param bl statement block element
+ * @retval AST_STMT_REF statement branch
+ */
+AST_STMT_REF block_get_statement(const ASTPTR ast, const AST_BLOCK_REF bl) {
+	return block_vector_at(&ast->block, bl)->branch;
+}
+
+/**
+ * @brief returns kind of statement knot
+ *
+ * @param ast AST
+ * @param st statement element
+ * @retval int one of stmt_ids
+ */
+int stmt_get_tag(const ASTPTR ast, const AST_STMT_REF st) {
+	return stmt_vector_at(&ast->stmt, st)->tag;
+}
+
+/**
+ * @brief returns identifier of assignment, CALL or READ statement
+ *
+ * @param ast AST
+ * @param st statement element
+ * @retval SYMBOL identifier name
+ */
+SYMBOL stmt_get_identifier(const ASTPTR ast, const AST_STMT_REF st) {
+	return name_vector_at(&ast->name,
+			stmt_vector_at(&ast->stmt, st)->operand)->identifier;
+}
+
+/**
+ * @brief returns whether CALL / READ statement is CALL or READ
+ *
+ * @param ast AST
+ * @param st CALL / READ element
+ * @retval int word ID CALL or READ
  */
-AST_EXPR_PTR expr_get_relation_right(const AST_EXPR_PTR ex) {
-	return ex->expression.relation.right_expression;
+int stmt_get_care(const ASTPTR ast, const AST_STMT_REF st) {
+	return (int) stmt_vector_at(&ast->stmt, st)->branch;
 }
 
 /**
- * @brief transform expression element to unary expression
+ * @brief returns resolved address of assignment, CALL or READ statement
  *
+ * For CALL the slot is the index of the procedure's scope.
+ *
+ * @param ast AST
+ * @param st statement element
+ * @retval AST_ADDRESS address, depth is AST_NONE if not resolved
+ */
+AST_ADDRESS stmt_get_address(const ASTPTR ast, const AST_STMT_REF st) {
+	return name_vector_at(&ast->name,
+			stmt_vector_at(&ast->stmt, st)->operand)->address;
+}
+
+/**
+ * @brief stores resolved address of assignment, CALL or READ statement
+ *
+ * @param ast AST
+ * @param st statement element
+ * @param address address of declaration
+ * @retval void
+ */
+void stmt_set_address(ASTPTR ast, const AST_STMT_REF st,
+		const AST_ADDRESS address) {
+	name_vector_at(&ast->name, stmt_vector_at(&ast->stmt, st)->operand)->address =
+			address;
+}
+
+/**
+ * @brief returns expression of assignment or PRINT statement
+ *
+ * @param ast AST
+ * @param st statement element
+ * @retval AST_EXPR_REF expression branch
+ */
+AST_EXPR_REF stmt_get_expression(const ASTPTR ast, const AST_STMT_REF st) {
+	return stmt_vector_at(&ast->stmt, st)->branch;
+}
+
+/**
+ * @brief returns kind of expression knot
+ *
+ * @param ast AST
  * @param ex expression element
- * @param c unary operator
- * @retval ex->expression.unary.expression expression branch
+ * @retval int one of expr_ids
  */
-AST_EXPR_PTR expr_init_unary(AST_EXPR_PTR ex, const char c) {
-	ex->tag = EXPR_UNARY;
-	ex->expression.unary.operator = c;
-#ifdef PL_DEBUG
-	ex->expression.unary.expression = init_expr();
-	DEB_OUT("unary", ex, ex->expression.unary.expression, NULL);
-	return ex->expression.unary.expression;
-#else
-	return ex->expression.unary.expression = init_expr();
-#endif
+int expr_get_tag(const ASTPTR ast, const AST_EXPR_REF ex) {
+	return expr_vector_at(&ast->expr, ex)->tag;
 }
 
 /**
- * @brief transform expression element to odd expression
+ * @brief returns operator of arithmetic, unary or relation expression
  *
+ * @param ast AST
  * @param ex expression element
- * @retval ex->expression.odd expression branch
- */
-AST_EXPR_PTR expr_init_odd(AST_EXPR_PTR ex) {
-	ex->tag = EXPR_ODD;
-#ifdef PL_DEBUG
-	ex->expression.odd = init_expr();
-	DEB_OUT("odd", ex, ex->expression.odd, NULL);
-	return ex->expression.odd;
-#else
-	return ex->expression.odd = init_expr();
-#endif
+ * @retval int operator character or word ID
+ */
+int expr_get_operator(const ASTPTR ast, const AST_EXPR_REF ex) {
+	return expr_vector_at(&ast->expr, ex)->operator;
+}
+
+/**
+ * @brief returns value of number expression
+ *
+ * @param ast AST
+ * @param ex number element
+ * @retval int number
+ */
+int expr_get_number(const ASTPTR ast, const AST_EXPR_REF ex) {
+	return expr_vector_at(&ast->expr, ex)->operand.number;
+}
+
+/**
+ * @brief returns name of identifier expression
+ *
+ * @param ast AST
+ * @param ex identifier element
+ * @retval SYMBOL identifier name
+ */
+SYMBOL expr_get_identifier(const ASTPTR ast, const AST_EXPR_REF ex) {
+	return name_vector_at(&ast->name,
+			expr_vector_at(&ast->expr, ex)->operand.name)->identifier;
+}
+
+/**
+ * @brief returns resolved address of identifier expression
+ *
+ * @param ast AST
+ * @param ex identifier element
+ * @retval AST_ADDRESS address, depth is AST_NONE if not resolved
+ */
+AST_ADDRESS expr_get_address(const ASTPTR ast, const AST_EXPR_REF ex) {
+	return name_vector_at(&ast->name,
+			expr_vector_at(&ast->expr, ex)->operand.name)->address;
+}
+
+/**
+ * @brief stores resolved address of identifier expression
+ *
+ * @param ast AST
+ * @param ex identifier element
+ * @param address address of declaration
+ * @retval void
+ */
+void expr_set_address(ASTPTR ast, const AST_EXPR_REF ex,
+		const AST_ADDRESS address) {
+	name_vector_at(&ast->name, expr_vector_at(&ast->expr, ex)->operand.name)->address =
+			address;
+}
+
+/**
+ * @brief returns branch of unary or odd expression
+ *
+ * @param ast AST
+ * @param ex unary or odd element
+ * @retval AST_EXPR_REF branch
+ */
+AST_EXPR_REF expr_get_branch(const ASTPTR ast, const AST_EXPR_REF ex) {
+	(void) ast;
+
+	return ex - 1;
+}
+
+/**
+ * @brief opens scope whose declarations follow
+ *
+ * Declarations are added to the scope opened last, so the declarations of a
+ * block have to be made before the procedures inside it open their scopes.
+ *
+ * @param ast AST
+ * @param bl first block of scope
+ * @retval AST_SCOPE_REF new scope
+ */
+AST_SCOPE_REF block_init_scope(ASTPTR ast, const AST_BLOCK_REF bl) {
+	struct AST_SCOPE scope;
+
+	scope.block = bl;
+	scope.identifier = NO_SYMBOL;
+	scope.first = (unsigned int) decl_vector_size(&ast->decl);
+	scope.size = 0;
+	scope.depth = 0;
+	scope.parent = AST_NONE;
+	scope_vector_push(&ast->scope, scope);
+	return (AST_SCOPE_REF) scope_vector_size(&ast->scope) - 1;
+}
+
+/**
+ * @brief declares VAR or CONST in scope opened last
+ *
+ * @param ast AST
+ * @param s declared name
+ * @param kind VAR or CONST
+ * @retval void
+ */
+void scope_declare(ASTPTR ast, const SYMBOL s, const int kind) {
+	struct AST_DECL decl;
+
+	decl.identifier = s;
+	decl.kind = kind;
+	decl.value = 0;
+	decl_vector_push(&ast->decl, decl);
+	scope_vector_top(&ast->scope)->size++;
+}
+
+/**
+ * @brief sets value of constant declared last
+ *
+ * @param ast AST
+ * @param n value
+ * @retval void
+ */
+void scope_set_value(ASTPTR ast, const int n) {
+	decl_vector_top(&ast->decl)->value = n;
+}
+
+/**
+ * @brief sets procedure and position of scope, done by resolve()
+ *
+ * @param ast AST
+ * @param sc scope
+ * @param s procedure name, NO_SYMBOL for main program
+ * @param depth static nesting depth
+ * @param parent enclosing scope, AST_NONE for main program
+ * @retval void
+ */
+void scope_set_owner(ASTPTR ast, const AST_SCOPE_REF sc, const SYMBOL s,
+		const unsigned int depth, const AST_SCOPE_REF parent) {
+	struct AST_SCOPE *scope = scope_vector_at(&ast->scope, sc);
+
+	scope->identifier = s;
+	scope->depth = depth;
+	scope->parent = parent;
+}
+
+/**
+ * @brief number of scopes, main program and all procedures
+ *
+ * @param ast AST
+ * @retval size_t
+ */
+size_t ast_scopes(const ASTPTR ast) {
+	return scope_vector_size(&ast->scope);
+}
+
+/**
+ * @brief returns first block of scope
+ *
+ * @param ast AST
+ * @param sc scope
+ * @retval AST_BLOCK_REF
+ */
+AST_BLOCK_REF scope_get_block(const ASTPTR ast, const AST_SCOPE_REF sc) {
+	return scope_vector_at(&ast->scope, sc)->block;
+}
+
+/**
+ * @brief returns statement of scope, which follows its procedures
+ *
+ * @param ast AST
+ * @param sc scope
+ * @retval AST_STMT_REF statement or AST_NONE
+ */
+AST_STMT_REF scope_get_statement(const ASTPTR ast, const AST_SCOPE_REF sc) {
+	AST_BLOCK_REF bl = scope_vector_at(&ast->scope, sc)->block;
+
+	while (block_get_tag(ast, bl) == BLOCK_PROC)
+		bl = block_get_main(ast, bl);
+
+	return block_get_statement(ast, bl);
+}
+
+/**
+ * @brief returns procedure name of scope
+ *
+ * @param ast AST
+ * @param sc scope
+ * @retval SYMBOL name, NO_SYMBOL for main program
+ */
+SYMBOL scope_get_identifier(const ASTPTR ast, const AST_SCOPE_REF sc) {
+	return scope_vector_at(&ast->scope, sc)->identifier;
+}
+
+/**
+ * @brief returns static nesting depth of scope
+ *
+ * @param ast AST
+ * @param sc scope
+ * @retval unsigned int depth, 0 for main program
+ */
+unsigned int scope_get_depth(const ASTPTR ast, const AST_SCOPE_REF sc) {
+	return scope_vector_at(&ast->scope, sc)->depth;
+}
+
+/**
+ * @brief returns enclosing scope
+ *
+ * @param ast AST
+ * @param sc scope
+ * @retval AST_SCOPE_REF parent, AST_NONE for main program
+ */
+AST_SCOPE_REF scope_get_parent(const ASTPTR ast, const AST_SCOPE_REF sc) {
+	return scope_vector_at(&ast->scope, sc)->parent;
+}
+
+/**
+ * @brief returns number of declarations, which is the size of a frame
+ *
+ * @param ast AST
+ * @param sc scope
+ * @retval size_t
+ */
+size_t scope_get_size(const ASTPTR ast, const AST_SCOPE_REF sc) {
+	return scope_vector_at(&ast->scope, sc)->size;
+}
+
+/**
+ * @brief returns declaration in slot of scope
+ *
+ * @param ast AST
+ * @param sc scope
+ * @param slot slot of declaration
+ * @param *kind returns VAR or CONST
+ * @param *value returns value of constant
+ * @retval SYMBOL declared name
+ */
+SYMBOL scope_get_decl(const ASTPTR ast, const AST_SCOPE_REF sc,
+		const unsigned int slot, int *kind, int *value) {
+	const struct AST_DECL *decl = decl_vector_at(&ast->decl,
+			scope_vector_at(&ast->scope, sc)->first + slot);
+
+	*kind = decl->kind;
+	*value = decl->value;
+	return decl->identifier;
+}
+
+/**
+ * @brief returns i-th branch of a knot of any kind
+ *
+ * Branches are numbered from left to right the way they appear in the source:
+ * procedure block before following block, condition before statement, left
+ * side before right side.
+ *
+ * @param ast AST
+ * @param class one of ast_classes, class of knot
+ * @param ref knot
+ * @param i number of branch
+ * @param *child returns index of branch
+ * @retval int class of branch or -1 if knot has no i-th branch
+ */
+int ast_child(const ASTPTR ast, const int class, const unsigned int ref,
+		const size_t i, unsigned int *child) {
+	switch (class) {
+	case (AST_CLASS_BLOCK): {
+		const struct AST_BLOCK *knot = block_vector_at(&ast->block, ref);
+
+		if (knot->branch == AST_NONE)
+			return -1;
+
+		if (knot->tag == BLOCK_PROC) {
+			if (i > 1)
+				return -1;
+
+			*child = knot->branch + (unsigned int) i;
+			return AST_CLASS_BLOCK;
+		}
+
+		if (i > 0)
+			return -1;
+
+		*child = knot->branch;
+		return AST_CLASS_STMT;
+	}
+
+	case (AST_CLASS_STMT): {
+		const struct AST_STMT *knot = stmt_vector_at(&ast->stmt, ref);
+
+		switch (knot->tag) {
+		case (STMT_IF):
+		case (STMT_WHILE):
+			if (i > 1)
+				return -1;
+
+			*child = (i == 0) ? knot->branch : knot->operand;
+			return (i == 0) ? AST_CLASS_EXPR : AST_CLASS_STMT;
+
+		case (STMT_ASSIGN):
+		case (STMT_PRINT):
+			if (i > 0)
+				return -1;
+
+			*child = knot->branch;
+			return AST_CLASS_EXPR;
+
+		case (STMT_LIST):
+			if (i >= knot->operand)
+				return -1;
+
+			*child = *ref_vector_at(&ast->list, knot->branch + i);
+			return AST_CLASS_STMT;
+
+		default:
+			return -1;
+		}
+	}
+
+	case (AST_CLASS_EXPR): {
+		const struct AST_EXPR *knot = expr_vector_at(&ast->expr, ref);
+
+		switch (knot->tag) {
+		case (EXPR_ARITH):
+		case (EXPR_REL):
+			if (i > 1)
+				return -1;
+
+			*child = (i == 0) ? knot->operand.branch : ref - 1;
+			return AST_CLASS_EXPR;
+
+		case (EXPR_UNARY):
+		case (EXPR_ODD):
+			if (i > 0)
+				return -1;
+
+			*child = ref - 1;
+			return AST_CLASS_EXPR;
+
+		default:
+			return -1;
+		}
+	}
+
+	default:
+		return -1;
+	}
 }
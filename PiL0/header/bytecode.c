@@ -0,0 +1,810 @@
+/*
+ * PiL0 - PL0 Compiler for Raspberry PI
+ * Copyright (C) 2013  Philipp Wiesner
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file bytecode.c Library for emitting register bytecode from the AST
+ *
+ * The resolved and folded AST is translated scope by scope, the main program
+ * first, each procedure at the index resolve() gave it. Like the other
+ * passes nothing recurses on the C stack:
+ *
+ * - statements still to emit are tasks, IF and WHILE leave a task behind
+ *   which patches or emits their jump after the statement
+ * - expressions are emitted in post order from a stack of pending knots,
+ *   a second stack holds the register of every emitted branch
+ *
+ * VAR and CONST of the running scope and numbers are used in place, all
+ * other values get a temporary register. Temporaries are taken and released
+ * in stack order, so the frame of a scope needs as many as its deepest
+ * expression. Numbers get their registers after the temporaries, whose count
+ * is only known at the end of the scope: until then they are negative, and
+ * the operands naming them are patched. An assignment to a register makes the
+ * last instruction of its expression write to it directly instead of adding
+ * a MOVE.
+ *
+ * WHILE tests its condition at the end of the loop, entered by one JUMP, so
+ * every round runs a single conditional jump.
+ *
+ * Where the shapes allow, superinstructions replace what a VM built with
+ * -DPL_VM_PROFILE counts as the most frequent sequences: a relation as
+ * condition of IF or WHILE compares and jumps in one instruction, and
+ * x = x + y or x = x - n of an enclosing VAR adds in place with ADDS
+ * instead of LOAD, ADD and STORE. Numbers are registers already, so
+ * x = x + 1 of the running scope is one ADD without it.
+ *
+ * @defgroup bytecode Bytecode
+ * @brief register bytecode and its VM
+ * @ingroup bytecode
+ */
+
+#include"bytecode.h"
+
+#define __BYTECODE__ "Bytecode"
+#define NO_RESULT ((size_t) -1)
+
+/* numbers remembered per scope to give equal values one register */
+#define NUMBER_CACHE 64
+
+/**
+ * @enum emit_task_ids what a task on the task stack does
+ */
+enum emit_task_ids {
+	EMIT_STMT, 			/**< emit statement */
+	EMIT_LIST, 			/**< emit rest of list from entry a */
+	EMIT_PATCH, 		/**< let jump at word a go to the next instruction */
+	EMIT_TEST 			/**< patch loop entry at word a, test and jump back to b */
+};
+
+/**
+ * @struct EMIT_TASK
+ *
+ * @brief statement or jump still to emit
+ */
+struct EMIT_TASK {
+	unsigned char tag; 		/**< one of emit_task_ids */
+	AST_STMT_REF ref; 		/**< statement */
+	size_t a; 				/**< list entry or word index */
+	size_t b; 				/**< word index */
+};
+
+/**
+ * @struct EMIT_PENDING
+ *
+ * @brief expression whose branches are emitted before itself
+ */
+struct EMIT_PENDING {
+	AST_EXPR_REF ref; 		/**< expression */
+	int ready; 				/**< branches are emitted */
+};
+
+/**
+ * @struct NUMBER_REGISTER
+ *
+ * @brief number which has a register already
+ */
+struct NUMBER_REGISTER {
+	int value; 				/**< number */
+	int reg; 				/**< negative register, 0 if unused */
+};
+
+DEFINE_STACK(emit_task_stack, struct EMIT_TASK)
+DEFINE_STACK(emit_pending_stack, struct EMIT_PENDING)
+
+/**
+ * @struct EMITTER
+ *
+ * @brief state of the translation
+ */
+struct EMITTER {
+	ASTPTR ast; 						/**< resolved program */
+	BCPTR bc; 							/**< emitted program */
+	struct emit_task_stack tasks; 		/**< statements to emit */
+	struct emit_pending_stack pending; 	/**< expressions to emit */
+	struct word_vector registers; 		/**< registers of emitted branches */
+	struct word_vector numbers; 		/**< values of number registers of scope */
+	struct word_vector patch; 			/**< word indices of operands naming numbers */
+	struct NUMBER_REGISTER cache[NUMBER_CACHE]; /**< recently used numbers */
+	unsigned int size; 					/**< VAR and CONST cells of scope */
+	unsigned int depth; 				/**< static nesting depth of scope */
+	unsigned int temps; 				/**< temporaries in use */
+	unsigned int frame; 				/**< cells and most temporaries used at once */
+	size_t result; 						/**< last instruction if it wrote a temporary */
+};
+
+/**
+ * @brief initialize empty bytecode
+ *
+ * @retval BCPTR
+ */
+BCPTR init_bytecode() {
+	BCPTR bc = pl_malloc(sizeof(*bc));
+
+	if (bc == NULL)
+		ERROR_EXCEPT(__BYTECODE__, ERR_MEMORY);
+
+	word_vector_init(&bc->code);
+	procedure_vector_init(&bc->procedure);
+	word_vector_init(&bc->image);
+	line_vector_init(&bc->line);
+	bc->depth = 0;
+
+	/* frames are copied from the image even if no scope has cells */
+	word_vector_reserve(&bc->image, 1);
+	return bc;
+}
+
+/**
+ * @brief delete bytecode
+ *
+ * @param bc bytecode or NULL
+ * @retval void
+ */
+void free_bytecode(BCPTR bc) {
+	if (bc == NULL)
+		return;
+
+	word_vector_free(&bc->code);
+	procedure_vector_free(&bc->procedure);
+	word_vector_free(&bc->image);
+	line_vector_free(&bc->line);
+	free(bc);
+}
+
+/**
+ * @brief memory taken by instructions, procedures, initial cells and lines
+ *
+ * @param bc bytecode
+ * @retval size_t
+ */
+size_t bc_bytes(const BCPTR bc) {
+	return word_vector_size(&bc->code) * sizeof(int)
+			+ procedure_vector_size(&bc->procedure) * sizeof(struct BC_PROCEDURE)
+			+ word_vector_size(&bc->image) * sizeof(int)
+			+ line_vector_size(&bc->line) * sizeof(struct BC_LINE);
+}
+
+/**
+ * @brief source line of instruction
+ *
+ * @param bc bytecode
+ * @param pc word index of instruction
+ * @retval size_t line, 0 if unknown
+ */
+size_t bc_line(const BCPTR bc, const size_t pc) {
+	size_t low = 0, high = line_vector_size(&bc->line);
+
+	/* last entry starting at or before pc */
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+
+		if (line_vector_at(&bc->line, mid)->pc <= pc)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return (low > 0) ? line_vector_at(&bc->line, low - 1)->line : 0;
+}
+
+/**
+ * @brief print listing of all procedures
+ *
+ * @param bc bytecode
+ * @param out stream
+ * @retval void
+ */
+void bc_print(const BCPTR bc, FILE *out) {
+	size_t p = 0, pc = 0, n = word_vector_size(&bc->code);
+
+	while (pc < n) {
+		int op = bc->code.data[pc];
+		unsigned int i;
+
+		if (p < procedure_vector_size(&bc->procedure)
+				&& procedure_vector_at(&bc->procedure, p)->entry == pc) {
+			const struct BC_PROCEDURE *proc = procedure_vector_at(&bc->procedure, p);
+
+			fprintf(out, "procedure %lu: depth %u, cells %u, frame %u\n",
+					(unsigned long) p, proc->depth, proc->size, proc->frame);
+			p++;
+		}
+
+		fprintf(out, "%8lu  %-8s", (unsigned long) pc, bc_names[op]);
+
+		for (i = 1; i <= bc_operands[op]; i++)
+			fprintf(out, " %d", bc->code.data[pc + i]);
+
+		fputc('\n', out);
+		pc += 1 + bc_operands[op];
+	}
+}
+
+/**
+ * @brief append instruction
+ *
+ * Operands beyond the count of the opcode are ignored. Negative register
+ * operands name numbers and are patched at the end of the scope.
+ *
+ * @param *e emitter
+ * @param op one of opcodes
+ * @param a first operand
+ * @param b second operand
+ * @param c third operand
+ * @retval size_t word index of instruction
+ */
+static size_t emit(struct EMITTER *e, const int op, const int a, const int b,
+		const int c) {
+	struct word_vector *code = &e->bc->code;
+	size_t pc = word_vector_size(code);
+	int operand[3];
+	unsigned int i;
+
+	operand[0] = a;
+	operand[1] = b;
+	operand[2] = c;
+	word_vector_push(code, op);
+
+	for (i = 0; i < bc_operands[op]; i++) {
+		if ((bc_registers[op] >> i & 1) && operand[i] < 0) {
+			word_vector_push(&e->patch, (int) word_vector_size(code));
+			operand[i] = -operand[i] - 1;
+		}
+
+		word_vector_push(code, operand[i]);
+	}
+
+	e->result = NO_RESULT;
+	return pc;
+}
+
+/**
+ * @brief take next temporary
+ *
+ * @param *e emitter
+ * @retval int register
+ */
+static int take(struct EMITTER *e) {
+	int reg = (int) (e->size + e->temps++);
+
+	if (e->size + e->temps > e->frame)
+		e->frame = e->size + e->temps;
+
+	return reg;
+}
+
+/**
+ * @brief give back register if it is a temporary, in reverse order of taking
+ *
+ * @param *e emitter
+ * @param reg register
+ * @retval void
+ */
+static void release(struct EMITTER *e, const int reg) {
+	if (reg >= (int) e->size)
+		e->temps--;
+}
+
+/**
+ * @brief register of number
+ *
+ * @param *e emitter
+ * @param value number
+ * @retval int negative register, the n-th number of the scope is -n
+ */
+static int number(struct EMITTER *e, const int value) {
+	struct NUMBER_REGISTER *cached = &e->cache[(unsigned int) value % NUMBER_CACHE];
+
+	if (cached->reg == 0 || cached->value != value) {
+		word_vector_push(&e->numbers, value);
+		cached->value = value;
+		cached->reg = -(int) word_vector_size(&e->numbers);
+	}
+
+	return cached->reg;
+}
+
+/**
+ * @brief emit instruction writing a new temporary and remember it as result
+ *
+ * @param *e emitter
+ * @param op one of opcodes, first operand is the target
+ * @param b second operand
+ * @param c third operand
+ * @retval int target register
+ */
+static int produce(struct EMITTER *e, const int op, const int b, const int c) {
+	int reg = take(e);
+	size_t pc = emit(e, op, reg, b, c);
+
+	e->result = pc;
+	return reg;
+}
+
+/**
+ * @brief opcode of arithmetic or compare operator
+ *
+ * @param op operator of EXPR_ARITH or EXPR_REL
+ * @retval int one of opcodes
+ */
+static int opcode(const int op) {
+	switch (op) {
+	case ('+'):
+		return OP_ADD;
+	case ('-'):
+		return OP_SUB;
+	case ('*'):
+		return OP_MUL;
+	case ('/'):
+		return OP_DIV;
+	case ('<'):
+		return OP_LT;
+	case ('>'):
+		return OP_GT;
+	case (EQ):
+		return OP_EQ;
+	case (NE):
+		return OP_NE;
+	case (LE):
+		return OP_LE;
+	default:
+		return OP_GE;
+	}
+}
+
+/**
+ * @brief compare-and-branch opcode of compare opcode
+ *
+ * @param op one of OP_EQ to OP_GE
+ * @param holds jump if the relation holds, else if it fails
+ * @retval int one of OP_JEQ to OP_JGE
+ */
+static int branch(const int op, const int holds) {
+	static const unsigned char fails[] = { OP_JNE, OP_JEQ, OP_JGE, OP_JGT,
+			OP_JLE, OP_JLT };
+
+	return holds ? OP_JEQ + (op - OP_EQ) : fails[op - OP_EQ];
+}
+
+/**
+ * @brief push expression on pending stack
+ *
+ * @param *e emitter
+ * @param ex expression
+ * @param ready branches are emitted already
+ * @retval void
+ */
+static void pend(struct EMITTER *e, const AST_EXPR_REF ex, const int ready) {
+	struct EMIT_PENDING p;
+
+	p.ref = ex;
+	p.ready = ready;
+	emit_pending_stack_push(&e->pending, p);
+}
+
+/**
+ * @brief emit expression
+ *
+ * @param *e emitter
+ * @param ex expression
+ * @retval int register holding the value: temporary, cell or number
+ */
+static int emit_expr(struct EMITTER *e, const AST_EXPR_REF ex) {
+	ASTPTR ast = e->ast;
+	AST_ADDRESS address;
+	int a, b;
+
+	pend(e, ex, 0);
+
+	while (!emit_pending_stack_empty(&e->pending)) {
+		struct EMIT_PENDING p = emit_pending_stack_pop(&e->pending);
+		int tag = expr_get_tag(ast, p.ref);
+
+		switch (tag) {
+		case (EXPR_NUMBER):
+			word_vector_push(&e->registers, number(e, expr_get_number(ast, p.ref)));
+			break;
+
+		case (EXPR_IDENTIFIER):
+			address = expr_get_address(ast, p.ref);
+
+			if (address.depth == e->depth)
+				word_vector_push(&e->registers, (int) address.slot);
+			else
+				word_vector_push(&e->registers, produce(e, OP_LOAD,
+						(int) address.depth, (int) address.slot));
+			break;
+
+		case (EXPR_ARITH):
+		case (EXPR_REL):
+			if (!p.ready) {
+				pend(e, p.ref, 1);
+				pend(e, expr_get_branch(ast, p.ref), 0);
+				pend(e, (tag == EXPR_ARITH) ?
+						expr_get_arithmetic_left(ast, p.ref) :
+						expr_get_relation_left(ast, p.ref), 0);
+				break;
+			}
+
+			b = word_vector_pop(&e->registers);
+			a = word_vector_pop(&e->registers);
+			release(e, b);
+			release(e, a);
+			word_vector_push(&e->registers,
+					produce(e, opcode(expr_get_operator(ast, p.ref)), a, b));
+			break;
+
+		case (EXPR_UNARY):
+		case (EXPR_ODD):
+			if (!p.ready) {
+				pend(e, p.ref, 1);
+				pend(e, expr_get_branch(ast, p.ref), 0);
+				break;
+			}
+
+			a = word_vector_pop(&e->registers);
+			release(e, a);
+			word_vector_push(&e->registers, produce(e,
+					(tag == EXPR_UNARY) ? OP_NEG : OP_ODD, a, 0));
+			break;
+		}
+	}
+
+	return word_vector_pop(&e->registers);
+}
+
+/**
+ * @brief store value of register in VAR
+ *
+ * @param *e emitter
+ * @param address VAR
+ * @param reg register holding the value, released afterwards
+ * @retval void
+ */
+static void emit_store(struct EMITTER *e, const AST_ADDRESS address,
+		const int reg) {
+	size_t result = e->result;
+
+	release(e, reg);
+
+	if (address.depth != e->depth)
+		emit(e, OP_STORE, (int) address.depth, (int) address.slot, reg);
+
+	/* the instruction computing the value writes the cell itself */
+	else if (reg >= (int) e->size && result != NO_RESULT
+			&& e->bc->code.data[result + 1] == reg) {
+		e->bc->code.data[result + 1] = (int) address.slot;
+		e->result = NO_RESULT;
+	}
+
+	else if (reg != (int) address.slot)
+		emit(e, OP_MOVE, (int) address.slot, reg, 0);
+}
+
+/**
+ * @brief emit conditional jump
+ *
+ * A relation compares its sides in the jump itself.
+ *
+ * @param *e emitter
+ * @param cond condition
+ * @param holds jump if condition holds, else if it fails
+ * @param target word index to jump to, 0 if patched later
+ * @retval size_t word index of the target operand
+ */
+static size_t emit_branch(struct EMITTER *e, const AST_EXPR_REF cond,
+		const int holds, const size_t target) {
+	ASTPTR ast = e->ast;
+	int a, b;
+
+	if (expr_get_tag(ast, cond) == EXPR_REL) {
+		a = emit_expr(e, expr_get_relation_left(ast, cond));
+		b = emit_expr(e, expr_get_branch(ast, cond));
+		release(e, b);
+		release(e, a);
+		return emit(e, branch(opcode(expr_get_operator(ast, cond)), holds),
+				a, b, (int) target) + 3;
+	}
+
+	a = emit_expr(e, cond);
+	release(e, a);
+	return emit(e, holds ? OP_JUMPT : OP_JUMPF, a, (int) target, 0) + 2;
+}
+
+/**
+ * @brief emit x = x + y or x = x - n of an enclosing VAR as ADDS
+ *
+ * @param *e emitter
+ * @param st assignment
+ * @retval int 0 if the assignment has another shape and nothing was emitted
+ */
+static int emit_increment(struct EMITTER *e, const AST_STMT_REF st) {
+	ASTPTR ast = e->ast;
+	AST_ADDRESS address = stmt_get_address(ast, st), left;
+	AST_EXPR_REF ex = stmt_get_expression(ast, st), right;
+	int reg, value;
+
+	if (address.depth == e->depth || expr_get_tag(ast, ex) != EXPR_ARITH
+			|| expr_get_tag(ast, expr_get_arithmetic_left(ast, ex))
+					!= EXPR_IDENTIFIER)
+		return 0;
+
+	left = expr_get_address(ast, expr_get_arithmetic_left(ast, ex));
+	right = expr_get_branch(ast, ex);
+
+	if (left.depth != address.depth || left.slot != address.slot)
+		return 0;
+
+	if (expr_get_operator(ast, ex) == '+')
+		reg = emit_expr(e, right);
+	else if (expr_get_operator(ast, ex) == '-'
+			&& expr_get_tag(ast, right) == EXPR_NUMBER
+			&& fold_arithmetic('-', 0, expr_get_number(ast, right), &value))
+		reg = number(e, value);
+	else
+		return 0;
+
+	release(e, reg);
+	emit(e, OP_ADDS, (int) address.depth, (int) address.slot, reg);
+	return 1;
+}
+
+/**
+ * @brief remember source line of instructions emitted next
+ *
+ * @param *e emitter
+ * @param line source line
+ * @retval void
+ */
+static void mark_line(struct EMITTER *e, const size_t line) {
+	struct line_vector *lines = &e->bc->line;
+	struct BC_LINE mark;
+
+	mark.pc = word_vector_size(&e->bc->code);
+	mark.line = line;
+
+	if (!line_vector_empty(lines) && line_vector_top(lines)->pc == mark.pc)
+		line_vector_pop(lines);
+
+	if (line_vector_empty(lines) || line_vector_top(lines)->line != line)
+		line_vector_push(lines, mark);
+}
+
+/**
+ * @brief push task on task stack
+ *
+ * @param *e emitter
+ * @param tag one of emit_task_ids
+ * @param st statement
+ * @param a list entry or word index
+ * @param b word index
+ * @retval void
+ */
+static void schedule(struct EMITTER *e, const int tag, const AST_STMT_REF st,
+		const size_t a, const size_t b) {
+	struct EMIT_TASK t;
+
+	t.tag = (unsigned char) tag;
+	t.ref = st;
+	t.a = a;
+	t.b = b;
+	emit_task_stack_push(&e->tasks, t);
+}
+
+/**
+ * @brief emit statement or schedule its parts
+ *
+ * @param *e emitter
+ * @param st statement
+ * @retval void
+ */
+static void emit_stmt(struct EMITTER *e, const AST_STMT_REF st) {
+	ASTPTR ast = e->ast;
+	const AST_STMT_REF *list;
+	AST_ADDRESS address;
+	size_t count, pc;
+	int reg;
+
+	if (stmt_get_tag(ast, st) != STMT_LIST && stmt_get_tag(ast, st) != STMT_PASS)
+		mark_line(e, stmt_get_line(ast, st));
+
+	switch (stmt_get_tag(ast, st)) {
+	case (STMT_IF):
+		pc = emit_branch(e, stmt_get_jumpfor_condition(ast, st), 0, 0);
+		schedule(e, EMIT_PATCH, st, pc, 0);
+		schedule(e, EMIT_STMT, stmt_get_jumpfor_statement(ast, st), 0, 0);
+		break;
+
+	case (STMT_WHILE):
+		pc = emit(e, OP_JUMP, 0, 0, 0);
+		schedule(e, EMIT_TEST, st, pc + 1, word_vector_size(&e->bc->code));
+		schedule(e, EMIT_STMT, stmt_get_jumpbac_statement(ast, st), 0, 0);
+		break;
+
+	case (STMT_ASSIGN):
+		if (emit_increment(e, st))
+			break;
+
+		reg = emit_expr(e, stmt_get_expression(ast, st));
+		emit_store(e, stmt_get_address(ast, st), reg);
+		break;
+
+	case (STMT_LIST):
+		list = stmt_get_list(ast, st, &count);
+
+		if (count > 1)
+			schedule(e, EMIT_LIST, st, 1, 0);
+
+		if (count > 0)
+			schedule(e, EMIT_STMT, list[0], 0, 0);
+		break;
+
+	case (STMT_CARE):
+		address = stmt_get_address(ast, st);
+
+		if (stmt_get_care(ast, st) == CALL)
+			emit(e, OP_CALL, (int) address.slot, 0, 0);
+		else if (address.depth == e->depth)
+			emit(e, OP_READ, (int) address.slot, 0, 0);
+		else {
+			reg = take(e);
+			emit(e, OP_READ, reg, 0, 0);
+			emit_store(e, address, reg);
+		}
+		break;
+
+	case (STMT_PRINT):
+		reg = emit_expr(e, stmt_get_expression(ast, st));
+		release(e, reg);
+		emit(e, OP_PRINT, reg, 0, 0);
+		break;
+	}
+}
+
+/**
+ * @brief emit statement of scope and its scheduled parts
+ *
+ * @param *e emitter
+ * @param st statement
+ * @retval void
+ */
+static void emit_body(struct EMITTER *e, const AST_STMT_REF st) {
+	const AST_STMT_REF *list;
+	size_t count;
+
+	schedule(e, EMIT_STMT, st, 0, 0);
+
+	while (!emit_task_stack_empty(&e->tasks)) {
+		struct EMIT_TASK t = emit_task_stack_pop(&e->tasks);
+
+		switch (t.tag) {
+		case (EMIT_STMT):
+			emit_stmt(e, t.ref);
+			break;
+
+		case (EMIT_LIST):
+			list = stmt_get_list(e->ast, t.ref, &count);
+
+			if (t.a + 1 < count)
+				schedule(e, EMIT_LIST, t.ref, t.a + 1, 0);
+
+			schedule(e, EMIT_STMT, list[t.a], 0, 0);
+			break;
+
+		case (EMIT_PATCH):
+			e->bc->code.data[t.a] = (int) word_vector_size(&e->bc->code);
+			break;
+
+		case (EMIT_TEST):
+			e->bc->code.data[t.a] = (int) word_vector_size(&e->bc->code);
+			mark_line(e, stmt_get_line(e->ast, t.ref));
+			emit_branch(e, stmt_get_jumpbac_condition(e->ast, t.ref), 1, t.b);
+			break;
+		}
+	}
+}
+
+/**
+ * @brief emit procedure of scope
+ *
+ * @param *e emitter
+ * @param sc scope, the main program ends with HALT, procedures with RET
+ * @retval void
+ */
+static void emit_scope(struct EMITTER *e, const AST_SCOPE_REF sc) {
+	struct BC_PROCEDURE proc;
+	AST_STMT_REF st = scope_get_statement(e->ast, sc);
+	unsigned int slot;
+	int kind, value;
+
+	proc.entry = word_vector_size(&e->bc->code);
+	proc.image = word_vector_size(&e->bc->image);
+	proc.size = (unsigned int) scope_get_size(e->ast, sc);
+	proc.depth = scope_get_depth(e->ast, sc);
+
+	for (slot = 0; slot < proc.size; slot++) {
+		scope_get_decl(e->ast, sc, slot, &kind, &value);
+		word_vector_push(&e->bc->image, (kind == CONST) ? value : 0);
+	}
+
+	e->size = e->frame = proc.size;
+	e->depth = proc.depth;
+	e->temps = 0;
+	word_vector_truncate(&e->numbers, 0);
+	word_vector_truncate(&e->patch, 0);
+	memset(e->cache, 0, sizeof(e->cache));
+
+	if (st != AST_NONE)
+		emit_body(e, st);
+
+	emit(e, (sc == 0) ? OP_HALT : OP_RET, 0, 0, 0);
+
+	/* numbers follow the temporaries */
+	for (slot = 0; slot < word_vector_size(&e->patch); slot++)
+		e->bc->code.data[e->patch.data[slot]] += (int) e->frame;
+
+	word_vector_resize(&e->bc->image, proc.image + e->frame, 0);
+
+	for (slot = 0; slot < word_vector_size(&e->numbers); slot++)
+		word_vector_push(&e->bc->image, e->numbers.data[slot]);
+
+	proc.frame = e->frame + (unsigned int) word_vector_size(&e->numbers);
+	procedure_vector_push(&e->bc->procedure, proc);
+
+	if (proc.depth > e->bc->depth)
+		e->bc->depth = proc.depth;
+}
+
+/**
+ * @brief emit bytecode of resolved program and attach it to source code object
+ *
+ * @param code pointer to source code object
+ * @retval void
+ */
+void emit_bytecode(SOURCECODE code) {
+	struct EMITTER e;
+	DIAG_FRAME frame;
+	AST_SCOPE_REF sc;
+	int status;
+
+	e.ast = sc_get_ast(code);
+	e.bc = init_bytecode();
+	e.result = NO_RESULT;
+	sc_set_bc(code, e.bc);
+	emit_task_stack_init(&e.tasks);
+	emit_pending_stack_init(&e.pending);
+	word_vector_init(&e.registers);
+	word_vector_init(&e.numbers);
+	word_vector_init(&e.patch);
+
+	/* release the stacks before an error unwinds further */
+	diag_push(&frame, NULL, NULL);
+
+	if ((status = setjmp(frame.unwind)) == 0)
+		for (sc = 0; sc < ast_scopes(e.ast); sc++)
+			emit_scope(&e, sc);
+
+	diag_pop(&frame);
+	emit_task_stack_free(&e.tasks);
+	emit_pending_stack_free(&e.pending);
+	word_vector_free(&e.registers);
+	word_vector_free(&e.numbers);
+	word_vector_free(&e.patch);
+
+	if (status != COMPILE_OK)
+		diag_raise(NULL, status);
+}
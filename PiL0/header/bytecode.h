@@ -0,0 +1,148 @@
+/*
+ * PiL0 - PL0 Compiler for Raspberry PI
+ * Copyright (C) 2013  Philipp Wiesner
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file bytecode.h Header-File for bytecode shared by emitter and VM
+ *
+ * A program is one array of int words. Every instruction is an opcode word
+ * followed by a fixed number of operand words; jump targets are word indices
+ * into the array. Operands name registers of the running frame, which holds
+ * in this order
+ *
+ * - the VAR and CONST cells of the scope in slot order
+ * - the temporaries of expressions
+ * - the numbers the scope uses, each value once
+ *
+ * and is copied from the image of the procedure on every CALL, so no
+ * instruction loads a number. VAR and CONST of enclosing scopes are reached
+ * by LOAD and STORE with nesting depth and slot.
+ *
+ * BC_OPCODES lists every instruction once, the enum, the tables below and
+ * the handlers of the VM are all generated from it.
+ *
+ * @ingroup bytecode
+ */
+
+#ifndef __BYTECODE_H
+#define __BYTECODE_H
+#include"frontend.h"
+#include"containers.h"
+
+/**
+ * @def BC_OPCODES(X)
+ * @brief X(name, operands, registers) for every instruction
+ *
+ * registers has bit i set if operand i + 1 names a register.
+ *
+ * - MOVE a b: a = b
+ * - LOAD a d s: a = slot s of frame at depth d; STORE d s b: slot = b
+ * - ADD, SUB, MUL, DIV, EQ, NE, LT, LE, GT, GE a b c: a = b op c
+ * - NEG, ODD a b: a = -b, a = b is odd
+ * - JUMP t; JUMPF a t / JUMPT a t: jump to t if a is zero / not zero
+ * - CALL p: run procedure with index p; RET: return from it
+ * - READ a, PRINT a; HALT ends the main program
+ *
+ * Superinstructions replace the most frequent pairs and triples counted by
+ * a VM built with -DPL_VM_PROFILE:
+ *
+ * - JEQ, JNE, JLT, JLE, JGT, JGE a b t: jump to t if a op b, for the
+ *   condition of IF and WHILE instead of compare and JUMPF / JUMPT
+ * - ADDS d s b: slot s of frame at depth d += b, for x = x + y and x = x - n
+ *   of an enclosing VAR instead of LOAD, ADD and STORE
+ */
+#define BC_OPCODES(X) \
+	X(MOVE, 2, 3) X(LOAD, 3, 1) X(STORE, 3, 4) \
+	X(ADD, 3, 7) X(SUB, 3, 7) X(MUL, 3, 7) X(DIV, 3, 7) X(NEG, 2, 3) X(ODD, 2, 3) \
+	X(EQ, 3, 7) X(NE, 3, 7) X(LT, 3, 7) X(LE, 3, 7) X(GT, 3, 7) X(GE, 3, 7) \
+	X(JUMP, 1, 0) X(JUMPF, 2, 1) X(JUMPT, 2, 1) \
+	X(CALL, 1, 0) X(RET, 0, 0) X(READ, 1, 1) X(PRINT, 1, 1) X(HALT, 0, 0) \
+	X(JEQ, 3, 3) X(JNE, 3, 3) X(JLT, 3, 3) X(JLE, 3, 3) X(JGT, 3, 3) X(JGE, 3, 3) \
+	X(ADDS, 3, 4)
+
+#define BC_ENUM(name, operands, registers) OP_##name,
+#define BC_OPERANDS(name, operands, registers) operands,
+#define BC_REGISTERS(name, operands, registers) registers,
+#define BC_NAME(name, operands, registers) #name,
+
+/**
+ * @enum opcodes opcode words of instructions
+ */
+enum opcodes {
+	BC_OPCODES(BC_ENUM)
+	OPCODES
+};
+
+/**
+ * @var unsigned char bc_operands[]
+ * @brief number of operand words following every opcode
+ **/
+static const unsigned char bc_operands[OPCODES] = { BC_OPCODES(BC_OPERANDS) };
+
+/**
+ * @var unsigned char bc_registers[]
+ * @brief operands naming registers, bit i for operand i + 1
+ **/
+static const unsigned char bc_registers[OPCODES] = { BC_OPCODES(BC_REGISTERS) };
+
+/**
+ * @var char *bc_names[]
+ * @brief Stringtable of opcode names for listings
+ **/
+static const char *const bc_names[OPCODES] = { BC_OPCODES(BC_NAME) };
+
+/**
+ * @struct BC_PROCEDURE
+ *
+ * @brief what a CALL needs to know of a procedure, index 0 is the main program
+ */
+struct BC_PROCEDURE {
+	size_t entry; 			/**< word index of first instruction */
+	size_t image; 			/**< initial frame in image */
+	unsigned int size; 		/**< VAR and CONST cells */
+	unsigned int frame; 	/**< cells, temporaries and numbers */
+	unsigned int depth; 	/**< static nesting depth */
+};
+
+/**
+ * @struct BC_LINE
+ *
+ * @brief first instruction of a source line, for reporting errors
+ */
+struct BC_LINE {
+	size_t pc; 				/**< word index */
+	size_t line; 			/**< source line */
+};
+
+DEFINE_VECTOR(word_vector, int)
+DEFINE_VECTOR(procedure_vector, struct BC_PROCEDURE)
+DEFINE_VECTOR(line_vector, struct BC_LINE)
+
+/**
+ * @struct BYTECODE
+ *
+ * @brief emitted program
+ */
+struct BYTECODE {
+	struct word_vector code; 			/**< instructions */
+	struct procedure_vector procedure; 	/**< procedures by index */
+	struct word_vector image; 			/**< initial frames: VAR and temporaries 0, CONST and numbers their value */
+	struct line_vector line; 			/**< source lines by word index */
+	unsigned int depth; 				/**< deepest static nesting */
+};
+
+#endif
@@ -0,0 +1,264 @@
+/*
+ * PiL0 - PL0 Compiler for Raspberry PI
+ * Copyright (C) 2013  Philipp Wiesner
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file containers.h Type specialized containers generated by macros
+ *
+ * Unlike the meta list based STACK and QUEUE, elements are stored by value in
+ * one array and every instantiation gets its own functions, so the compiler
+ * can inline element copies and comparisons.
+ *
+ *     DEFINE_VECTOR(int_vector, int)
+ *
+ * defines struct int_vector and the functions int_vector_init(),
+ * int_vector_push(), int_vector_pop() and so on. The struct can be embedded
+ * into other structs or used as local variable; it has to be initialized with
+ * name_init() and released with name_free().
+ *
+ * @defgroup containers Containers
+ * @brief vector, stack and ring buffer deque for any element type
+ * @ingroup meta_data containers
+ */
+
+#ifndef __CONTAINERS_H
+#define __CONTAINERS_H
+
+#include"err_handling.h"
+#include<stdlib.h>
+#include<string.h>
+
+#define CONTAINER_INIT 16
+
+#if defined(__GNUC__)
+#define CONTAINER_API static __inline__
+#elif __STDC_VERSION__ >= 199901L
+#define CONTAINER_API static inline
+#else
+#define CONTAINER_API static
+#endif
+
+/**
+ * @def DEFINE_VECTOR(name, type)
+ * @brief growing array of type
+ *
+ * - name_init(v), name_free(v)
+ * - name_reserve(v, n) makes room for n elements
+ * - name_resize(v, n, e) sets size to n, new elements are copies of e
+ * - name_push(v, e) appends e and returns pointer to it
+ * - name_pop(v) removes and returns last element
+ * - name_top(v), name_at(v, i) pointer to last / i-th element
+ * - name_size(v), name_empty(v), name_truncate(v, n)
+ *
+ * Pointers to elements stay valid until the vector grows.
+ */
+#define DEFINE_VECTOR(name, type) \
+struct name { \
+	type *data; \
+	size_t size; \
+	size_t capacity; \
+}; \
+\
+CONTAINER_API void name##_init(struct name *v) { \
+	v->data = NULL; \
+	v->size = v->capacity = 0; \
+} \
+\
+CONTAINER_API void name##_free(struct name *v) { \
+	free(v->data); \
+	name##_init(v); \
+} \
+\
+CONTAINER_API void name##_reserve(struct name *v, const size_t n) { \
+	type *data; \
+	size_t capacity = (v->capacity > 0) ? v->capacity : CONTAINER_INIT; \
+\
+	if (n <= v->capacity) \
+		return; \
+\
+	while (capacity < n) \
+		capacity *= 2; \
+\
+	if ((data = pl_realloc(v->data, capacity * sizeof(*data))) == NULL) \
+		error(#name, __FILE__, __func__, __LINE__, ERR_MEMORY); \
+\
+	v->data = data; \
+	v->capacity = capacity; \
+} \
+\
+CONTAINER_API void name##_resize(struct name *v, const size_t n, type e) { \
+	name##_reserve(v, n); \
+\
+	while (v->size < n) \
+		v->data[v->size++] = e; \
+\
+	v->size = n; \
+} \
+\
+CONTAINER_API type *name##_push(struct name *v, type e) { \
+	if (v->size == v->capacity) \
+		name##_reserve(v, v->size + 1); \
+\
+	v->data[v->size] = e; \
+	return &v->data[v->size++]; \
+} \
+\
+CONTAINER_API type name##_pop(struct name *v) { \
+	return v->data[--v->size]; \
+} \
+\
+CONTAINER_API type *name##_top(const struct name *v) { \
+	return &v->data[v->size - 1]; \
+} \
+\
+CONTAINER_API type *name##_at(const struct name *v, const size_t i) { \
+	return &v->data[i]; \
+} \
+\
+CONTAINER_API size_t name##_size(const struct name *v) { \
+	return v->size; \
+} \
+\
+CONTAINER_API int name##_empty(const struct name *v) { \
+	return v->size == 0; \
+} \
+\
+CONTAINER_API void name##_truncate(struct name *v, const size_t n) { \
+	if (n < v->size) \
+		v->size = n; \
+}
+
+/**
+ * @def DEFINE_STACK(name, type)
+ * @brief LIFO of type, a vector used through push, pop and top
+ */
+#define DEFINE_STACK(name, type) DEFINE_VECTOR(name, type)
+
+/**
+ * @def DEFINE_VECTOR_SEARCH(name, type, key_type, MATCH)
+ * @brief name_search(v, key) for a vector defined with DEFINE_VECTOR(name, type)
+ *
+ * Searches from the last element to the first, like linst() on a stack, and
+ * returns a pointer to the first element for which MATCH(element pointer, key)
+ * is true or NULL. MATCH is expanded in place, so no function is called per element.
+ */
+#define DEFINE_VECTOR_SEARCH(name, type, key_type, MATCH) \
+CONTAINER_API type *name##_search(const struct name *v, key_type key) { \
+	size_t i = v->size; \
+\
+	while (i-- > 0) \
+		if (MATCH(&v->data[i], key)) \
+			return &v->data[i]; \
+\
+	return NULL; \
+}
+
+/**
+ * @def DEFINE_DEQUE(name, type)
+ * @brief ring buffer of type with power of two capacity
+ *
+ * - name_init(d), name_free(d)
+ * - name_push_back(d, e), name_push_front(d, e)
+ * - name_pop_back(d), name_pop_front(d) remove and return element
+ * - name_front(d), name_back(d), name_at(d, i) pointer to element
+ * - name_size(d), name_empty(d)
+ *
+ * Used as queue with push_back and pop_front.
+ */
+#define DEFINE_DEQUE(name, type) \
+struct name { \
+	type *data; \
+	size_t head; \
+	size_t size; \
+	size_t capacity; \
+}; \
+\
+CONTAINER_API void name##_init(struct name *d) { \
+	d->data = NULL; \
+	d->head = d->size = d->capacity = 0; \
+} \
+\
+CONTAINER_API void name##_free(struct name *d) { \
+	free(d->data); \
+	name##_init(d); \
+} \
+\
+CONTAINER_API void name##_grow(struct name *d) { \
+	type *data; \
+	size_t capacity = (d->capacity > 0) ? d->capacity * 2 : CONTAINER_INIT; \
+\
+	if ((data = pl_realloc(d->data, capacity * sizeof(*data))) == NULL) \
+		error(#name, __FILE__, __func__, __LINE__, ERR_MEMORY); \
+\
+	/* move wrapped around elements behind the old end */ \
+	if (d->head + d->size > d->capacity) \
+		memcpy(data + d->capacity, data, \
+				(d->head + d->size - d->capacity) * sizeof(*data)); \
+\
+	d->data = data; \
+	d->capacity = capacity; \
+} \
+\
+CONTAINER_API type *name##_at(const struct name *d, const size_t i) { \
+	return &d->data[(d->head + i) & (d->capacity - 1)]; \
+} \
+\
+CONTAINER_API void name##_push_back(struct name *d, type e) { \
+	if (d->size == d->capacity) \
+		name##_grow(d); \
+\
+	d->data[(d->head + d->size++) & (d->capacity - 1)] = e; \
+} \
+\
+CONTAINER_API void name##_push_front(struct name *d, type e) { \
+	if (d->size == d->capacity) \
+		name##_grow(d); \
+\
+	d->head = (d->head - 1) & (d->capacity - 1); \
+	d->data[d->head] = e; \
+	d->size++; \
+} \
+\
+CONTAINER_API type name##_pop_front(struct name *d) { \
+	type e = d->data[d->head]; \
+\
+	d->head = (d->head + 1) & (d->capacity - 1); \
+	d->size--; \
+	return e; \
+} \
+\
+CONTAINER_API type name##_pop_back(struct name *d) { \
+	return d->data[(d->head + --d->size) & (d->capacity - 1)]; \
+} \
+\
+CONTAINER_API type *name##_front(const struct name *d) { \
+	return &d->data[d->head]; \
+} \
+\
+CONTAINER_API type *name##_back(const struct name *d) { \
+	return name##_at(d, d->size - 1); \
+} \
+\
+CONTAINER_API size_t name##_size(const struct name *d) { \
+	return d->size; \
+} \
+\
+CONTAINER_API int name##_empty(const struct name *d) { \
+	return d->size == 0; \
+}
+
+#endif
@@ -21,12 +21,18 @@
  *
  * Error handling for PiL0-Compiler
  *
+ * Errors never end the program while compiling: they are passed to the
+ * diagnostic sink of the compilation and unwind with longjmp() to the frame
+ * the compilation pushed, so one process can compile many programs, also on
+ * several threads at once.
+ *
  * @ingroup error_handling
  */
 
 #include "err_handling.h"
 #include<stdio.h>
 #include<stdlib.h>
+#include<setjmp.h>
 
 /**
  * @var char *err_msg[]
@@ -51,15 +57,125 @@ static const char *parse_err_msg[] =
 				"Syntax-Error: Wrong syntax in statement",
 				"Syntax-Error: No compare operator",
 				"Syntax-Error: Missing ')'", "Syntax-Error: Missing '('",
+				"Syntax-Error: Number too large",
 				"Type-Error: Can only assign number to constant",
 				"Type-Error: Identifier not initialized",
 				"Type-Error: No identifier given",
 				"Type-Error: Can only call a procedure",
 				"Type-Error: Operation only for Integer type",
-				"Type-Error: Double declaration of identifier" };
+				"Type-Error: Double declaration of identifier",
+				"Type-Error: Can not assign value to constant" };
+
+/**
+ * @var char *run_err_msg[]
+ * @brief Stringtable which stores all error messages of running programs
+ **/
+static const char *run_err_msg[] = { "Runtime-Error: Division by zero",
+		"Runtime-Error: Division overflows",
+		"Runtime-Error: READ expects a number",
+		"Runtime-Error: Too many nested procedure calls" };
+
+/* lexer threads of one compilation share its counter */
+#if defined(__GNUC__)
+#define ALLOC_ADD(field, n) __sync_fetch_and_add(&(field), (n))
+#else
+#define ALLOC_ADD(field, n) ((field) += (n))
+#endif
+
+/* every thread has its own stack of frames and allocation counter */
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__)
+#define PL_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__)
+#define PL_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define PL_THREAD_LOCAL __declspec(thread)
+#else
+#define PL_THREAD_LOCAL /* without thread local storage compile one program at a time */
+#endif
+
+static PL_THREAD_LOCAL DIAG_FRAME *innermost = NULL; /**< frame errors of this thread go to */
+static PL_THREAD_LOCAL ALLOC_COUNTER *counter = NULL; /**< compilation allocations of this thread count for */
+
+/**
+ * @brief start reporting errors of calling thread to sink
+ *
+ * Has to be followed by setjmp(frame->unwind), which returns one of
+ * compile_status when an error unwinds to the frame. Every frame has to be
+ * popped by the function which pushed it, in reverse order.
+ *
+ * @param *frame frame on the stack of the caller
+ * @param sink receives diagnostics, NULL inherits sink of outer frame
+ * @param *data first argument of sink
+ * @retval void
+ */
+void diag_push(DIAG_FRAME *frame, diagnostic_sink sink, void *data) {
+	frame->outer = innermost;
+	frame->sink = sink;
+	frame->data = data;
+
+	if (sink == NULL) {
+		frame->sink = (innermost != NULL) ? innermost->sink : print_diagnostic;
+		frame->data = (innermost != NULL) ? innermost->data : NULL;
+	}
+
+	innermost = frame;
+}
+
+/**
+ * @brief stop reporting errors to frame, the outer frame gets them again
+ *
+ * @param *frame innermost frame
+ * @retval void
+ */
+void diag_pop(DIAG_FRAME *frame) {
+	innermost = frame->outer;
+}
 
 /**
- * @brief Print error message.
+ * @brief print diagnostic to standard error, the default sink
+ *
+ * @param *data unused
+ * @param *d diagnostic
+ * @retval void
+ */
+void print_diagnostic(void *data, const struct diagnostic *d) {
+	(void) data;
+
+	if (d->kind == DIAG_INTERNAL)
+		fprintf(stderr, "ERROR(%s):\n\t%s:%d -> %s\n\t\t%s!\n", d->module,
+				d->file, d->file_line, d->function, d->message);
+	else
+		fprintf(stderr, "%s in line %d!\n", d->message, d->line);
+}
+
+/**
+ * @brief pass diagnostic to innermost frame and unwind to it
+ *
+ * Without a frame the diagnostic is printed and the program ends, this only
+ * happens if modules are used outside of compile().
+ *
+ * @param *d diagnostic or NULL if it was reported already
+ * @param status one of compile_status, not COMPILE_OK
+ * @retval void
+ */
+void diag_raise(const struct diagnostic *d, const int status) {
+	DIAG_FRAME *frame = innermost;
+
+	if (frame == NULL) {
+		if (d != NULL)
+			print_diagnostic(NULL, d);
+
+		exit(10);
+	}
+
+	if (d != NULL)
+		frame->sink(frame->data, d);
+
+	longjmp(frame->unwind, status);
+}
+
+/**
+ * @brief report internal error and unwind to innermost frame
  * @param *module module in which error raised
  * @param *file name of file
  * @param *function function which raised error
@@ -69,35 +185,141 @@ static const char *parse_err_msg[] =
  **/
 void error(const char *module, const char *file, const char *function, int line,
 		enum err_codes msg_nr) {
-	fprintf(stderr, "ERROR(%s):\n\t%s:%d -> %s\n\t\t%s!\n", module, file, line,
-			function, err_msg[msg_nr]);
-	exit(10);
+	struct diagnostic d;
+
+	d.kind = DIAG_INTERNAL;
+	d.code = msg_nr;
+	d.message = err_msg[msg_nr];
+	d.line = 0;
+	d.module = module;
+	d.file = file;
+	d.function = function;
+	d.file_line = line;
+	diag_raise(&d, COMPILE_INTERNAL_ERROR);
 }
 
 /**
- * @brief Print parsing error messages during compile
+ * @brief report error in source code and unwind to innermost frame
  *
  * @param ln line number
  * @param parse_err_nr enum to print error message
  * @retval void
  */
 void parseError(int ln, enum parse_err_codes parse_err_nr) {
-	fprintf(stderr, "%s in line %d!\n", parse_err_msg[parse_err_nr], ln);
-	exit(10);
+	struct diagnostic d;
+
+	d.kind = DIAG_SYNTAX;
+	d.code = parse_err_nr;
+	d.message = parse_err_msg[parse_err_nr];
+	d.line = ln;
+	d.module = d.file = d.function = NULL;
+	d.file_line = 0;
+	diag_raise(&d, COMPILE_SYNTAX_ERROR);
 }
 
 /**
- * @brief internal debuging prints also in which module error occures
+ * @brief report error of running program and unwind to innermost frame
  *
- * @param ln line number
- * @param parse_err_nr enum to print error message
- * @param *function function which raised error
- * @param line line number
+ * @param ln line number of running statement
+ * @param run_err_nr enum to print error message
+ * @retval void
+ */
+void runError(int ln, enum run_err_codes run_err_nr) {
+	struct diagnostic d;
+
+	d.kind = DIAG_RUNTIME;
+	d.code = run_err_nr;
+	d.message = run_err_msg[run_err_nr];
+	d.line = ln;
+	d.module = d.file = d.function = NULL;
+	d.file_line = 0;
+	diag_raise(&d, COMPILE_RUNTIME_ERROR);
+}
+
+/**
+ * @brief malloc() which is counted for the time report
+ *
+ * @param size number of bytes
+ * @retval void* memory or NULL
+ */
+void *pl_malloc(size_t size) {
+	if (counter != NULL) {
+		ALLOC_ADD(counter->allocations, 1);
+		ALLOC_ADD(counter->bytes, size);
+	}
+
+	return malloc(size);
+}
+
+/**
+ * @brief calloc() which is counted for the time report
+ *
+ * @param n number of elements
+ * @param size bytes per element
+ * @retval void* zeroed memory or NULL
+ */
+void *pl_calloc(size_t n, size_t size) {
+	if (counter != NULL) {
+		ALLOC_ADD(counter->allocations, 1);
+		ALLOC_ADD(counter->bytes, n * size);
+	}
+
+	return calloc(n, size);
+}
+
+/**
+ * @brief realloc() which is counted for the time report
+ *
+ * The whole new size counts as requested.
+ *
+ * @param *ptr memory to resize or NULL
+ * @param size new number of bytes
+ * @retval void* memory or NULL
+ */
+void *pl_realloc(void *ptr, size_t size) {
+	if (counter != NULL) {
+		ALLOC_ADD(counter->allocations, 1);
+		ALLOC_ADD(counter->bytes, size);
+	}
+
+	return realloc(ptr, size);
+}
+
+/**
+ * @brief count allocations of calling thread for a compilation
+ *
+ * Threads working for the same compilation share its counter.
+ *
+ * @param *c counter or NULL to stop counting
  * @retval void
  */
-void debug_output(int ln, enum parse_err_codes parse_err_nr,
-		const char *function, int line) {
-	fprintf(stderr, "\n\nDEBUG: %s in line %d!\n\tFunction: %s Line: %d\n\n",
-			parse_err_msg[parse_err_nr], ln, function, line);
-	exit(10);
+void alloc_set_counter(ALLOC_COUNTER *c) {
+	counter = c;
+}
+
+/**
+ * @brief counter allocations of calling thread count for
+ *
+ * @retval ALLOC_COUNTER* counter or NULL if not counting
+ */
+ALLOC_COUNTER *alloc_get_counter() {
+	return counter;
+}
+
+/**
+ * @brief number of counted allocations of running compilation
+ *
+ * @retval unsigned long
+ */
+unsigned long alloc_count() {
+	return (counter != NULL) ? counter->allocations : 0;
+}
+
+/**
+ * @brief bytes requested by counted allocations of running compilation
+ *
+ * @retval unsigned long
+ */
+unsigned long alloc_bytes() {
+	return (counter != NULL) ? counter->bytes : 0;
 }
@@ -38,6 +38,10 @@
 # endif
 #endif
 
+#include"global.h"
+#include<stddef.h>
+#include<setjmp.h>
+
 #define ERROR_EXCEPT(module, error_code) error(module, __FILE__, __func__, __LINE__, error_code)
 
 /**
@@ -60,16 +64,63 @@ enum parse_err_codes {
 	SYN_NO_COMP,
 	SYN_MISS_CB,
 	SYN_MISS_OB,
+	SYN_NUM_RANGE,
 	TYP_CONST_NUM,
 	TYP_ID_NO_IN,
 	TYP_NO_ID,
 	TYP_ONLY_PROC,
 	TYP_ONLY_INT,
-	TYP_DOUB_DEC
+	TYP_DOUB_DEC,
+	TYP_ASSIGN_CONST
+};
+
+enum run_err_codes {
+	RUN_DIV_ZERO,
+	RUN_DIV_OVERFLOW,
+	RUN_NO_INPUT,
+	RUN_CALL_DEPTH
 };
 
+/**
+ * @struct DIAG_FRAME
+ *
+ * @brief where errors of the calling thread are reported and unwound to
+ *
+ * Frames are pushed with diag_push() and form a stack per thread. error() and
+ * parseError() pass the diagnostic to the sink of the innermost frame and
+ * jump back to its setjmp() with one of compile_status.
+ */
+typedef struct DIAG_FRAME {
+	jmp_buf unwind; 			/**< target of longjmp() */
+	diagnostic_sink sink; 		/**< receives diagnostics */
+	void *data; 				/**< first argument of sink */
+	struct DIAG_FRAME *outer; 	/**< frame which was innermost before */
+} DIAG_FRAME;
+
+/**
+ * @struct ALLOC_COUNTER
+ *
+ * @brief allocations of one compilation, for the time report
+ */
+typedef struct ALLOC_COUNTER {
+	unsigned long allocations; 	/**< calls of pl_malloc, pl_calloc and pl_realloc */
+	unsigned long bytes; 		/**< bytes requested from them */
+} ALLOC_COUNTER;
+
 extern void error(const char *, const char *, const char *, int, enum err_codes);
 extern void parseError(int, enum parse_err_codes);
-extern void debug_output(int, enum parse_err_codes, const char *, int);
+extern void runError(int, enum run_err_codes);
+extern void diag_push(DIAG_FRAME *, diagnostic_sink, void *);
+extern void diag_pop(DIAG_FRAME *);
+extern void diag_raise(const struct diagnostic *, int);
+
+/* counted allocation, used by all modules */
+extern void *pl_malloc(size_t);
+extern void *pl_calloc(size_t, size_t);
+extern void *pl_realloc(void *, size_t);
+extern void alloc_set_counter(ALLOC_COUNTER *);
+extern ALLOC_COUNTER *alloc_get_counter();
+extern unsigned long alloc_count();
+extern unsigned long alloc_bytes();
 
 #endif
@@ -0,0 +1,236 @@
+/*
+ * PiL0 - PL0 Compiler for Raspberry PI
+ * Copyright (C) 2013  Philipp Wiesner
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file fold.c Library for folding constant expressions
+ *
+ * Runs after resolve(), which already replaced constants by their values.
+ * The AST is walked in post order, so the branches of a knot are folded
+ * before the knot itself:
+ *
+ * - arithmetic, unary, relation and odd expressions of numbers become numbers
+ * - IF with a condition which is always false and WHILE which never runs
+ *   become PASS, IF with a condition which is always true becomes its
+ *   statement
+ * - PASS is removed from lists, a list of one statement becomes the statement
+ *
+ * Division by zero is left for run time to report.
+ *
+ * @defgroup fold Folding
+ * @brief constant folding and removal of dead branches
+ * @ingroup parser fold
+ */
+
+#include"frontend.h"
+#include<limits.h>
+
+/**
+ * @brief apply arithmetic operator to two numbers
+ *
+ * Results wrap around like two's complement, division truncates toward zero.
+ * Backends which evaluate at run time use the same function.
+ *
+ * @param op '+', '-', '*' or '/'
+ * @param a left side
+ * @param b right side
+ * @param *result returns result
+ * @retval int 0 if result is undefined: division by zero or of INT_MIN by -1
+ */
+int fold_arithmetic(const int op, const int a, const int b, int *result) {
+	switch (op) {
+	case ('+'):
+		*result = (int) ((unsigned int) a + (unsigned int) b);
+		return 1;
+
+	case ('-'):
+		*result = (int) ((unsigned int) a - (unsigned int) b);
+		return 1;
+
+	case ('*'):
+		*result = (int) ((unsigned int) a * (unsigned int) b);
+		return 1;
+
+	case ('/'):
+		if (b == 0 || (a == INT_MIN && b == -1))
+			return 0;
+
+		*result = a / b;
+		return 1;
+
+	default:
+		return 0;
+	}
+}
+
+/**
+ * @brief apply compare operator to two numbers
+ *
+ * @param op '<', '>' or word ID EQ, NE, LE, GE
+ * @param a left side
+ * @param b right side
+ * @retval int 1 if relation holds, else 0
+ */
+int fold_relation(const int op, const int a, const int b) {
+	switch (op) {
+	case ('<'):
+		return a < b;
+
+	case ('>'):
+		return a > b;
+
+	case (EQ):
+		return a == b;
+
+	case (NE):
+		return a != b;
+
+	case (LE):
+		return a <= b;
+
+	case (GE):
+		return a >= b;
+
+	default:
+		return 0;
+	}
+}
+
+/**
+ * @brief fold expression whose branches are folded already
+ *
+ * @param ast AST
+ * @param ex expression element
+ * @retval void
+ */
+static void fold_expr(ASTPTR ast, const AST_EXPR_REF ex) {
+	AST_EXPR_REF left;
+	int result;
+
+	switch (expr_get_tag(ast, ex)) {
+	case (EXPR_ARITH):
+		left = expr_get_arithmetic_left(ast, ex);
+
+		if (expr_get_tag(ast, left) == EXPR_NUMBER
+				&& expr_get_tag(ast, ex - 1) == EXPR_NUMBER
+				&& fold_arithmetic(expr_get_operator(ast, ex),
+						expr_get_number(ast, left),
+						expr_get_number(ast, ex - 1), &result))
+			expr_set_number(ast, ex, result);
+		break;
+
+	case (EXPR_REL):
+		left = expr_get_relation_left(ast, ex);
+
+		if (expr_get_tag(ast, left) == EXPR_NUMBER
+				&& expr_get_tag(ast, ex - 1) == EXPR_NUMBER)
+			expr_set_number(ast, ex,
+					fold_relation(expr_get_operator(ast, ex),
+							expr_get_number(ast, left),
+							expr_get_number(ast, ex - 1)));
+		break;
+
+	case (EXPR_UNARY):
+		if (expr_get_tag(ast, ex - 1) == EXPR_NUMBER
+				&& fold_arithmetic('-', 0, expr_get_number(ast, ex - 1),
+						&result))
+			expr_set_number(ast, ex, result);
+		break;
+
+	case (EXPR_ODD):
+		if (expr_get_tag(ast, ex - 1) == EXPR_NUMBER)
+			expr_set_number(ast, ex, expr_get_number(ast, ex - 1) % 2 != 0);
+		break;
+	}
+}
+
+/**
+ * @brief remove statement whose branches are folded already if it is dead
+ *
+ * @param ast AST
+ * @param st statement element
+ * @retval void
+ */
+static void fold_stmt(ASTPTR ast, const AST_STMT_REF st) {
+	const AST_STMT_REF *list;
+	AST_EXPR_REF condition;
+	size_t count;
+
+	switch (stmt_get_tag(ast, st)) {
+	case (STMT_IF):
+		condition = stmt_get_jumpfor_condition(ast, st);
+
+		if (expr_get_tag(ast, condition) != EXPR_NUMBER)
+			break;
+
+		if (expr_get_number(ast, condition) == 0)
+			stmt_set_pass(ast, st);
+		else
+			stmt_replace(ast, st, stmt_get_jumpfor_statement(ast, st));
+		break;
+
+	case (STMT_WHILE):
+		condition = stmt_get_jumpbac_condition(ast, st);
+
+		if (expr_get_tag(ast, condition) == EXPR_NUMBER
+				&& expr_get_number(ast, condition) == 0)
+			stmt_set_pass(ast, st);
+		break;
+
+	case (STMT_LIST):
+		stmt_list_prune(ast, st);
+		list = stmt_get_list(ast, st, &count);
+
+		if (count == 0)
+			stmt_set_pass(ast, st);
+		else if (count == 1)
+			stmt_replace(ast, st, list[0]);
+		break;
+	}
+}
+
+/**
+ * @brief post callback, folds knot after its branches
+ */
+static int fold_post(void *data, const ASTPTR ast, const int class,
+		const unsigned int ref) {
+	(void) data;
+
+	if (class == AST_CLASS_EXPR)
+		fold_expr(ast, ref);
+	else if (class == AST_CLASS_STMT)
+		fold_stmt(ast, ref);
+
+	return VISIT_CONTINUE;
+}
+
+/**
+ * @brief fold constant expressions and remove dead branches of resolved program
+ *
+ * @param code pointer to source code object
+ * @retval void
+ */
+void fold(SOURCECODE code) {
+	AWPTR walker = init_walker(0);
+	AST_VISITOR v;
+
+	v.pre = NULL;
+	v.post = fold_post;
+	v.data = NULL;
+	walk_ast(walker, sc_get_ast(code), AST_CLASS_BLOCK, 0, &v);
+	free_walker(walker);
+}
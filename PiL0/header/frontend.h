@@ -31,79 +31,361 @@
 #include<string.h>
 #include<ctype.h>
 
-#define PL_DEBUG   1
-#define MAX_LENGTH 30
-
-typedef struct TOKEN_OBJECT *TOPTR;
+typedef struct TOKEN_STREAM *TSPTR;
 typedef struct TABLE_ENTRY *TEPTR;
-typedef struct AST_BLOCK *AST_BLOCK_PTR;
-typedef struct AST_STMT *AST_STMT_PTR;
-typedef struct AST_EXPR *AST_EXPR_PTR;
+typedef struct SYMBOL_TABLE *STPTR;
+typedef struct AST *ASTPTR;
+typedef struct AST_WALKER *AWPTR;
+typedef struct TIME_REPORT *TRPTR;
 typedef struct SOURCE_OBJECT *SOURCECODE;
+typedef struct BYTECODE *BCPTR;
+typedef struct INTERN_POOL *IPPTR;
+
+/**
+ * @typedef SYMBOL
+ * @brief number of an interned identifier name, unique per compilation
+ **/
+typedef unsigned int SYMBOL;
+
+#define NO_SYMBOL ((SYMBOL) -1)
+
+/**
+ * @typedef AST_BLOCK_REF
+ * @brief index of a knot in the block, statement or expression array of an AST
+ **/
+typedef unsigned int AST_BLOCK_REF;
+typedef unsigned int AST_STMT_REF;
+typedef unsigned int AST_EXPR_REF;
+typedef unsigned int AST_SCOPE_REF;
+
+#define AST_NONE ((unsigned int) -1)
+
+/**
+ * @struct AST_ADDRESS
+ *
+ * @brief where a declaration lives, set by resolve()
+ *
+ * VAR and CONST live in a slot of the frame of the scope at their static
+ * nesting depth, the main program has depth 0. A procedure is addressed by
+ * the depth of the scope it is declared in and the index of its own scope
+ * as slot.
+ **/
+typedef struct {
+	unsigned int depth; /**< static nesting depth of declaring scope */
+	unsigned int slot; /**< frame slot or procedure index */
+} AST_ADDRESS;
+
+/**
+ * @enum ast_classes array of an AST a knot is stored in
+ */
+enum ast_classes {
+	AST_CLASS_BLOCK, AST_CLASS_STMT, AST_CLASS_EXPR
+};
+
+/**
+ * @enum block_ids IDs to differ between block knot elements
+ */
+enum block_ids {
+	BLOCK_PROC, BLOCK_STMT
+};
+
+/**
+ * @enum stmt_ids IDs to differ between statement knot elements
+ *
+ * CALL and READ are both STMT_CARE, stmt_get_care() tells them apart.
+ */
+enum stmt_ids {
+	STMT_IF, STMT_WHILE, STMT_ASSIGN, STMT_LIST, STMT_CARE, STMT_PRINT, STMT_PASS
+};
+
+/**
+ * @enum expr_ids IDs to differ between expression knot elements
+ */
+enum expr_ids {
+	EXPR_NUMBER, EXPR_IDENTIFIER, EXPR_ARITH, EXPR_UNARY, EXPR_REL, EXPR_ODD
+};
+
+/**
+ * @struct SPAN
+ *
+ * @brief reference to a run of characters inside the source text
+ *
+ * Spans are not null-terminated and stay valid as long as the source code object
+ * which owns the text.
+ **/
+typedef struct {
+	const char *start; /**< first character */
+	size_t length; /**< number of characters */
+} SPAN;
+
+/**
+ * @struct CHAR_SCANNER
+ *
+ * @brief functions which skip runs of one character class
+ **/
+typedef struct {
+	const char *name; /**< name of instruction set */
+	const char *(*skip_space)(const char *, const char *, size_t *); /**< skip white space, count new lines */
+	const char *(*skip_alnum)(const char *, const char *); /**< skip letters and digits */
+	const char *(*skip_digit)(const char *, const char *); /**< skip digits */
+} CHAR_SCANNER;
+
+/**
+ * @enum visit_results return values of visitor callbacks
+ */
+enum visit_results {
+	VISIT_CONTINUE, /**< go on with branches of knot */
+	VISIT_PRUNE, /**< skip branches of knot, only returned by pre */
+	VISIT_STOP /**< end walk */
+};
+
+/**
+ * @struct AST_VISITOR
+ *
+ * @brief callbacks of a walk over an AST
+ *
+ * Both callbacks get the data pointer, the AST, one of ast_classes and the
+ * index of the knot, and return one of visit_results. Either may be NULL.
+ **/
+typedef struct {
+	int (*pre)(void *, const ASTPTR, const int, const unsigned int); /**< called before the branches of a knot */
+	int (*post)(void *, const ASTPTR, const int, const unsigned int); /**< called after the branches of a knot */
+	void *data; /**< passed to callbacks */
+} AST_VISITOR;
+
+/**
+ * @struct TRACER
+ *
+ * @brief levels and ring buffer of trace events of one compilation
+ *
+ * Modules keep a pointer to the tracer and record events with TRACE(). A
+ * category whose threshold is TRACE_OFF costs one compare per event.
+ **/
+typedef struct {
+	unsigned char threshold[TRACE_CATEGORIES]; /**< highest level recorded per category */
+	struct TRACE_RING *ring; /**< recorded events, NULL if nothing is traced */
+} TRACER;
+
+/**
+ * @enum trace_events kinds of trace events, each has three arguments
+ */
+enum trace_events {
+	EV_LEX_TOKEN, EV_LEX_CHUNK, EV_LEX_END,
+	EV_PARSE_TOKEN, EV_PARSE_EXPAND, EV_PARSE_ERROR,
+	EV_AST_PROCEDURE, EV_AST_STATEMENT, EV_AST_CARE, EV_AST_PRINT,
+	EV_AST_JUMPBAC, EV_AST_JUMPFOR, EV_AST_ASSIGNMENT, EV_AST_LIST,
+	EV_AST_NUMBER, EV_AST_IDENTIFIER, EV_AST_ARITHMETIC, EV_AST_RELATION,
+	EV_AST_UNARY, EV_AST_ODD,
+	EV_ST_ENTER, EV_ST_CLEAN, EV_ST_DECLARE, EV_ST_LOOKUP,
+	TRACE_EVENTS
+};
+
+#if defined(__GNUC__)
+#define PL_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#define PL_UNLIKELY(x) (x)
+#endif
+
+/**
+ * @def TRACING(tracer, category, level)
+ * @brief nonzero if category is traced at level
+ */
+#define TRACING(tracer, category, level) \
+	PL_UNLIKELY((tracer)->threshold[category] >= (level))
+
+/**
+ * @def TRACE(tracer, category, level, event, a, b, c)
+ * @brief record event if category is traced at level, usable as expression
+ */
+#define TRACE(tracer, category, level, event, a, b, c) \
+	(TRACING(tracer, category, level) ? \
+			trace_emit((tracer), (category), (event), (unsigned int) (a), \
+					(unsigned int) (b), (unsigned int) (c)) : (void) 0)
+
+/* character classes of char_class[] */
+#define CC_SPACE   1
+#define CC_NEWLINE 2
+#define CC_ALPHA   4
+#define CC_DIGIT   8
 
 /* for manipulating and accessing global source code object */
-extern void sc_set_ts(SOURCECODE, const QUEUE);
-extern QUEUE sc_get_ts(const SOURCECODE);
-extern void sc_set_st(SOURCECODE, const STACK);
-extern STACK sc_get_st(const SOURCECODE);
-extern void sc_set_ast_bl(SOURCECODE, const AST_BLOCK_PTR);
-extern AST_BLOCK_PTR sc_get_ast_bl(const SOURCECODE);
-extern void sc_set_ast_st(SOURCECODE, const AST_STMT_PTR);
-extern AST_STMT_PTR sc_get_ast_st(const SOURCECODE);
-extern void sc_set_ast_ex(SOURCECODE, const AST_EXPR_PTR);
-extern AST_EXPR_PTR sc_get_ast_ex(const SOURCECODE);
+extern SOURCECODE sc_init();
+extern void sc_destroy(SOURCECODE);
+extern void sc_set_ts(SOURCECODE, const TSPTR);
+extern TSPTR sc_get_ts(const SOURCECODE);
+extern IPPTR sc_get_ip(const SOURCECODE);
+extern ASTPTR sc_get_ast(const SOURCECODE);
+extern ARPTR sc_get_token_arena(const SOURCECODE);
+extern void sc_set_st(SOURCECODE, const STPTR);
+extern STPTR sc_get_st(const SOURCECODE);
+extern void sc_set_bc(SOURCECODE, const BCPTR);
+extern BCPTR sc_get_bc(const SOURCECODE);
+extern void sc_set_text(SOURCECODE, const char *, size_t);
+extern const char *sc_get_text(const SOURCECODE);
+extern void sc_set_options(SOURCECODE, const struct compile_options *);
+extern const struct compile_options *sc_get_options(const SOURCECODE);
+extern size_t sc_get_text_length(const SOURCECODE);
+extern TRPTR sc_get_report(const SOURCECODE);
+extern const TRACER *sc_get_tracer(const SOURCECODE);
+
+/* for measuring the phases of a compilation */
+extern TRPTR init_report();
+extern void free_report(TRPTR);
+extern void report_begin(TRPTR, const char *);
+extern void report_end(TRPTR, const size_t, const size_t, const ARPTR);
+extern void report_add_cpu(TRPTR, const double);
+extern double report_thread_cpu();
+extern void print_report(const TRPTR, FILE *, const int);
+
+/* for recording and decoding trace events */
+extern const TRACER no_trace;
+extern void init_tracer(TRACER *, const unsigned char *, unsigned long);
+extern void free_tracer(TRACER *);
+extern void trace_emit(const TRACER *, const int, const int, const unsigned int, const unsigned int, const unsigned int);
+extern int trace_write(const TRACER *, FILE *, const IPPTR);
+
+/* for interning identifier names */
+extern IPPTR init_intern_pool();
+extern void free_intern_pool(IPPTR);
+extern SYMBOL intern(IPPTR, const SPAN);
+extern SPAN symbol_name(const IPPTR, const SYMBOL);
+extern size_t size_intern_pool(const IPPTR);
 
 /* for lexical analysis and access to the generated token */
-extern void lexer(SOURCECODE, FILE *);
-extern TOPTR generate_token(const char *, const int *, const int *);
-extern void free_token(TOPTR);
-extern void release_token(const QUEUE);
-extern TOPTR getTOKEN(const QUEUE);
-extern char getType(const QUEUE);
-extern size_t getLine(const QUEUE);
-extern int getNumber(const QUEUE);
-extern int getNumberID(const QUEUE);
-extern char *getWord(const QUEUE);
-extern int getWordID(const QUEUE);
-extern char getToken(const QUEUE);
+extern const unsigned char char_class[256];
+extern const CHAR_SCANNER *get_scanner(int);
+extern void lexer(SOURCECODE);
+extern void lexer_stream(SOURCECODE);
+extern void lexer_parallel(SOURCECODE);
+extern SPAN make_span(const char *, size_t);
+extern int span_compare(const SPAN, const SPAN);
+extern TSPTR init_token_stream(const char *, size_t);
+extern void ts_set_refill(TSPTR, int (*)(void *), void *);
+extern void free_token_stream(TSPTR);
+extern size_t ts_space(const TSPTR);
+extern void append_token(TSPTR, const char, const SPAN, const int, const SYMBOL, const size_t);
+extern size_t ts_count(const TSPTR);
+extern size_t ts_reserve(TSPTR, const size_t);
+extern void ts_fill(TSPTR, const size_t, const TSPTR, const size_t, const SYMBOL *);
+extern void end_token_stream(TSPTR, const size_t);
+extern void next_token(TSPTR);
+extern char getType(const TSPTR);
+extern size_t getLine(const TSPTR);
+extern int getNumber(const TSPTR);
+extern int getNumberID(const TSPTR);
+extern SPAN getWord(const TSPTR);
+extern int getWordID(const TSPTR);
+extern SYMBOL getSymbol(const TSPTR);
+extern char getToken(const TSPTR);
 
 /* used by parsing and symbol table generating / accessing */
-extern int init_parsing(SOURCECODE);
-extern TEPTR generate_tableEntry(const char *, const int);
-extern void stclean(STACK);
-extern TEPTR stlookup(STACK, const char *);
+extern void init_parsing(SOURCECODE);
+extern STPTR init_symbol_table();
+extern void free_symbol_table(STPTR);
+extern void st_set_tracer(STPTR, const TRACER *);
+extern void stenter(STPTR);
+extern void stclean(STPTR);
+extern int stdeclare(STPTR, const SYMBOL, const int);
+extern TEPTR stlookup(const STPTR, const SYMBOL);
 extern int st_get_typeID(TEPTR);
+extern void st_set_address(TEPTR, const AST_ADDRESS);
+extern AST_ADDRESS st_get_address(TEPTR);
+extern void st_set_value(TEPTR, const int);
+extern int st_get_value(TEPTR);
+
+/* for resolving identifiers to addresses after parsing */
+extern void resolve(SOURCECODE);
+
+/* for evaluating constant expressions and removing dead code */
+extern void fold(SOURCECODE);
+extern int fold_arithmetic(const int, const int, const int, int *);
+extern int fold_relation(const int, const int, const int);
+
+/* for running resolved programs */
+extern void interpret(SOURCECODE);
+extern BCPTR init_bytecode();
+extern void free_bytecode(BCPTR);
+extern size_t bc_bytes(const BCPTR);
+extern size_t bc_line(const BCPTR, const size_t);
+extern void bc_print(const BCPTR, FILE *);
+extern void emit_bytecode(SOURCECODE);
+extern void vm_run(SOURCECODE);
 
 /* functions for generating abstract syntax tree */
-extern AST_BLOCK_PTR init_block();
-extern void block_init_procedure(AST_BLOCK_PTR, const char *);
-extern AST_BLOCK_PTR block_get_function(const AST_BLOCK_PTR);
-extern AST_BLOCK_PTR block_get_main(const AST_BLOCK_PTR);
-extern AST_STMT_PTR block_init_statement(AST_BLOCK_PTR);
-extern void stmt_init_care(AST_STMT_PTR, const char *);
-extern AST_EXPR_PTR stmt_init_print(AST_STMT_PTR);
-extern void stmt_init_jumpbac(AST_STMT_PTR);
-extern AST_EXPR_PTR stmt_get_jumpbac_condition(const AST_STMT_PTR);
-extern AST_STMT_PTR stmt_get_jumpbac_statement(const AST_STMT_PTR);
-extern void stmt_init_jumpfor(AST_STMT_PTR);
-extern AST_EXPR_PTR stmt_get_jumpfor_condition(const AST_STMT_PTR);
-extern AST_STMT_PTR stmt_get_jumpfor_statement(const AST_STMT_PTR );
-extern AST_EXPR_PTR stmt_init_assignment(AST_STMT_PTR, const char *);
-extern void stmt_init_sequence(AST_STMT_PTR);
-extern AST_STMT_PTR stmt_get_sequence_left(const AST_STMT_PTR);
-extern AST_STMT_PTR stmt_get_sequence_right(const AST_STMT_PTR);
-extern void expr_init_number(AST_EXPR_PTR, const int);
-extern void expr_init_identifier(AST_EXPR_PTR, const char *);
-extern void expr_init_arithmetic(AST_EXPR_PTR);
-extern void expr_arithmetic_set_op(AST_EXPR_PTR, const char);
-extern AST_EXPR_PTR expr_get_arithmetic_left(const AST_EXPR_PTR);
-extern AST_EXPR_PTR expr_get_arithmetic_right(const AST_EXPR_PTR);
-extern void expr_init_relation(AST_EXPR_PTR);
-extern void expr_relation_set_op(AST_EXPR_PTR, const char *);
-extern AST_EXPR_PTR expr_get_relation_left(const AST_EXPR_PTR);
-extern AST_EXPR_PTR expr_get_relation_right(const AST_EXPR_PTR);
-extern AST_EXPR_PTR expr_init_unary(AST_EXPR_PTR, const char);
-extern AST_EXPR_PTR expr_init_odd(AST_EXPR_PTR);
+extern ASTPTR init_ast();
+extern void free_ast(ASTPTR);
+extern void ast_set_tracer(ASTPTR, const TRACER *);
+extern size_t ast_bytes(const ASTPTR);
+extern size_t ast_knots(const ASTPTR);
+extern AST_BLOCK_REF init_block(ASTPTR);
+extern void block_init_procedure(ASTPTR, AST_BLOCK_REF, const SYMBOL);
+extern AST_BLOCK_REF block_get_function(const ASTPTR, const AST_BLOCK_REF);
+extern AST_BLOCK_REF block_get_main(const ASTPTR, const AST_BLOCK_REF);
+extern AST_STMT_REF block_init_statement(ASTPTR, AST_BLOCK_REF);
+extern void stmt_set_line(ASTPTR, AST_STMT_REF, const size_t);
+extern size_t stmt_get_line(const ASTPTR, const AST_STMT_REF);
+extern void stmt_init_care(ASTPTR, AST_STMT_REF, const SYMBOL, const int);
+extern void stmt_init_print(ASTPTR, AST_STMT_REF, const AST_EXPR_REF);
+extern void stmt_init_jumpbac(ASTPTR, AST_STMT_REF, const AST_EXPR_REF);
+extern AST_EXPR_REF stmt_get_jumpbac_condition(const ASTPTR, const AST_STMT_REF);
+extern AST_STMT_REF stmt_get_jumpbac_statement(const ASTPTR, const AST_STMT_REF);
+extern void stmt_init_jumpfor(ASTPTR, AST_STMT_REF, const AST_EXPR_REF);
+extern AST_EXPR_REF stmt_get_jumpfor_condition(const ASTPTR, const AST_STMT_REF);
+extern AST_STMT_REF stmt_get_jumpfor_statement(const ASTPTR, const AST_STMT_REF);
+extern void stmt_init_assignment(ASTPTR, AST_STMT_REF, const SYMBOL, const AST_EXPR_REF);
+extern void stmt_init_list(ASTPTR, AST_STMT_REF);
+extern AST_STMT_REF stmt_list_append(ASTPTR, AST_STMT_REF);
+extern void stmt_end_list(ASTPTR, AST_STMT_REF);
+extern const AST_STMT_REF *stmt_get_list(const ASTPTR, const AST_STMT_REF, size_t *);
+extern AST_EXPR_REF expr_init_number(ASTPTR, const int);
+extern AST_EXPR_REF expr_init_identifier(ASTPTR, const SYMBOL);
+extern AST_EXPR_REF expr_init_arithmetic(ASTPTR, const char, const AST_EXPR_REF, const AST_EXPR_REF);
+extern AST_EXPR_REF expr_get_arithmetic_left(const ASTPTR, const AST_EXPR_REF);
+extern AST_EXPR_REF expr_get_arithmetic_right(const ASTPTR, const AST_EXPR_REF);
+extern AST_EXPR_REF expr_init_relation(ASTPTR, const int, const AST_EXPR_REF, const AST_EXPR_REF);
+extern AST_EXPR_REF expr_get_relation_left(const ASTPTR, const AST_EXPR_REF);
+extern AST_EXPR_REF expr_get_relation_right(const ASTPTR, const AST_EXPR_REF);
+extern AST_EXPR_REF expr_init_unary(ASTPTR, const char, const AST_EXPR_REF);
+extern AST_EXPR_REF expr_init_odd(ASTPTR, const AST_EXPR_REF);
+extern int block_get_tag(const ASTPTR, const AST_BLOCK_REF);
+extern SYMBOL block_get_identifier(const ASTPTR, const AST_BLOCK_REF);
+extern AST_STMT_REF block_get_statement(const ASTPTR, const AST_BLOCK_REF);
+extern int stmt_get_tag(const ASTPTR, const AST_STMT_REF);
+extern SYMBOL stmt_get_identifier(const ASTPTR, const AST_STMT_REF);
+extern int stmt_get_care(const ASTPTR, const AST_STMT_REF);
+extern AST_ADDRESS stmt_get_address(const ASTPTR, const AST_STMT_REF);
+extern void stmt_set_address(ASTPTR, const AST_STMT_REF, const AST_ADDRESS);
+extern AST_EXPR_REF stmt_get_expression(const ASTPTR, const AST_STMT_REF);
+extern int expr_get_tag(const ASTPTR, const AST_EXPR_REF);
+extern int expr_get_operator(const ASTPTR, const AST_EXPR_REF);
+extern int expr_get_number(const ASTPTR, const AST_EXPR_REF);
+extern SYMBOL expr_get_identifier(const ASTPTR, const AST_EXPR_REF);
+extern AST_ADDRESS expr_get_address(const ASTPTR, const AST_EXPR_REF);
+extern void expr_set_address(ASTPTR, const AST_EXPR_REF, const AST_ADDRESS);
+extern AST_EXPR_REF expr_get_branch(const ASTPTR, const AST_EXPR_REF);
+extern void expr_set_number(ASTPTR, const AST_EXPR_REF, const int);
+extern void stmt_set_pass(ASTPTR, const AST_STMT_REF);
+extern void stmt_replace(ASTPTR, const AST_STMT_REF, const AST_STMT_REF);
+extern void stmt_list_prune(ASTPTR, const AST_STMT_REF);
+extern AST_SCOPE_REF block_init_scope(ASTPTR, const AST_BLOCK_REF);
+extern void scope_declare(ASTPTR, const SYMBOL, const int);
+extern void scope_set_value(ASTPTR, const int);
+extern void scope_set_owner(ASTPTR, const AST_SCOPE_REF, const SYMBOL, const unsigned int, const AST_SCOPE_REF);
+extern size_t ast_scopes(const ASTPTR);
+extern AST_BLOCK_REF scope_get_block(const ASTPTR, const AST_SCOPE_REF);
+extern AST_STMT_REF scope_get_statement(const ASTPTR, const AST_SCOPE_REF);
+extern SYMBOL scope_get_identifier(const ASTPTR, const AST_SCOPE_REF);
+extern unsigned int scope_get_depth(const ASTPTR, const AST_SCOPE_REF);
+extern AST_SCOPE_REF scope_get_parent(const ASTPTR, const AST_SCOPE_REF);
+extern size_t scope_get_size(const ASTPTR, const AST_SCOPE_REF);
+extern SYMBOL scope_get_decl(const ASTPTR, const AST_SCOPE_REF, const unsigned int, int *, int *);
+extern int ast_child(const ASTPTR, const int, const unsigned int, const size_t, unsigned int *);
+
+/* for walking the abstract syntax tree */
+extern AWPTR init_walker(const size_t);
+extern void free_walker(AWPTR);
+extern int walk_ast(AWPTR, const ASTPTR, const int, const unsigned int, const AST_VISITOR *);
+extern size_t walker_depth(const AWPTR);
 
 
 /**
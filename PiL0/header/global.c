@@ -21,9 +21,30 @@
  * @ingroup global
  **/
 
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200112L
+#define PL_HAVE_MMAP
+#endif
+
 #include"frontend.h"
 
+#ifdef PL_HAVE_MMAP
+#include<sys/types.h>
+#include<sys/stat.h>
+#include<sys/mman.h>
+#endif
+
 #define SC_ERR "Source-Code Object"
+#define READ_CHUNK 65536
+#define TOKEN_ARENA_CHUNK 4096
+#define TRACE_FILE "pil0.trace"
+
+/**
+ * @enum text_owner describes who is responsible for releasing the source text
+ */
+enum text_owner {
+	TEXT_BORROWED, TEXT_ALLOCATED, TEXT_MAPPED
+};
 
 /**
  * @struct SOURCE_OBJECT
@@ -32,11 +53,19 @@
  *
  **/
 struct SOURCE_OBJECT {
-	QUEUE token_stream; 		/**< pointer to token stream */
-	STACK symbol_table; 		/**< pointer to symbol table */
-	AST_BLOCK_PTR block_tmp; 	/**< pointer to temporary block */
-	AST_STMT_PTR stmt_tmp; 		/**< pointer to temporary statement */
-	AST_EXPR_PTR expr_tmp; 		/**< pointer to temporary expression */
+	TSPTR token_stream; 		/**< pointer to token stream */
+	STPTR symbol_table; 		/**< pointer to symbol table */
+	IPPTR intern_pool; 			/**< pointer to interned identifier names */
+	ASTPTR ast; 				/**< abstract syntax tree */
+	BCPTR bytecode; 			/**< program emitted from AST, NULL if not run by VM */
+	ARPTR token_arena; 			/**< scratch memory of lexer, reset after lexing */
+	TRPTR report; 				/**< time report, NULL if not asked for */
+	ALLOC_COUNTER allocations; 	/**< allocations counted for the time report */
+	TRACER trace; 				/**< trace levels and events */
+	const char *text; 			/**< source text tokens refer to */
+	size_t text_length; 		/**< length of source text */
+	enum text_owner text_owner; /**< how source text has to be released */
+	struct compile_options options; /**< options selected for compiling */
 };
 
 /**
@@ -44,17 +73,40 @@ struct SOURCE_OBJECT {
  *
  * @retval SOURCECODE
  */
-static SOURCECODE sc_init() {
+SOURCECODE sc_init() {
 	SOURCECODE new_code = NULL;
 
-	if ((new_code = malloc(sizeof(*new_code))) == NULL)
+	if ((new_code = pl_malloc(sizeof(*new_code))) == NULL)
 		error(SC_ERR, __FILE__, __func__, __LINE__, ERR_MEMORY);
 
 	new_code->symbol_table = NULL;
 	new_code->token_stream = NULL;
-	new_code->block_tmp = NULL;
-	new_code->stmt_tmp = NULL;
-	new_code->expr_tmp = NULL;
+	new_code->intern_pool = init_intern_pool();
+	new_code->ast = init_ast();
+	new_code->bytecode = NULL;
+	new_code->token_arena = init_arena(TOKEN_ARENA_CHUNK);
+	new_code->report = NULL;
+	new_code->allocations.allocations = 0;
+	new_code->allocations.bytes = 0;
+	new_code->trace = no_trace;
+	new_code->text = "";
+	new_code->text_length = 0;
+	new_code->text_owner = TEXT_BORROWED;
+	new_code->options.stream = 0;
+	new_code->options.isa = SCAN_AUTO;
+	new_code->options.jobs = 0;
+	new_code->options.time_report = REPORT_NONE;
+	memset(new_code->options.trace, TRACE_OFF, sizeof(new_code->options.trace));
+	new_code->options.trace_events = 0;
+	new_code->options.trace_file = NULL;
+	new_code->options.no_fold = 0;
+	new_code->options.run = RUN_NONE;
+	new_code->options.input = NULL;
+	new_code->options.output = NULL;
+	new_code->options.listing = NULL;
+	new_code->options.progress = NULL;
+	new_code->options.diagnostic = NULL;
+	new_code->options.diagnostic_data = NULL;
 
 	return new_code;
 }
@@ -65,7 +117,30 @@ static SOURCECODE sc_init() {
  * @param sc pointer to source code object
  * @retval void
  */
-static void sc_destroy(SOURCECODE sc) {
+void sc_destroy(SOURCECODE sc) {
+	free_token_stream(sc->token_stream);
+	free_intern_pool(sc->intern_pool);
+	free_symbol_table(sc->symbol_table);
+	free_ast(sc->ast);
+	free_bytecode(sc->bytecode);
+	free_arena(sc->token_arena);
+	free_report(sc->report);
+	free_tracer(&sc->trace);
+
+	switch (sc->text_owner) {
+#ifdef PL_HAVE_MMAP
+		case TEXT_MAPPED:
+			munmap((void *) sc->text, sc->text_length);
+			break;
+#endif
+		case TEXT_ALLOCATED:
+			free((void *) sc->text);
+			break;
+
+		default:
+			break;
+	}
+
 	free(sc);
 	sc = NULL;
 }
@@ -77,7 +152,7 @@ static void sc_destroy(SOURCECODE sc) {
  * @param *ts pointer to token stream
  * @retval void
  */
-void sc_set_ts(SOURCECODE sc, const QUEUE ts) {
+void sc_set_ts(SOURCECODE sc, const TSPTR ts) {
 	sc->token_stream = ts;
 }
 
@@ -87,10 +162,40 @@ void sc_set_ts(SOURCECODE sc, const QUEUE ts) {
  * @param sc pointer to source code
  * @retval sc->token_stream
  */
-QUEUE sc_get_ts(const SOURCECODE sc) {
+TSPTR sc_get_ts(const SOURCECODE sc) {
 	return sc->token_stream;
 }
 
+/**
+ * @brief return intern pool
+ *
+ * @param sc pointer to source code
+ * @retval sc->intern_pool
+ */
+IPPTR sc_get_ip(const SOURCECODE sc) {
+	return sc->intern_pool;
+}
+
+/**
+ * @brief return abstract syntax tree
+ *
+ * @param sc pointer to source code
+ * @retval sc->ast
+ */
+ASTPTR sc_get_ast(const SOURCECODE sc) {
+	return sc->ast;
+}
+
+/**
+ * @brief return arena of short lived lexer data
+ *
+ * @param sc pointer to source code
+ * @retval sc->token_arena
+ */
+ARPTR sc_get_token_arena(const SOURCECODE sc) {
+	return sc->token_arena;
+}
+
 /**
  * @brief set symbol table
  *
@@ -98,7 +203,7 @@ QUEUE sc_get_ts(const SOURCECODE sc) {
  * @param st pointer to symbol table
  * @retval void
  */
-void sc_set_st(SOURCECODE sc, const STACK st) {
+void sc_set_st(SOURCECODE sc, const STPTR st) {
 	sc->symbol_table = st;
 }
 
@@ -108,94 +213,389 @@ void sc_set_st(SOURCECODE sc, const STACK st) {
  * @param sc pointer to source code
  * @retval sc->symbol_table
  */
-STACK sc_get_st(const SOURCECODE sc) {
+STPTR sc_get_st(const SOURCECODE sc) {
 	return sc->symbol_table;
 }
 
 /**
- * @brief set AST block
+ * @brief set bytecode, which is released with the source code object
  *
  * @param sc pointer to source code
- * @param b pointer to AST block
+ * @param bc pointer to bytecode
  * @retval void
  */
-void sc_set_ast_bl(SOURCECODE sc, const AST_BLOCK_PTR b) {
-	sc->block_tmp = b;
+void sc_set_bc(SOURCECODE sc, const BCPTR bc) {
+	sc->bytecode = bc;
+}
+
+/**
+ * @brief get bytecode
+ *
+ * @param sc pointer to source code
+ * @retval sc->bytecode, NULL if not emitted
+ */
+BCPTR sc_get_bc(const SOURCECODE sc) {
+	return sc->bytecode;
+}
+
+/**
+ * @brief return source text
+ *
+ * @param sc pointer to source code
+ * @retval sc->text
+ */
+const char *sc_get_text(const SOURCECODE sc) {
+	return sc->text;
+}
+
+/**
+ * @brief return length of source text
+ *
+ * @param sc pointer to source code
+ * @retval sc->text_length
+ */
+size_t sc_get_text_length(const SOURCECODE sc) {
+	return sc->text_length;
 }
 
 /**
- * @brief return AST block
+ * @brief set source text which is already in memory
+ *
+ * The text is not copied and has to stay valid as long as the source code object.
  *
  * @param sc pointer to source code
- * @retval sc->block_tmp
+ * @param *text pl0 source code
+ * @param length length of source code
+ * @retval void
  */
-AST_BLOCK_PTR sc_get_ast_bl(const SOURCECODE sc) {
-	return sc->block_tmp;
+void sc_set_text(SOURCECODE sc, const char *text, size_t length) {
+	sc->text = text;
+	sc->text_length = length;
+	sc->text_owner = TEXT_BORROWED;
 }
 
 /**
- * @brief set AST statement
+ * @brief set compile options
+ *
+ * Creates the time report and the trace buffer if they are asked for.
  *
  * @param sc pointer to source code
- * @param s pointer to AST statement
+ * @param *options compile options, NULL keeps defaults
  * @retval void
  */
-void sc_set_ast_st(SOURCECODE sc, const AST_STMT_PTR s) {
-	sc->stmt_tmp = s;
+void sc_set_options(SOURCECODE sc, const struct compile_options *options) {
+	if (options != NULL)
+		sc->options = *options;
+
+	if (sc->options.time_report != REPORT_NONE && sc->report == NULL)
+		sc->report = init_report();
+
+	if (sc->trace.ring == NULL) {
+		init_tracer(&sc->trace, sc->options.trace, sc->options.trace_events);
+		ast_set_tracer(sc->ast, &sc->trace);
+	}
+}
+
+/**
+ * @brief return compile options
+ *
+ * @param sc pointer to source code
+ * @retval &sc->options
+ */
+const struct compile_options *sc_get_options(const SOURCECODE sc) {
+	return &sc->options;
 }
 
 /**
- * @brief return AST statement
+ * @brief return time report
  *
  * @param sc pointer to source code
- * @retval sc->stmt_tmp
+ * @retval TRPTR report or NULL if not asked for
  */
-AST_STMT_PTR sc_get_ast_st(const SOURCECODE sc) {
-	return sc->stmt_tmp;
+TRPTR sc_get_report(const SOURCECODE sc) {
+	return sc->report;
 }
 
 /**
- * @brief set AST expression
+ * @brief return tracer of compilation
+ *
+ * @param sc pointer to source code
+ * @retval const TRACER* tracer, records nothing if tracing is off
+ */
+const TRACER *sc_get_tracer(const SOURCECODE sc) {
+	return &sc->trace;
+}
+
+/**
+ * @brief write recorded trace events to trace file
  *
  * @param sc pointer to source code
- * @param e pointer to AST expression
  * @retval void
  */
-void sc_set_ast_ex(SOURCECODE sc, const AST_EXPR_PTR e) {
-	sc->expr_tmp = e;
+static void sc_write_trace(const SOURCECODE sc) {
+	const char *name = (sc->options.trace_file != NULL) ?
+			sc->options.trace_file : TRACE_FILE;
+	FILE *out;
+
+	if (sc->trace.ring == NULL)
+		return;
+
+	if ((out = fopen(name, "wb")) == NULL || !trace_write(&sc->trace, out,
+			sc->intern_pool))
+		fprintf(stderr, "Couldn't write trace to %s!\n", name);
+
+	if (out != NULL)
+		fclose(out);
 }
 
 /**
- * @brief return AST expression
+ * @brief number of tokens lexed so far
  *
  * @param sc pointer to source code
- * @retval sc->expr_tmp
+ * @retval size_t
  */
-AST_EXPR_PTR sc_get_ast_ex(const SOURCECODE sc) {
-	return sc->expr_tmp;
+static size_t sc_tokens(const SOURCECODE sc) {
+	return (sc->token_stream != NULL) ? ts_count(sc->token_stream) : 0;
 }
 
 /**
- * @brief compile handler which starts lexing and parsing
+ * @brief report progress to the stream of the options
  *
+ * @param sc pointer to source code
+ * @param *msg message with line ends
+ * @retval void
+ */
+static void sc_progress(const SOURCECODE sc, const char *msg) {
+	if (sc->options.progress != NULL)
+		fputs(msg, sc->options.progress);
+}
+
+/**
+ * @brief end phase of the time report started last
+ *
+ * @param sc pointer to source code
+ * @retval void
+ */
+static void sc_report_end(const SOURCECODE sc) {
+	report_end(sc->report, sc_tokens(sc), ast_knots(sc->ast), sc->token_arena);
+}
+
+/**
+ * @brief read whole file into memory
+ *
+ * Regular files are mapped into memory, everything else (e.g. pipes) is read
+ * into a growing buffer.
+ *
+ * @param sc pointer to source code
  * @param raw_code pl0 source code
- * @retval int TRUE or FALSE
+ * @retval void
+ */
+static void sc_load(SOURCECODE sc, FILE *raw_code) {
+	char *buf = NULL, *tmp = NULL;
+	size_t size = 0, length = 0, n;
+
+#ifdef PL_HAVE_MMAP
+	struct stat st;
+	int fd = fileno(raw_code);
+
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		void *map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE,
+				fd, 0);
+
+		if (map != MAP_FAILED) {
+			posix_madvise(map, (size_t) st.st_size, POSIX_MADV_SEQUENTIAL);
+			sc->text = map;
+			sc->text_length = (size_t) st.st_size;
+			sc->text_owner = TEXT_MAPPED;
+			return;
+		}
+	}
+#endif
+
+	do {
+		if (length == size) {
+			size += READ_CHUNK;
+
+			if ((tmp = pl_realloc(buf, size)) == NULL)
+				error(SC_ERR, __FILE__, __func__, __LINE__, ERR_MEMORY);
+
+			buf = tmp;
+		}
+
+		n = fread(buf + length, 1, size - length, raw_code);
+		length += n;
+	} while (n > 0);
+
+	sc->text = buf;
+	sc->text_length = length;
+	sc->text_owner = TEXT_ALLOCATED;
+}
+
+/**
+ * @brief load, lex, parse, resolve, fold and run source code object
+ *
+ * Folding and running follow the options. The phase started last is left
+ * open for sc_compile(), which ends it also if an error unwound out of it,
+ * and stops counting allocations for the report.
+ *
+ * @param pl0_code source code object
+ * @param raw_code pl0 source code or NULL if source text is set already
+ * @retval enum compile_status COMPILE_OK, errors unwind to sc_compile()
  */
-int compile(FILE *raw_code) {
-	SOURCECODE pl0_code = sc_init();
+static enum compile_status sc_run(SOURCECODE pl0_code, FILE *raw_code) {
+	TRPTR report = pl0_code->report;
+
+	/* allocations of this compilation only, others may run on other threads */
+	if (report != NULL)
+		alloc_set_counter(&pl0_code->allocations);
+
+	if (raw_code != NULL) {
+		report_begin(report, "load");
+		sc_load(pl0_code, raw_code);
+		report_end(report, 0, 0, NULL);
+	}
+
+	if (pl0_code->options.stream) {
+		sc_progress(pl0_code, "Start parsing with lexical scanning on demand...\n\n");
+
+		report_begin(report, "lex+parse");
+		lexer_stream(pl0_code);
+	}
+
+	else {
+		sc_progress(pl0_code, "Start lexical scanning...\n");
+
+		report_begin(report, "lex");
+
+		if (pl0_code->options.jobs > 1)
+			lexer_parallel(pl0_code);
+		else
+			lexer(pl0_code);
+
+		sc_report_end(pl0_code);
+
+		sc_progress(pl0_code, "Finished lexical scanning!\n\n");
+		sc_progress(pl0_code, "Start parsing...\n\n");
+
+		report_begin(report, "parse");
+	}
+
+	init_parsing(pl0_code);
+	sc_progress(pl0_code, "Finished parsing!\n\n");
+
+	sc_report_end(pl0_code);
+
+	report_begin(report, "resolve");
+	resolve(pl0_code);
+
+	if (!pl0_code->options.no_fold) {
+		sc_report_end(pl0_code);
+
+		report_begin(report, "fold");
+		fold(pl0_code);
+	}
+
+	if (pl0_code->options.run == RUN_AST) {
+		sc_report_end(pl0_code);
+
+		report_begin(report, "run");
+		interpret(pl0_code);
+	}
+
+	else if (pl0_code->options.run == RUN_VM || pl0_code->options.listing != NULL) {
+		sc_report_end(pl0_code);
+
+		report_begin(report, "emit");
+		emit_bytecode(pl0_code);
+
+		if (pl0_code->options.listing != NULL)
+			bc_print(pl0_code->bytecode, pl0_code->options.listing);
+
+		if (pl0_code->options.run == RUN_VM) {
+			sc_report_end(pl0_code);
+
+			report_begin(report, "run");
+			vm_run(pl0_code);
+		}
+	}
+
+	return COMPILE_OK;
+}
+
+/**
+ * @brief compile source code in a frame which catches all errors
+ *
+ * Errors go to the diagnostic sink of the options and unwind to this
+ * function, which releases everything the compilation allocated. Nothing is
+ * shared with other compilations, so any number of them may run on
+ * different threads at once.
+ *
+ * @param raw_code pl0 source code or NULL for text
+ * @param *text pl0 source code in memory, used if raw_code is NULL
+ * @param length length of text
+ * @param *options compile options or NULL for defaults
+ * @retval enum compile_status
+ */
+static enum compile_status sc_compile(FILE *raw_code, const char *text,
+		size_t length, const struct compile_options *options) {
+	SOURCECODE volatile pl0_code = NULL;
+	ALLOC_COUNTER *outer = alloc_get_counter();
+	DIAG_FRAME frame;
 	int status;
 
-	puts("Start lexical scanning...");
+	diag_push(&frame, (options != NULL) ? options->diagnostic : NULL,
+			(options != NULL) ? options->diagnostic_data : NULL);
 
-	lexer(pl0_code, raw_code);
+	if ((status = setjmp(frame.unwind)) == 0) {
+		pl0_code = sc_init();
+		sc_set_options(pl0_code, options);
 
-	puts("Finished lexical scanning!\n");
+		if (raw_code == NULL)
+			sc_set_text(pl0_code, text, length);
 
-	puts("Start parsing...\n");
+		status = sc_run(pl0_code, raw_code);
+	}
 
-	status = init_parsing(pl0_code);
+	diag_pop(&frame);
+
+	if (pl0_code == NULL)
+		return status;
+
+	sc_report_end(pl0_code);
+	alloc_set_counter(outer);
+
+	print_report(pl0_code->report, stderr, pl0_code->options.time_report);
+
+	sc_write_trace(pl0_code);
 
 	sc_destroy(pl0_code);
 
 	return status;
 }
+
+/**
+ * @brief compile handler which starts lexing and parsing
+ *
+ * @param raw_code pl0 source code
+ * @param *options compile options or NULL for defaults
+ * @retval enum compile_status
+ */
+enum compile_status compile(FILE *raw_code,
+		const struct compile_options *options) {
+	return sc_compile(raw_code, NULL, 0, options);
+}
+
+/**
+ * @brief compile handler for source code which is already in memory
+ *
+ * The buffer is not copied and has to stay valid until compiling finished.
+ *
+ * @param *text pl0 source code
+ * @param length length of source code
+ * @param *options compile options or NULL for defaults
+ * @retval enum compile_status
+ */
+enum compile_status compile_buffer(const char *text, size_t length,
+		const struct compile_options *options) {
+	return sc_compile(NULL, text, length, options);
+}
@@ -27,7 +27,107 @@
 #define __GLOBAL_H
 #include<stdio.h>
 
-extern int compile(FILE *);
+/**
+ * @enum scan_isa instruction sets for scanning character runs in the lexer
+ */
+enum scan_isa {
+	SCAN_AUTO, SCAN_SCALAR, SCAN_SSE2, SCAN_AVX2, SCAN_NEON
+};
+
+/**
+ * @enum report_format how the time report is printed
+ */
+enum report_format {
+	REPORT_NONE, REPORT_TABLE, REPORT_JSON
+};
+
+/**
+ * @enum trace_categories parts of the compiler which record trace events
+ */
+enum trace_categories {
+	TRACE_LEXER, TRACE_PARSER, TRACE_AST, TRACE_SYMTAB, TRACE_CATEGORIES
+};
+
+/**
+ * @enum trace_levels how much a category records, every level includes the ones below
+ */
+enum trace_levels {
+	TRACE_OFF, TRACE_INFO, TRACE_VERBOSE
+};
+
+/**
+ * @enum run_engines how a compiled program is run
+ */
+enum run_engines {
+	RUN_NONE, RUN_AST, RUN_VM
+};
+
+/**
+ * @enum compile_status result of compiling, errors are described by a diagnostic
+ */
+enum compile_status {
+	COMPILE_OK, COMPILE_SYNTAX_ERROR, COMPILE_INTERNAL_ERROR, COMPILE_RUNTIME_ERROR
+};
+
+/**
+ * @enum diagnostic_kinds what went wrong
+ */
+enum diagnostic_kinds {
+	DIAG_INTERNAL, DIAG_SYNTAX, DIAG_RUNTIME
+};
+
+/**
+ * @struct diagnostic
+ *
+ * @brief error reported while compiling, only valid during the sink call
+ */
+struct diagnostic {
+	enum diagnostic_kinds kind; /**< internal error of the compiler or error in source code */
+	int code; /**< one of err_codes, parse_err_codes or run_err_codes */
+	const char *message; /**< text of error */
+	int line; /**< line in source code, 0 for internal errors */
+	const char *module; /**< module which raised internal error, else NULL */
+	const char *file; /**< compiler source file of internal error, else NULL */
+	const char *function; /**< function which raised internal error, else NULL */
+	int file_line; /**< line in compiler source file of internal error */
+};
+
+/**
+ * @brief receives every diagnostic of a compilation
+ *
+ * The first argument is the diagnostic_data of the compile options.
+ */
+typedef void (*diagnostic_sink)(void *, const struct diagnostic *);
+
+/**
+ * @struct compile_options
+ *
+ * @brief switches which select how source code is compiled
+ */
+struct compile_options {
+	int stream; /**< lex on demand with bounded token window instead of lexing whole file first */
+	enum scan_isa isa; /**< instruction set for lexer, SCAN_AUTO chooses at runtime */
+	int jobs; /**< number of threads lexing the whole file, 0 or 1 lexes sequentially */
+	enum report_format time_report; /**< print time, allocations and memory of every phase to standard error */
+	unsigned char trace[TRACE_CATEGORIES]; /**< one of trace_levels for every category */
+	unsigned long trace_events; /**< events kept in trace ring buffer, 0 for default */
+	const char *trace_file; /**< file binary trace is written to, NULL for default */
+	int no_fold; /**< keep constant expressions and dead branches as written */
+	enum run_engines run; /**< engine running the program after compiling, RUN_NONE only compiles */
+	FILE *input; /**< READ takes numbers from here, NULL for standard input */
+	FILE *output; /**< PRINT writes numbers to here, NULL for standard output */
+	FILE *listing; /**< emitted bytecode is listed here, NULL for no listing */
+	FILE *progress; /**< start and end of the phases are reported here, NULL for silence */
+	diagnostic_sink diagnostic; /**< receives errors, NULL prints them to standard error */
+	void *diagnostic_data; /**< first argument of diagnostic sink */
+};
+
+extern enum compile_status compile(FILE *, const struct compile_options *);
+extern enum compile_status compile_buffer(const char *, size_t,
+		const struct compile_options *);
+extern void print_diagnostic(void *, const struct diagnostic *);
+extern int trace_options(struct compile_options *, const char *);
+extern int trace_decode(FILE *, FILE *);
 
 #endif
 
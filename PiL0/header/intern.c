@@ -0,0 +1,199 @@
+/*
+ * PiL0 - PL0 Compiler for Raspberry PI
+ * Copyright (C) 2013  Philipp Wiesner
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file intern.c Library for interning identifier names
+ *
+ * Every distinct identifier of a compilation gets a symbol number. Symbols are
+ * numbered from 0 in order of their first appearance, so later phases can
+ * compare names as integers and index arrays by symbol.
+ *
+ * @ingroup lexer
+ */
+
+#include"frontend.h"
+
+#define INTERN_ERR "Intern-Pool"
+#define INTERN_INIT 256
+
+/**
+ * @struct INTERN_POOL
+ *
+ * @brief hash table from names to symbols
+ *
+ * The name of a symbol is the span of its first appearance in the source text,
+ * so no characters are copied. The slots use open addressing with linear
+ * probing and store symbol + 1 (0 marks an empty slot).
+ **/
+struct INTERN_POOL {
+	SPAN *name; 			/**< name of every symbol */
+	unsigned long *hash; 	/**< hash of every name */
+	size_t count; 			/**< number of symbols */
+	size_t capacity; 		/**< allocated elements of name and hash */
+	SYMBOL *slot; 			/**< hash slots */
+	size_t slots; 			/**< number of slots, power of two */
+};
+
+/**
+ * @brief hash function for names (FNV-1a)
+ *
+ * @param w name
+ * @retval unsigned long hash
+ */
+static unsigned long name_hash(const SPAN w) {
+	unsigned long h = 2166136261UL;
+	size_t i;
+
+	for (i = 0; i < w.length; i++)
+		h = ((h ^ (unsigned char) w.start[i]) * 16777619UL) & 0xFFFFFFFFUL;
+
+	return h;
+}
+
+/**
+ * @brief enlarge slots and insert all symbols again
+ *
+ * @param ip intern pool
+ * @param slots new number of slots, power of two
+ * @retval void
+ */
+static void ip_rehash(IPPTR ip, size_t slots) {
+	SYMBOL *slot = NULL;
+	size_t i;
+
+	if ((slot = pl_calloc(slots, sizeof(*slot))) == NULL)
+		error(INTERN_ERR, __FILE__, __func__, __LINE__, ERR_MEMORY);
+
+	for (i = 0; i < ip->count; i++) {
+		size_t j = ip->hash[i] & (slots - 1);
+
+		while (slot[j] != 0)
+			j = (j + 1) & (slots - 1);
+
+		slot[j] = i + 1;
+	}
+
+	free(ip->slot);
+	ip->slot = slot;
+	ip->slots = slots;
+}
+
+/**
+ * @brief create empty intern pool
+ *
+ * @retval ip new intern pool
+ */
+IPPTR init_intern_pool() {
+	IPPTR ip = NULL;
+
+	if ((ip = pl_malloc(sizeof(*ip))) == NULL)
+		error(INTERN_ERR, __FILE__, __func__, __LINE__, ERR_MEMORY);
+
+	ip->count = 0;
+	ip->capacity = INTERN_INIT;
+	ip->slot = NULL;
+
+	if ((ip->name = pl_malloc(ip->capacity * sizeof(*ip->name))) == NULL
+			|| (ip->hash = pl_malloc(ip->capacity * sizeof(*ip->hash))) == NULL)
+		error(INTERN_ERR, __FILE__, __func__, __LINE__, ERR_MEMORY);
+
+	ip_rehash(ip, INTERN_INIT * 2);
+
+	return ip;
+}
+
+/**
+ * @brief free intern pool
+ *
+ * @param ip intern pool
+ * @retval void
+ */
+void free_intern_pool(IPPTR ip) {
+	if (ip == NULL)
+		return;
+
+	free(ip->name);
+	free(ip->hash);
+	free(ip->slot);
+	free(ip);
+}
+
+/**
+ * @brief return symbol of name and add name if it is new
+ *
+ * @param ip intern pool
+ * @param w name, has to stay valid as long as the intern pool
+ * @retval SYMBOL
+ */
+SYMBOL intern(IPPTR ip, const SPAN w) {
+	unsigned long h = name_hash(w);
+	size_t j = h & (ip->slots - 1);
+
+	for (; ip->slot[j] != 0; j = (j + 1) & (ip->slots - 1)) {
+		SYMBOL s = ip->slot[j] - 1;
+
+		if (ip->hash[s] == h && span_compare(ip->name[s], w) == 0)
+			return s;
+	}
+
+	if (ip->count == ip->capacity) {
+		SPAN *name;
+		unsigned long *hash;
+
+		ip->capacity *= 2;
+
+		if ((name = pl_realloc(ip->name, ip->capacity * sizeof(*name))) == NULL)
+			error(INTERN_ERR, __FILE__, __func__, __LINE__, ERR_MEMORY);
+		ip->name = name;
+
+		if ((hash = pl_realloc(ip->hash, ip->capacity * sizeof(*hash))) == NULL)
+			error(INTERN_ERR, __FILE__, __func__, __LINE__, ERR_MEMORY);
+		ip->hash = hash;
+	}
+
+	ip->name[ip->count] = w;
+	ip->hash[ip->count] = h;
+	ip->slot[j] = ++ip->count;
+
+	/* keep load factor below one half */
+	if (ip->count * 2 > ip->slots)
+		ip_rehash(ip, ip->slots * 2);
+
+	return ip->count - 1;
+}
+
+/**
+ * @brief return name of symbol
+ *
+ * @param ip intern pool
+ * @param s symbol
+ * @retval SPAN empty span for NO_SYMBOL
+ */
+SPAN symbol_name(const IPPTR ip, const SYMBOL s) {
+	return (s < ip->count) ? ip->name[s] : make_span("", 0);
+}
+
+/**
+ * @brief return number of symbols
+ *
+ * @param ip intern pool
+ * @retval size_t
+ */
+size_t size_intern_pool(const IPPTR ip) {
+	return ip->count;
+}
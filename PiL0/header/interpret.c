@@ -0,0 +1,516 @@
+/*
+ * PiL0 - PL0 Compiler for Raspberry PI
+ * Copyright (C) 2013  Philipp Wiesner
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file interpret.c Library for running programs by walking the AST
+ *
+ * The reference engine: every statement and expression knot is looked at
+ * each time it runs, with the addresses resolve() stored in it. Faster
+ * engines have to print the same numbers and report the same errors.
+ *
+ * Nothing recurses on the C stack, so neither deeply nested source nor deep
+ * recursion of PL/0 procedures can overflow it:
+ *
+ * - statements still to run are tasks on a stack, a CALL pushes a task
+ *   which removes the frame of the procedure again
+ * - expressions are evaluated with a stack of pending knots and a stack of
+ *   values
+ * - frames lie one after the other in one array of cells; each frame knows
+ *   its nesting depth and the frame of the scope it was declared in (static
+ *   link), which is followed to reach VAR of enclosing procedures
+ *
+ * CONST have a cell as well, which holds their value, so programs which are
+ * not folded run the same.
+ *
+ * @defgroup interpret Interpreter
+ * @brief tree walking execution of resolved programs
+ * @ingroup interpret
+ */
+
+#include"frontend.h"
+#include"containers.h"
+#include<stdio.h>
+
+/**
+ * @def INTERPRET_MAX_CALLS
+ * @brief nested procedure calls before a program is stopped
+ *
+ * Endless recursion ends with an error instead of taking all memory.
+ */
+#define INTERPRET_MAX_CALLS (1UL << 22)
+
+/**
+ * @enum task_ids what a task on the task stack does
+ */
+enum task_ids {
+	TASK_STMT, 		/**< run statement */
+	TASK_LIST, 		/**< run rest of list from entry next */
+	TASK_RETURN 	/**< remove frame of finished procedure */
+};
+
+/**
+ * @struct TASK
+ *
+ * @brief statement still to run
+ */
+struct TASK {
+	unsigned char tag; 		/**< one of task_ids */
+	AST_STMT_REF ref; 		/**< statement */
+	unsigned int next; 		/**< next entry of list */
+};
+
+/**
+ * @struct FRAME
+ *
+ * @brief cells of a running scope
+ */
+struct FRAME {
+	size_t base; 			/**< first cell */
+	size_t link; 			/**< frame of declaring scope */
+	unsigned int depth; 	/**< static nesting depth */
+};
+
+/**
+ * @struct PENDING
+ *
+ * @brief expression whose branches are evaluated before itself
+ */
+struct PENDING {
+	AST_EXPR_REF ref; 		/**< expression */
+	int ready; 				/**< branches are on the value stack */
+};
+
+/**
+ * @struct SCOPE_CODE
+ *
+ * @brief what a CALL needs to know of a scope
+ */
+struct SCOPE_CODE {
+	AST_STMT_REF body; 		/**< statement of scope or AST_NONE */
+	size_t image; 			/**< first initial cell */
+	size_t size; 			/**< number of cells */
+	unsigned int depth; 	/**< static nesting depth */
+};
+
+DEFINE_VECTOR(cell_vector, int)
+DEFINE_STACK(task_stack, struct TASK)
+DEFINE_STACK(frame_stack, struct FRAME)
+DEFINE_STACK(pending_stack, struct PENDING)
+
+/**
+ * @struct INTERPRETER
+ *
+ * @brief state of a running program
+ */
+struct INTERPRETER {
+	ASTPTR ast; 					/**< resolved program */
+	FILE *in; 						/**< READ takes numbers from here */
+	FILE *out; 						/**< PRINT writes numbers to here */
+	struct SCOPE_CODE *scope; 		/**< every scope, indexed by procedure index */
+	struct cell_vector image; 		/**< initial cells of every scope */
+	struct cell_vector memory; 		/**< frames */
+	struct frame_stack frames; 		/**< running scopes, innermost on top */
+	struct task_stack tasks; 		/**< statements to run */
+	struct pending_stack pending; 	/**< expressions to evaluate */
+	struct cell_vector values; 		/**< evaluated expressions */
+	size_t line; 					/**< line of running statement */
+};
+
+/**
+ * @brief collect body, depth and initial cells of every scope
+ *
+ * VAR start as 0, CONST as their value.
+ *
+ * @param *in interpreter
+ * @retval void
+ */
+static void load_scopes(struct INTERPRETER *in) {
+	size_t n = ast_scopes(in->ast);
+	AST_SCOPE_REF sc;
+
+	in->scope = pl_malloc(n * sizeof(struct SCOPE_CODE));
+
+	if (in->scope == NULL)
+		ERROR_EXCEPT("Interpreter", ERR_MEMORY);
+
+	for (sc = 0; sc < n; sc++) {
+		struct SCOPE_CODE *code = &in->scope[sc];
+		unsigned int slot;
+		int kind, value;
+
+		code->body = scope_get_statement(in->ast, sc);
+		code->image = cell_vector_size(&in->image);
+		code->size = scope_get_size(in->ast, sc);
+		code->depth = scope_get_depth(in->ast, sc);
+
+		for (slot = 0; slot < code->size; slot++) {
+			scope_get_decl(in->ast, sc, slot, &kind, &value);
+			cell_vector_push(&in->image, (kind == CONST) ? value : 0);
+		}
+	}
+}
+
+/**
+ * @brief push frame of scope
+ *
+ * @param *in interpreter
+ * @param sc scope
+ * @param link frame of declaring scope, ignored for main program
+ * @retval void
+ */
+static void enter(struct INTERPRETER *in, const AST_SCOPE_REF sc,
+		const size_t link) {
+	const struct SCOPE_CODE *code = &in->scope[sc];
+	struct FRAME frame;
+	size_t i;
+
+	frame.base = cell_vector_size(&in->memory);
+	frame.link = link;
+	frame.depth = code->depth;
+	frame_stack_push(&in->frames, frame);
+	cell_vector_reserve(&in->memory, frame.base + code->size);
+
+	for (i = 0; i < code->size; i++)
+		cell_vector_push(&in->memory, in->image.data[code->image + i]);
+}
+
+/**
+ * @brief find frame of scope at nesting depth by following static links
+ *
+ * @param *in interpreter
+ * @param depth static nesting depth, at most depth of innermost frame
+ * @retval size_t index of frame
+ */
+static size_t frame_at(const struct INTERPRETER *in, const unsigned int depth) {
+	size_t f = frame_stack_size(&in->frames) - 1;
+
+	while (in->frames.data[f].depth > depth)
+		f = in->frames.data[f].link;
+
+	return f;
+}
+
+/**
+ * @brief cell of VAR or CONST
+ *
+ * @param *in interpreter
+ * @param address resolved address
+ * @retval int* cell, valid until the next frame is pushed
+ */
+static int *cell(struct INTERPRETER *in, const AST_ADDRESS address) {
+	return in->memory.data + in->frames.data[frame_at(in, address.depth)].base
+			+ address.slot;
+}
+
+/**
+ * @brief apply arithmetic operator or report undefined division
+ *
+ * @param *in interpreter
+ * @param op '+', '-', '*' or '/'
+ * @param a left side
+ * @param b right side
+ * @retval int result
+ */
+static int arithmetic(const struct INTERPRETER *in, const int op, const int a,
+		const int b) {
+	int result = 0;
+
+	if (!fold_arithmetic(op, a, b, &result))
+		runError((int) in->line, (b == 0) ? RUN_DIV_ZERO : RUN_DIV_OVERFLOW);
+
+	return result;
+}
+
+/**
+ * @brief push expression on pending stack
+ *
+ * @param *in interpreter
+ * @param ex expression
+ * @param ready branches are evaluated already
+ * @retval void
+ */
+static void pend(struct INTERPRETER *in, const AST_EXPR_REF ex, const int ready) {
+	struct PENDING p;
+
+	p.ref = ex;
+	p.ready = ready;
+	pending_stack_push(&in->pending, p);
+}
+
+/**
+ * @brief evaluate expression
+ *
+ * Binary knots are pending twice: first to push their branches, then to
+ * combine the values the branches left on the value stack.
+ *
+ * @param *in interpreter
+ * @param ex expression
+ * @retval int value
+ */
+static int evaluate(struct INTERPRETER *in, const AST_EXPR_REF ex) {
+	ASTPTR ast = in->ast;
+	int a, b;
+
+	pend(in, ex, 0);
+
+	while (!pending_stack_empty(&in->pending)) {
+		struct PENDING p = pending_stack_pop(&in->pending);
+
+		switch (expr_get_tag(ast, p.ref)) {
+		case (EXPR_NUMBER):
+			cell_vector_push(&in->values, expr_get_number(ast, p.ref));
+			break;
+
+		case (EXPR_IDENTIFIER):
+			cell_vector_push(&in->values, *cell(in, expr_get_address(ast, p.ref)));
+			break;
+
+		case (EXPR_ARITH):
+		case (EXPR_REL):
+			if (!p.ready) {
+				pend(in, p.ref, 1);
+				pend(in, expr_get_branch(ast, p.ref), 0);
+				pend(in, (expr_get_tag(ast, p.ref) == EXPR_ARITH) ?
+						expr_get_arithmetic_left(ast, p.ref) :
+						expr_get_relation_left(ast, p.ref), 0);
+				break;
+			}
+
+			b = cell_vector_pop(&in->values);
+			a = cell_vector_pop(&in->values);
+
+			cell_vector_push(&in->values,
+					(expr_get_tag(ast, p.ref) == EXPR_ARITH) ?
+							arithmetic(in, expr_get_operator(ast, p.ref), a, b) :
+							fold_relation(expr_get_operator(ast, p.ref), a, b));
+			break;
+
+		case (EXPR_UNARY):
+		case (EXPR_ODD):
+			if (!p.ready) {
+				pend(in, p.ref, 1);
+				pend(in, expr_get_branch(ast, p.ref), 0);
+				break;
+			}
+
+			a = cell_vector_pop(&in->values);
+
+			cell_vector_push(&in->values,
+					(expr_get_tag(ast, p.ref) == EXPR_UNARY) ?
+							arithmetic(in, '-', 0, a) : (a % 2 != 0));
+			break;
+		}
+	}
+
+	return cell_vector_pop(&in->values);
+}
+
+/**
+ * @brief push task on task stack
+ *
+ * @param *in interpreter
+ * @param tag one of task_ids
+ * @param st statement
+ * @param next next entry of list
+ * @retval void
+ */
+static void schedule(struct INTERPRETER *in, const int tag,
+		const AST_STMT_REF st, const unsigned int next) {
+	struct TASK t;
+
+	t.tag = (unsigned char) tag;
+	t.ref = st;
+	t.next = next;
+	task_stack_push(&in->tasks, t);
+}
+
+/**
+ * @brief run CALL or READ
+ *
+ * @param *in interpreter
+ * @param st statement
+ * @retval void
+ */
+static void care(struct INTERPRETER *in, const AST_STMT_REF st) {
+	AST_ADDRESS address = stmt_get_address(in->ast, st);
+	int value;
+
+	if (stmt_get_care(in->ast, st) == READ) {
+		if (fscanf(in->in, "%d", &value) != 1)
+			runError((int) in->line, RUN_NO_INPUT);
+
+		*cell(in, address) = value;
+		return;
+	}
+
+	if (frame_stack_size(&in->frames) > INTERPRET_MAX_CALLS)
+		runError((int) in->line, RUN_CALL_DEPTH);
+
+	/* the callee lies one level below the scope it was declared in */
+	enter(in, address.slot, frame_at(in, address.depth));
+	schedule(in, TASK_RETURN, st, 0);
+
+	if (in->scope[address.slot].body != AST_NONE)
+		schedule(in, TASK_STMT, in->scope[address.slot].body, 0);
+}
+
+/**
+ * @brief run statement
+ *
+ * Compound statements only schedule their parts.
+ *
+ * @param *in interpreter
+ * @param st statement
+ * @retval void
+ */
+static void execute(struct INTERPRETER *in, const AST_STMT_REF st) {
+	ASTPTR ast = in->ast;
+	const AST_STMT_REF *list;
+	size_t count;
+	int value;
+
+	in->line = stmt_get_line(ast, st);
+
+	switch (stmt_get_tag(ast, st)) {
+	case (STMT_IF):
+		if (evaluate(in, stmt_get_jumpfor_condition(ast, st)))
+			schedule(in, TASK_STMT, stmt_get_jumpfor_statement(ast, st), 0);
+		break;
+
+	case (STMT_WHILE):
+		/* the loop runs again after its statement */
+		if (evaluate(in, stmt_get_jumpbac_condition(ast, st))) {
+			schedule(in, TASK_STMT, st, 0);
+			schedule(in, TASK_STMT, stmt_get_jumpbac_statement(ast, st), 0);
+		}
+		break;
+
+	case (STMT_ASSIGN):
+		value = evaluate(in, stmt_get_expression(ast, st));
+		*cell(in, stmt_get_address(ast, st)) = value;
+		break;
+
+	case (STMT_LIST):
+		list = stmt_get_list(ast, st, &count);
+
+		if (count > 1)
+			schedule(in, TASK_LIST, st, 1);
+
+		if (count > 0)
+			schedule(in, TASK_STMT, list[0], 0);
+		break;
+
+	case (STMT_CARE):
+		care(in, st);
+		break;
+
+	case (STMT_PRINT):
+		fprintf(in->out, "%d\n", evaluate(in, stmt_get_expression(ast, st)));
+		break;
+	}
+}
+
+/**
+ * @brief run tasks until the task stack is empty
+ *
+ * @param *in interpreter
+ * @retval void
+ */
+static void run(struct INTERPRETER *in) {
+	const AST_STMT_REF *list;
+	size_t count;
+
+	while (!task_stack_empty(&in->tasks)) {
+		struct TASK t = task_stack_pop(&in->tasks);
+
+		switch (t.tag) {
+		case (TASK_STMT):
+			execute(in, t.ref);
+			break;
+
+		case (TASK_LIST):
+			list = stmt_get_list(in->ast, t.ref, &count);
+
+			if (t.next + 1 < count)
+				schedule(in, TASK_LIST, t.ref, t.next + 1);
+
+			schedule(in, TASK_STMT, list[t.next], 0);
+			break;
+
+		case (TASK_RETURN):
+			cell_vector_truncate(&in->memory,
+					frame_stack_pop(&in->frames).base);
+			break;
+		}
+	}
+}
+
+/**
+ * @brief run resolved program
+ *
+ * READ and PRINT use the input and output of the compile options, standard
+ * input and output by default. Errors at run time are reported like syntax
+ * errors, with the line of the statement.
+ *
+ * @param code pointer to source code object
+ * @retval void
+ */
+void interpret(SOURCECODE code) {
+	const struct compile_options *options = sc_get_options(code);
+	struct INTERPRETER in;
+	DIAG_FRAME frame;
+	int status;
+
+	in.ast = sc_get_ast(code);
+	in.in = (options->input != NULL) ? options->input : stdin;
+	in.out = (options->output != NULL) ? options->output : stdout;
+	in.scope = NULL;
+	in.line = 0;
+	cell_vector_init(&in.image);
+	cell_vector_init(&in.memory);
+	frame_stack_init(&in.frames);
+	task_stack_init(&in.tasks);
+	pending_stack_init(&in.pending);
+	cell_vector_init(&in.values);
+
+	/* release the program state before an error unwinds further */
+	diag_push(&frame, NULL, NULL);
+
+	if ((status = setjmp(frame.unwind)) == 0 && ast_scopes(in.ast) > 0) {
+		load_scopes(&in);
+		enter(&in, 0, 0);
+
+		if (in.scope[0].body != AST_NONE)
+			schedule(&in, TASK_STMT, in.scope[0].body, 0);
+
+		run(&in);
+	}
+
+	diag_pop(&frame);
+	fflush(in.out);
+	free(in.scope);
+	cell_vector_free(&in.image);
+	cell_vector_free(&in.memory);
+	frame_stack_free(&in.frames);
+	task_stack_free(&in.tasks);
+	pending_stack_free(&in.pending);
+	cell_vector_free(&in.values);
+
+	if (status != COMPILE_OK)
+		diag_raise(NULL, status);
+}
@@ -35,8 +35,31 @@
  * @brief Stringtable of all keywords longer than 1 character
  * 
  **/
-char *keywords[] = { "BEGIN", "CALL", "CONST", "DO", "END", "IF", "ODD",
+static const char *const keywords[] = { "BEGIN", "CALL", "CONST", "DO", "END", "IF", "ODD",
 		"PRINT", "PROCEDURE", "READ", "THEN", "VAR", "WHILE", "PASS", "EQ",
 		"GE", "LE", "NE", NULL };
 
+/**
+ * @def KEYWORD_HASH(first, last, length)
+ * @brief perfect hash over first character, last character and length of a keyword
+ *
+ * Maps every entry of keywords[] to a distinct slot of keyword_slot[].
+ * If keywords are added, search new factors for which this still holds and
+ * regenerate keyword_slot[].
+ **/
+#define KEYWORD_HASH_SIZE 32
+#define KEYWORD_HASH(first, last, length) \
+	(((first) + ((last) << 3) - (last) + (length)) & (KEYWORD_HASH_SIZE - 1))
+
+/**
+ * @var keyword_slot[]
+ * @brief index of keyword in keywords[] for every hash slot or -1 for an empty slot
+ **/
+static const signed char keyword_slot[KEYWORD_HASH_SIZE] = {
+	-1,  7, -1, -1,  4, -1, -1, -1,		/* PRINT, END */
+	-1,  0, -1, -1, 15, -1,  6,  3,		/* BEGIN, GE, ODD, DO */
+	-1, 16,  9, 17,  2,  5, -1, 11,		/* LE, READ, NE, CONST, IF, VAR */
+	-1, 13, 10,  1,  8, -1, 14, 12		/* PASS, THEN, CALL, PROCEDURE, EQ, WHILE */
+};
+
 #endif
@@ -20,6 +20,8 @@
  * @file lexer.c Library for Token-Stream
  *
  * Contains data structures and functions to implement a linear token stream.
+ * The scanner works on the source text held by the source code object and
+ * generates tokens which refer to the text by spans instead of copying it.
  *
  *
  * @defgroup lexer Lexical Scanner
@@ -27,179 +29,608 @@
  * @ingroup global lexer
  */
 
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200112L
+#define PL_HAVE_PTHREAD
+#endif
+
 #include"frontend.h"
 #include"language.h"
+#include<limits.h>
+
+#ifdef PL_HAVE_PTHREAD
+#include<pthread.h>
+#endif
 
 #define LEXER "Lexer"
+#define TOKEN_STREAM_INIT 256
+#define TOKEN_WINDOW 64
+#define CHUNK_MIN (1 << 20)
+#define CHUNKS_PER_JOB 4
+
+/**
+ * @brief Returns the ID of a keyword
+ *
+ * Looks up the single candidate keyword through the perfect hash and compares
+ * only against this one.
+ *
+ * @param s word to be checked
+ * @param length length of word
+ * @retval int either keyword ID or IDENTIFIER if word is not stored in keyword array
+ **/
+static int get_keyID(const char *s, size_t length) {
+	int i = keyword_slot[KEYWORD_HASH((unsigned char) s[0],
+			(unsigned char) s[length - 1], length)];
+
+	if (i >= 0 && strncmp(keywords[i], s, length) == 0
+			&& keywords[i][length] == '\0')
+		return BEGIN + i;
+
+	return IDENTIFIER;
+}
 
-typedef struct {
-	char w[MAX_LENGTH]; /**< keyword */
-	int ID; /**< keyword identifier */
 /**
- * @struct keyword
+ * @struct LEXER_STATE
  *
- * @brief Keyword structure for storing initial keywords
+ * @brief position of the scanner inside the source text
  *
- * Stores string and ID of the language keywords like DO, WHILE, IF, etc.
+ * Keeps everything needed to continue scanning, so tokens can be produced
+ * all at once or on demand.
  **/
-} keyword;
+struct LEXER_STATE {
+	const char *p; 		/**< next character to scan */
+	const char *end; 	/**< end of source text */
+	size_t line; 		/**< current line number */
+	TSPTR ts; 			/**< token stream tokens are appended to */
+	IPPTR ip; 			/**< intern pool for identifier names */
+	const CHAR_SCANNER *scan; /**< functions for skipping character runs */
+	const TRACER *trace; /**< tracer for scanned tokens */
+};
+
+/* scanned tokens are traced on level verbose, lines count from chunk start */
+#define LEX_TRACE(ls, type, value) \
+	TRACE((ls)->trace, TRACE_LEXER, TRACE_VERBOSE, EV_LEX_TOKEN, type, value, \
+			(ls)->line)
 
 /**
- * @brief Returns the number of keyword
+ * @brief scan next token and append it to the token stream
  *
- * Checks if the given word is a keyword and returns its position number from the key_array
+ * Skips white space and control characters before the token.
  *
- * @param k array of keywords
- * @param s string to be checked
- * @retval i either position number of keyword or -1 if word is not stored in keyword array
+ * @param *ls lexer state
+ * @retval int 1 if a token was appended, 0 at end of source text
  **/
-static int get_keyNUM(const keyword *k, const char *s) {
-	int i;
+static int scan_token(struct LEXER_STATE *ls) {
+	const char *p = ls->p, *end = ls->end;
+
+	while (p < end) {
+		const char *start = p;
+		int c = (unsigned char) *p, cc = char_class[c];
+
+		if (cc & CC_SPACE)
+			p = ls->scan->skip_space(p, end, &ls->line);
+
+		/* read compare operators */
+		else if ((c == '=' || c == '>' || c == '<' || c == '!') && p + 1 < end
+				&& p[1] == '=') {
+			int ID = (c == '=') ? EQ : (c == '>') ? GE : (c == '<') ? LE : NE;
+
+			ls->p = p + 2;
+			append_token(ls->ts, 'w', make_span(start, 2), ID, NO_SYMBOL,
+					ls->line);
+			LEX_TRACE(ls, 'w', ID);
+			return 1;
+		}
+
+		/* read words or identifier */
+		else if (cc & CC_ALPHA) {
+			SPAN w;
+			int ID;
+
+			ls->p = p = ls->scan->skip_alnum(p + 1, end);
+			w = make_span(start, p - start);
+			ID = get_keyID(start, p - start);
+			append_token(ls->ts, 'w', w, ID,
+					(ID == IDENTIFIER) ? intern(ls->ip, w) : NO_SYMBOL, ls->line);
+			LEX_TRACE(ls, 'w', ID);
+			return 1;
+		}
+
+		/* read numbers */
+		else if (cc & CC_DIGIT) {
+			const char *q;
+			int n = 0;
 
-	for (i = 0; keywords[i] != NULL; i++)
-		if (strcmp(k[i].w, s) == 0)
-			return i;
+			ls->p = p = ls->scan->skip_digit(p + 1, end);
 
-	return -1;
+			/* numbers have to fit into the int cells holding them */
+			for (q = start; q < p; q++) {
+				if (n > (INT_MAX - (*q - '0')) / 10)
+					parseError((int) ls->line, SYN_NUM_RANGE);
+
+				n = n * 10 + (*q - '0');
+			}
+
+			append_token(ls->ts, 'n', make_span(start, p - start), n, NO_SYMBOL,
+					ls->line);
+			LEX_TRACE(ls, 'n', n);
+			return 1;
+		}
+
+		/* read tokens */
+		else {
+			ls->p = p + 1;
+			append_token(ls->ts, 't', make_span(start, 1), 0, NO_SYMBOL,
+					ls->line);
+			LEX_TRACE(ls, 't', (unsigned char) c);
+			return 1;
+		}
+	}
+
+	ls->p = p;
+	return 0;
 }
 
 /**
- * @brief counts of keywords
+ * @brief choose character scanner from compile options
+ *
+ * Falls back to the best supported instruction set if the requested one is not available.
+ *
+ * @param *code object which stores all data for source code
+ * @retval CHAR_SCANNER*
+ **/
+static const CHAR_SCANNER *lexer_scanner(SOURCECODE code) {
+	const CHAR_SCANNER *scan = get_scanner(sc_get_options(code)->isa);
+
+	return (scan != NULL) ? scan : get_scanner(SCAN_AUTO);
+}
+
+/**
+ * @brief Function for lexical scanning
  *
- * @retval i number of keywords
+ * Reads source text and convert each element to one token / word / number and add it to the token stream.
+ * Words are stored as spans into the source text and numbers are converted while scanning,
+ * so no characters are copied. Identifier names are interned into symbols.
+ *
+ * @param *code object which stores all data for source code
+ * @retval void
  **/
-static unsigned int get_keySize() {
-	int i = 1;
+void lexer(SOURCECODE code) {
+	struct LEXER_STATE ls;
+
+	ls.p = sc_get_text(code);
+	ls.end = ls.p + sc_get_text_length(code);
+	ls.line = 1;
+	ls.scan = lexer_scanner(code);
+	ls.ip = sc_get_ip(code);
+	ls.trace = sc_get_tracer(code);
+	ls.ts = init_token_stream(sc_get_text(code), TOKEN_STREAM_INIT);
+	sc_set_ts(code, ls.ts);
+
+	while (scan_token(&ls))
+		;
+
+	end_token_stream(ls.ts, ls.line);
+	TRACE(ls.trace, TRACE_LEXER, TRACE_INFO, EV_LEX_END, ts_count(ls.ts),
+			ls.line, 0);
+}
 
-	while (keywords[i] != NULL)
-		i++;
+/**
+ * @brief fill free space of token window
+ *
+ * Called by the token stream when the parser has read all scanned tokens.
+ * Writes the end token once the source text is exhausted.
+ *
+ * @param *state lexer state
+ * @retval int 1 if the lexer has more tokens, 0 after end token was written
+ **/
+static int lexer_refill(void *state) {
+	struct LEXER_STATE *ls = state;
+
+	while (ts_space(ls->ts) > 0)
+		if (!scan_token(ls)) {
+			end_token_stream(ls->ts, ls->line);
+			TRACE(ls->trace, TRACE_LEXER, TRACE_INFO, EV_LEX_END,
+					ts_count(ls->ts), ls->line, 0);
+			return 0;
+		}
 
-	return i;
+	return 1;
 }
 
 /**
- * @brief creates an array of all keywords
+ * @brief Function for lexical scanning on demand
+ *
+ * Sets up a token window of TOKEN_WINDOW elements. Tokens are scanned in
+ * batches whenever the parser reaches the end of the window, so memory for
+ * tokens stays constant however large the source text is.
  *
- * @retval reskeys pointer to keyword array
+ * @param *code object which stores all data for source code
+ * @retval void
  **/
-static keyword *init_ReservedKeys() {
-	keyword *resKeys = NULL;
+void lexer_stream(SOURCECODE code) {
+	struct LEXER_STATE *ls = NULL;
 
-	int i;
+	if ((ls = pl_malloc(sizeof(*ls))) == NULL)
+		error(LEXER, __FILE__, __func__, __LINE__, ERR_MEMORY);
 
-	if ((resKeys = malloc(sizeof(*resKeys) * get_keySize())) == NULL)
-		error("KEYgetWord(lexical_scan)", __FILE__, __func__, __LINE__,
-				ERR_MEMORY);
+	ls->p = sc_get_text(code);
+	ls->end = ls->p + sc_get_text_length(code);
+	ls->line = 1;
+	ls->scan = lexer_scanner(code);
+	ls->ip = sc_get_ip(code);
+	ls->trace = sc_get_tracer(code);
+	ls->ts = init_token_stream(sc_get_text(code), TOKEN_WINDOW);
+	sc_set_ts(code, ls->ts);
 
-	for (i = 0; keywords[i] != NULL; i++) {
-		strcpy(resKeys[i].w, keywords[i]);
-		resKeys[i].ID = 256 + i;
-	}
+	ts_set_refill(ls->ts, lexer_refill, ls);
 
-	return resKeys;
+	if (!lexer_refill(ls))
+		ts_set_refill(ls->ts, NULL, ls);
 }
 
 /**
- * @brief Function for lexical scanning
+ * @struct LEX_CHUNK
  *
- * Reads input code and convert each element to one token / word / number and add it to the token stream
+ * @brief part of the source text which is lexed on its own
  *
- * @param *code object which stores all data for source code
- * @param *raw_code pl0 source code
- * @retval void
+ * Chunks end behind a newline, so no token crosses a chunk border. Each chunk
+ * counts lines from 0 and interns into its own pool, line numbers and symbols
+ * are corrected when the chunks are stitched together.
  **/
-void lexer(SOURCECODE code, FILE *raw_code) {
-	int c, lineNumber = 1;
-	keyword *reserved = init_ReservedKeys();
-	QUEUE token_stream = NULL;
+struct LEX_CHUNK {
+	struct LEXER_STATE ls; 	/**< lexer state with own token stream and intern pool */
+	TSPTR ts; 				/**< merged token stream */
+	size_t first; 			/**< index of first token in merged token stream */
+	size_t line_base; 		/**< line number of first line of chunk */
+	SYMBOL *symbols; 		/**< maps chunk symbols to symbols of source code */
+};
 
-	sc_set_ts(code, init_queue());
-	token_stream = sc_get_ts(code);
+/**
+ * @struct LEX_JOBS
+ *
+ * @brief chunks shared by the threads of the parallel lexer
+ **/
+struct LEX_JOBS {
+	const char *text; 			/**< source text split into chunks */
+	struct LEX_CHUNK *chunk; 	/**< array of chunks */
+	size_t count; 				/**< number of chunks */
+	size_t next; 				/**< next chunk nobody works on yet */
+	void (*work)(struct LEX_CHUNK *); /**< function applied to every chunk */
+	int failed; 				/**< one of compile_status, set by first error */
+	struct diagnostic diagnostic; /**< error earliest in source text */
+	struct LEX_CHUNK *failed_chunk; /**< chunk of that error, its line counts from chunk start */
+	ALLOC_COUNTER *counter; 	/**< allocations of the compilation, NULL if not counted */
+	TRPTR report; 				/**< time report helper threads add their CPU time to */
+#ifdef PL_HAVE_PTHREAD
+	pthread_mutex_t lock; 		/**< protects next, failed, diagnostic and report */
+#endif
+};
 
+/**
+ * @struct LEX_WORKER
+ *
+ * @brief what the error sink of one thread knows
+ **/
+struct LEX_WORKER {
+	struct LEX_JOBS *jobs; 		/**< shared jobs */
+	struct LEX_CHUNK *chunk; 	/**< chunk the thread works on, NULL before the first */
+};
 
-	while ((c = fgetc(raw_code)) != EOF) {
-		if (c == 10 || c == 13)
-			lineNumber++;
+/**
+ * @brief lex chunk into its own token stream
+ *
+ * @param *chunk chunk of source text
+ * @retval void
+ **/
+static void chunk_lex(struct LEX_CHUNK *chunk) {
+	while (scan_token(&chunk->ls))
+		;
+}
 
-		if (!((iscntrl(c) || isspace(c)))) {
-			char w[30] = "";
-			int i = 0, key_NUM = 0, ident = IDENTIFIER;
+/**
+ * @brief copy tokens of chunk into merged token stream and release chunk
+ *
+ * @param *chunk chunk of source text
+ * @retval void
+ **/
+static void chunk_fill(struct LEX_CHUNK *chunk) {
+	ts_fill(chunk->ts, chunk->first, chunk->ls.ts, chunk->line_base,
+			chunk->symbols);
+
+	free_token_stream(chunk->ls.ts);
+	free_intern_pool(chunk->ls.ip);
+	chunk->ls.ts = NULL;
+	chunk->ls.ip = NULL;
+	chunk->symbols = NULL;
+}
 
-			/* read compare operators */
-			if (c == '=' || c == '>' || c == '<' || c == '!') {
-				w[i] = c;
+/**
+ * @brief keep error earliest in source text for the calling thread
+ *
+ * Chunks are handed out in order and no chunk is taken after an error, so
+ * all chunks before a failed one are lexed to their end. Keeping the error
+ * of the lowest chunk reports the same error whichever thread failed first.
+ *
+ * @param *arg worker which failed
+ * @param *d diagnostic
+ * @retval void
+ **/
+static void lex_failed(void *arg, const struct diagnostic *d) {
+	struct LEX_WORKER *worker = arg;
+	struct LEX_JOBS *jobs = worker->jobs;
+
+#ifdef PL_HAVE_PTHREAD
+	pthread_mutex_lock(&jobs->lock);
+#endif
+	if (jobs->failed == COMPILE_OK || (jobs->failed_chunk != NULL
+			&& (worker->chunk == NULL || worker->chunk < jobs->failed_chunk))) {
+		jobs->failed = (d->kind == DIAG_INTERNAL) ? COMPILE_INTERNAL_ERROR :
+				COMPILE_SYNTAX_ERROR;
+		jobs->diagnostic = *d;
+		jobs->failed_chunk = worker->chunk;
+	}
+#ifdef PL_HAVE_PTHREAD
+	pthread_mutex_unlock(&jobs->lock);
+#endif
+}
 
-				if ((c = fgetc(raw_code)) == '=') {
-					w[i + 1] = c;
+/**
+ * @brief take chunks and apply the job function until all are done
+ *
+ * Errors cannot unwind across threads, they end the work of all threads and
+ * are raised again by lexer_parallel().
+ * Allocations count for the compilation of the thread which started the jobs.
+ *
+ * @param *arg shared jobs
+ * @retval void* NULL
+ **/
+static void *lex_worker(void *arg) {
+	struct LEX_JOBS *jobs = arg;
+	struct LEX_WORKER worker;
+	DIAG_FRAME frame;
+	size_t i;
+
+	worker.jobs = jobs;
+	worker.chunk = NULL;
+	alloc_set_counter(jobs->counter);
+	diag_push(&frame, lex_failed, &worker);
+
+	if (setjmp(frame.unwind) == 0)
+		for (;;) {
+#ifdef PL_HAVE_PTHREAD
+			pthread_mutex_lock(&jobs->lock);
+#endif
+			i = (jobs->failed == COMPILE_OK) ? jobs->next++ : jobs->count;
+#ifdef PL_HAVE_PTHREAD
+			pthread_mutex_unlock(&jobs->lock);
+#endif
+
+			if (i >= jobs->count)
+				break;
+
+			worker.chunk = &jobs->chunk[i];
+			(*jobs->work)(worker.chunk);
+		}
 
-					if (strcmp(w, "==") == 0)
-						key_NUM = get_keyNUM(reserved, "EQ");
+	diag_pop(&frame);
+	return NULL;
+}
 
-					if (strcmp(w, ">=") == 0)
-						key_NUM = get_keyNUM(reserved, "GE");
+#ifdef PL_HAVE_PTHREAD
+/**
+ * @brief work on chunks on a thread of its own
+ *
+ * The time report only measures the calling thread, so the CPU time of the
+ * thread is added to it.
+ *
+ * @param *arg shared jobs
+ * @retval void* NULL
+ **/
+static void *lex_helper(void *arg) {
+	struct LEX_JOBS *jobs = arg;
+	double cpu = report_thread_cpu();
 
-					if (strcmp(w, "<=") == 0)
-						key_NUM = get_keyNUM(reserved, "LE");
+	lex_worker(jobs);
+	cpu = report_thread_cpu() - cpu;
 
-					if (strcmp(w, "!=") == 0)
-						key_NUM = get_keyNUM(reserved, "NE");
+	pthread_mutex_lock(&jobs->lock);
+	report_add_cpu(jobs->report, cpu);
+	pthread_mutex_unlock(&jobs->lock);
+	return NULL;
+}
+#endif
 
-					append(token_stream,
-							generate_token(reserved[key_NUM].w,
-									&reserved[key_NUM].ID, &lineNumber));
-				}
+/**
+ * @brief apply function to all chunks on a number of threads
+ *
+ * The calling thread works as well. Without thread support all chunks are
+ * processed by the calling thread.
+ *
+ * @param *jobs chunks
+ * @param work function applied to every chunk
+ * @param threads number of threads
+ * @retval int COMPILE_OK or status of first error of any thread
+ **/
+static int lex_run(struct LEX_JOBS *jobs, void (*work)(struct LEX_CHUNK *),
+		int threads) {
+#ifdef PL_HAVE_PTHREAD
+	pthread_t *worker = NULL;
+	int i, started = 0;
+#endif
+
+	jobs->next = 0;
+	jobs->work = work;
+	jobs->failed = COMPILE_OK;
+	jobs->failed_chunk = NULL;
+	jobs->counter = alloc_get_counter();
+
+#ifdef PL_HAVE_PTHREAD
+	if (threads > 1 && (worker = pl_malloc((threads - 1) * sizeof(*worker))) == NULL)
+		error(LEXER, __FILE__, __func__, __LINE__, ERR_MEMORY);
+
+	for (i = 0; i < threads - 1; i++)
+		if (pthread_create(&worker[started], NULL, lex_helper, jobs) == 0)
+			started++;
+#else
+	(void) threads;
+#endif
+
+	lex_worker(jobs);
+
+#ifdef PL_HAVE_PTHREAD
+	for (i = 0; i < started; i++)
+		pthread_join(worker[i], NULL);
+
+	free(worker);
+#endif
+
+	return jobs->failed;
+}
 
-				else
-					append(token_stream,
-							generate_token(w, &ident, &lineNumber));
-			}
+/**
+ * @brief release chunks after an error and raise it on the calling thread
+ *
+ * The line of a syntax error is turned from chunk into source text line.
+ *
+ * @param *jobs chunks
+ * @param scratch arena chunk arrays were allocated from
+ * @retval void
+ **/
+static void lex_abort(struct LEX_JOBS *jobs, ARPTR scratch) {
+	const char *p = jobs->text, *nl;
+	size_t i;
 
-			/* read words or identifier */
-			if (isalpha(c)) {
-				w[i] = c;
-				c = fgetc(raw_code);
+	/* add the lines before the chunk to the line of a syntax error */
+	if (jobs->diagnostic.kind == DIAG_SYNTAX && jobs->failed_chunk != NULL) {
+		const char *start = (jobs->failed_chunk == jobs->chunk) ? jobs->text :
+				(jobs->failed_chunk - 1)->ls.end;
 
-				while (isalnum(c)) {
-					w[++i] = c;
-					c = fgetc(raw_code);
-				}
+		jobs->diagnostic.line++;
 
-				key_NUM = get_keyNUM(reserved, w);
+		while ((nl = memchr(p, '\n', start - p)) != NULL) {
+			jobs->diagnostic.line++;
+			p = nl + 1;
+		}
+	}
 
-				if (key_NUM >= 0)
-					append(token_stream,
-							generate_token(reserved[key_NUM].w,
-									&reserved[key_NUM].ID, &lineNumber));
-				else
-					append(token_stream,
-							generate_token(w, &ident, &lineNumber));
+	for (i = 0; i < jobs->count; i++) {
+		free_token_stream(jobs->chunk[i].ls.ts);
+		free_intern_pool(jobs->chunk[i].ls.ip);
+	}
 
-				c = ungetc(c, raw_code);
-			}
+#ifdef PL_HAVE_PTHREAD
+	pthread_mutex_destroy(&jobs->lock);
+#endif
 
-			/*read numbers */
-			if (isdigit(c)) {
-				ident = NUM;
-				w[i] = c;
-				c = fgetc(raw_code);
+	arena_reset(scratch);
+	diag_raise(&jobs->diagnostic, jobs->failed);
+}
 
-				while (isdigit(c)) {
-					w[++i] = c;
-					c = fgetc(raw_code);
-				}
+/**
+ * @brief Function for lexical scanning on several threads
+ *
+ * Splits the source text at line ends into chunks which are lexed on
+ * their own, then stitches their tokens together. Line numbers are shifted
+ * and symbols are interned again in order of the chunks, so the token stream
+ * is the same the sequential lexer() produces. Small source texts are
+ * lexed sequentially.
+ *
+ * @param *code object which stores all data for source code
+ * @retval void
+ **/
+void lexer_parallel(SOURCECODE code) {
+	const char *text = sc_get_text(code), *end = text + sc_get_text_length(code);
+	const CHAR_SCANNER *scan = lexer_scanner(code);
+	IPPTR ip = sc_get_ip(code);
+	ARPTR scratch = sc_get_token_arena(code);
+	int threads = sc_get_options(code)->jobs;
+	struct LEX_JOBS jobs;
+	size_t i, n, tokens = 0, line = 1;
+	TSPTR ts;
+
+	n = (threads > 1) ? (size_t) threads * CHUNKS_PER_JOB : 1;
+
+	if (n > (size_t) (end - text) / CHUNK_MIN)
+		n = (size_t) (end - text) / CHUNK_MIN;
+
+	if (n < 2) {
+		lexer(code);
+		return;
+	}
 
-				append(token_stream, generate_token(w, &ident, &lineNumber));
-				c = ungetc(c, raw_code);
-			}
+	jobs.text = text;
+	jobs.report = sc_get_report(code);
+	jobs.chunk = arena_alloc(scratch, n * sizeof(*jobs.chunk));
 
-			/* read tokens */
-			if (strlen(w) == 0) {
-				w[i] = c;
-				append(token_stream, generate_token(w, &ident, &lineNumber));
-			}
+	/* split behind the first newline after every n-th part of the text */
+	jobs.count = 0;
+
+	while (text < end) {
+		struct LEX_CHUNK *chunk = &jobs.chunk[jobs.count++];
+		const char *stop = end, *nl;
+
+		if (jobs.count < n) {
+			stop = text + (end - text) / (n - jobs.count + 1);
+			nl = memchr(stop, '\n', end - stop);
+			stop = (nl != NULL) ? nl + 1 : end;
 		}
+
+		chunk->ls.p = text;
+		chunk->ls.end = stop;
+		chunk->ls.line = 0;
+		chunk->ls.scan = scan;
+		chunk->ls.ip = init_intern_pool();
+		chunk->ls.trace = sc_get_tracer(code);
+		chunk->ls.ts = init_token_stream(sc_get_text(code), TOKEN_STREAM_INIT);
+		chunk->symbols = NULL;
+		text = stop;
+	}
+
+#ifdef PL_HAVE_PTHREAD
+	pthread_mutex_init(&jobs.lock, NULL);
+#endif
+
+	if (lex_run(&jobs, chunk_lex, threads) != COMPILE_OK)
+		lex_abort(&jobs, scratch);
+
+	/* count tokens and lines, intern names of every chunk in source text order */
+	for (i = 0; i < jobs.count; i++) {
+		struct LEX_CHUNK *chunk = &jobs.chunk[i];
+		size_t k, symbols = size_intern_pool(chunk->ls.ip);
+
+		chunk->first = tokens;
+		chunk->line_base = line;
+		tokens += ts_count(chunk->ls.ts);
+		line += chunk->ls.line;
+		TRACE(chunk->ls.trace, TRACE_LEXER, TRACE_INFO, EV_LEX_CHUNK, i,
+				ts_count(chunk->ls.ts), chunk->ls.line);
+
+		chunk->symbols = arena_alloc(scratch, symbols * sizeof(*chunk->symbols));
+
+		for (k = 0; k < symbols; k++)
+			chunk->symbols[k] = intern(ip, symbol_name(chunk->ls.ip, k));
 	}
+
+	ts = init_token_stream(sc_get_text(code), TOKEN_STREAM_INIT);
+	sc_set_ts(code, ts);
+	ts_reserve(ts, tokens);
+
+	for (i = 0; i < jobs.count; i++)
+		jobs.chunk[i].ts = ts;
+
+	if (lex_run(&jobs, chunk_fill, threads) != COMPILE_OK)
+		lex_abort(&jobs, scratch);
+
+#ifdef PL_HAVE_PTHREAD
+	pthread_mutex_destroy(&jobs.lock);
+#endif
+
+	arena_reset(scratch);
+
+	end_token_stream(ts, line);
+	TRACE(sc_get_tracer(code), TRACE_LEXER, TRACE_INFO, EV_LEX_END,
+			ts_count(ts), line, 0);
 }
 
 /** @} */
-
@@ -23,6 +23,7 @@
  */
 
 #include"meta_data_types.h"
+#include<string.h>
 
 /**
  * @brief module error codes
@@ -69,7 +70,7 @@ struct META_LIST {
 static MLPTR init_meta_list() {
 	MLPTR new_list = NULL;
 
-	if ((new_list = malloc(sizeof(*new_list))) == NULL)
+	if ((new_list = pl_malloc(sizeof(*new_list))) == NULL)
 		ERROR_EXCEPT(mod[ML_ERR], ERR_MEMORY);
 
 	new_list->first = NULL;
@@ -102,7 +103,7 @@ static void mlal(MLPTR ml, void *content) {
 	if (ml == NULL)
 		ERROR_EXCEPT(mod[ML_ERR], NULL_POINTER);
 
-	if ((new_element = malloc(sizeof(*new_element))) == NULL)
+	if ((new_element = pl_malloc(sizeof(*new_element))) == NULL)
 		ERROR_EXCEPT(mod[ML_ERR], ERR_MEMORY);
 
 	new_element->content = content;
@@ -132,7 +133,7 @@ static void mlaf(MLPTR ml, void *content) {
 	if (ml == NULL)
 		ERROR_EXCEPT(mod[ML_ERR], NULL_POINTER);
 
-	if ((new_element = malloc(sizeof(*new_element))) == NULL)
+	if ((new_element = pl_malloc(sizeof(*new_element))) == NULL)
 		ERROR_EXCEPT(mod[ML_ERR], ERR_MEMORY);
 
 	new_element->content = content;
@@ -319,7 +320,7 @@ static void *mllookup(const MLPTR ml, void *compWith,
 STACK init_stack() {
 	STACK stack;
 
-	if ((stack = malloc(sizeof(*stack))) == NULL)
+	if ((stack = pl_malloc(sizeof(*stack))) == NULL)
 		ERROR_EXCEPT(mod[ST_ERR], ERR_MEMORY);
 
 	stack->stack_meta_list = init_meta_list();
@@ -436,7 +437,7 @@ int empty_stack(const STACK st) {
 QUEUE init_queue() {
 	QUEUE queue;
 
-	if ((queue = malloc(sizeof(*queue))) == NULL)
+	if ((queue = pl_malloc(sizeof(*queue))) == NULL)
 		ERROR_EXCEPT(mod[QU_ERR], ERR_MEMORY);
 
 	queue->queue_meta_list = init_meta_list();
@@ -530,127 +531,297 @@ int empty_queue(const QUEUE qu) {
 }
 
 
+/**
+ * @struct HASH_SLOT
+ *
+ * @brief slot of hash table, empty if key is NULL
+ */
+struct HASH_SLOT {
+	const void *key; /**< pointer to key, owned by caller */
+	void *element; /**< pointer to stored element */
+	unsigned long hash; /**< hash value of key */
+};
+
 /**
  * @struct hash_table
  *
- * @brief Simple implementation for a hashtable.
+ * @brief hash table with open addressing and linear probing
+ *
+ * The capacity is a power of two and doubles when more than three quarters
+ * of the slots are used. Deleting shifts the following elements of the probe
+ * sequence back, so there are no tombstones and lookups do not get slower
+ * after deleting.
  */
 struct hash_table {
-		const size_t HASH_SIZE;
-		size_t used;
-		void **table;
+	struct HASH_SLOT *slot; /**< array of slots */
+	size_t capacity; /**< number of slots, power of two */
+	unsigned bits; /**< log2 of capacity */
+	size_t used; /**< number of stored elements */
+	unsigned long (*hash_func)(const void *); /**< hash function for keys */
+	int (*equal)(const void *, const void *); /**< returns non zero for equal keys */
 };
 
 /**
- * @brief initialize new hash
+ * @brief first slot of probe sequence for hash value
  *
- * Size of hash should be a prime number, but not a Mersenne-Prime (2^n - 1). Best choice
- * for hash table size would be prime twins like 11 & 13; 17 & 19; 41 & 43 and so on.
+ * Fibonacci hashing: multiplying by 2^32 / golden ratio moves the information
+ * of all bits into the upper bits, of which the slot number is taken. So weak
+ * hash functions still spread over all slots.
  *
- * @param data_type define data which should be stored
- * @param size how much entries should be stored into hash table
- * @param cast function pointer to cast table type
- * @retval new_hash pointer to new hash
+ * @param hash hash table
+ * @param h hash value of key
+ * @retval size_t slot number
  */
-HASHTABLE init_hash(void *data_type, size_t size, void *(*cast)(void *)) {
-	HASHTABLE new_hash = NULL;
+static size_t hash_first(const HASHTABLE hash, const unsigned long h) {
+	unsigned long mixed = ((h ^ (h >> 16)) * 2654435769UL) & 0xffffffffUL;
+	return (size_t) (mixed >> (32 - hash->bits));
+}
+
+/**
+ * @brief allocate empty slot array
+ *
+ * @param hash hash table
+ * @param bits log2 of new capacity
+ * @retval void
+ */
+static void hash_alloc(HASHTABLE hash, const unsigned bits) {
 	size_t i;
 
-	if ((new_hash = malloc(sizeof(*new_hash))) == NULL)
+	hash->bits = bits;
+	hash->capacity = (size_t) 1 << bits;
+
+	if ((hash->slot = pl_malloc(hash->capacity * sizeof(*hash->slot))) == NULL)
 		ERROR_EXCEPT(mod[HA_ERR], ERR_MEMORY);
 
-	if ((data_type = malloc(sizeof((cast)(data_type)) * *size)) == NULL)
-		ERROR_EXCEPT("hash_elements", ERR_MEMORY);
+	for (i = 0; i < hash->capacity; i++)
+		hash->slot[i].key = NULL;
+}
 
-	*(size_t *)&new_hash->HASH_SIZE = size;
-	new_hash->used = 0;
-	new_hash->table = &data_type;
+/**
+ * @brief double capacity and insert all elements again
+ *
+ * @param hash hash table
+ * @retval void
+ */
+static void hash_grow(HASHTABLE hash) {
+	struct HASH_SLOT *old = hash->slot;
+	size_t i, k, capacity = hash->capacity;
 
-	for (i = 0; i < new_hash->HASH_SIZE; ++i)
-		new_hash->table[i] = NULL;
+	hash_alloc(hash, hash->bits + 1);
 
-	return new_hash;
+	for (i = 0; i < capacity; i++)
+		if (old[i].key != NULL) {
+			for (k = hash_first(hash, old[i].hash); hash->slot[k].key != NULL;
+					k = (k + 1) & (hash->capacity - 1))
+				;
+
+			hash->slot[k] = old[i];
+		}
+
+	free(old);
 }
 
 /**
- * @brief check for size of hash.
- *
- * Size left of zero means hash is full
+ * @brief find slot of key
  *
  * @param hash hash table
- * @retval size size of hash table
+ * @param key key looking for
+ * @param h hash value of key
+ * @retval size_t slot of key or first empty slot of probe sequence
  */
-int full_hash(HASHTABLE hash) {
-	return (hash->used == hash->HASH_SIZE);
+static size_t hash_find(const HASHTABLE hash, const void *key,
+		const unsigned long h) {
+	size_t k = hash_first(hash, h);
+
+	while (hash->slot[k].key != NULL
+			&& (hash->slot[k].hash != h || !(*hash->equal)(hash->slot[k].key, key)))
+		k = (k + 1) & (hash->capacity - 1);
+
+	return k;
 }
 
 /**
- * @brief generate hash key.
- *
- * Hash key generating by double hashing.
- *
- * Hash functions used:\n
- * \f$ h(k)  := (h(k) * 128 + k)\;mod\;HASH_SIZE \f$\n
- * \f$ h'(k) := (h'(k) * 128 + k)\;mod\;HASH_SIZE - 2 \f$
+ * @brief initialize new hash
  *
- * With probing function: \n
- * \f$ h(k, i) := (h(k) + i * h'(k))\;mod\;HASH_SIZE \f$
+ * Keys are not copied and have to stay valid while they are stored. NULL is no valid key.
  *
- * @param hash hash table
- * @param s name for which hash key should be generated
- * @retval hashkey positive hash key
+ * @param size expected number of elements, table grows if more are inserted
+ * @param hash_func hash function for keys, e.g. hash_string
+ * @param equal compare function for keys, returns non zero if equal, e.g. equal_string
+ * @retval new_hash pointer to new hash
  */
-static unsigned genHashKey(HASHTABLE hash, char *s) {
-	size_t hashval1, hashval2, hashkey, i;
+HASHTABLE init_hash(size_t size, unsigned long (*hash_func)(const void *),
+		int (*equal)(const void *, const void *)) {
+	HASHTABLE new_hash = NULL;
+	unsigned bits = 3;
 
-	for (hashval1 = hashval2 = 0; *s != '\0'; s++) {
-		hashval1 = ((hashval1 << 7) + *s) % hash->HASH_SIZE;
-		hashval2 = ((hashval2 << 7) + *s) % (hash->HASH_SIZE - 2);
-	}
+	if (hash_func == NULL || equal == NULL)
+		ERROR_EXCEPT(mod[HA_ERR], NULL_POINTER);
 
-	hashkey = hashval1;
-	
-	for (i = 0; (hash->table[hashkey] == NULL || strcmp(hash->table[hashkey], s)) && i < hash->HASH_SIZE; i++)
-		hashkey = (hashval1 + i * hashval2) % hash->HASH_SIZE;
+	if ((new_hash = pl_malloc(sizeof(*new_hash))) == NULL)
+		ERROR_EXCEPT(mod[HA_ERR], ERR_MEMORY);
+
+	/* room for size elements below the maximum load */
+	while (bits < 31 && ((size_t) 1 << bits) * 3 / 4 < size)
+		bits++;
+
+	hash_alloc(new_hash, bits);
+	new_hash->used = 0;
+	new_hash->hash_func = hash_func;
+	new_hash->equal = equal;
 
-	hash->used++;
-	return hashkey;
+	return new_hash;
 }
 
 /**
- * @brief add item to hash table.
+ * @brief free hash table, keys and elements are not freed
  *
  * @param hash hash table
- * @param s index of item
- * @param element item to store
  * @retval void
  */
-void insertHash(HASHTABLE hash, char *s, void *element) {
+void free_hash(HASHTABLE hash) {
+	if (hash == NULL)
+		return;
 
-	size_t key = genHashKey(hash, s);
+	free(hash->slot);
+	free(hash);
+}
 
-	if (hash == NULL)
+/**
+ * @brief add item to hash table, replace item stored under equal key
+ *
+ * @param hash hash table
+ * @param key index of item
+ * @param element item to store
+ * @retval void
+ */
+void insertHash(HASHTABLE hash, const void *key, void *element) {
+	unsigned long h;
+	size_t k;
+
+	if (hash == NULL || key == NULL)
 		ERROR_EXCEPT(mod[HA_ERR], NULL_POINTER);
 
-	if (!full_hash(hash))
-		hash->table[key] = element;
-	else
-		ERROR_EXCEPT(mod[HA_ERR], HASH_FULL);
+	h = (*hash->hash_func)(key);
+	k = hash_find(hash, key, h);
+
+	if (hash->slot[k].key == NULL) {
+		if ((hash->used + 1) * 4 > hash->capacity * 3) {
+			if (hash->bits >= 31)
+				ERROR_EXCEPT(mod[HA_ERR], HASH_FULL);
+
+			hash_grow(hash);
+			k = hash_find(hash, key, h);
+		}
+
+		hash->used++;
+	}
+
+	hash->slot[k].key = key;
+	hash->slot[k].element = element;
+	hash->slot[k].hash = h;
 }
 
 /**
  * @brief get element for given index
  *
  * @param hash hash table
- * @param s element index
- * @retval *element pointer to element
+ * @param key element index
+ * @retval *element pointer to element or NULL if not found
+ */
+void *getHash(const HASHTABLE hash, const void *key) {
+	size_t k;
+
+	if (hash == NULL || key == NULL)
+		ERROR_EXCEPT(mod[HA_ERR], NULL_POINTER);
+
+	k = hash_find(hash, key, (*hash->hash_func)(key));
+	return (hash->slot[k].key == NULL) ? NULL : hash->slot[k].element;
+}
+
+/**
+ * @brief remove element for given index
+ *
+ * Moves following elements of the probe sequence into the gap (backward shift),
+ * so no slot has to be marked as deleted.
+ *
+ * @param hash hash table
+ * @param key element index
+ * @retval *element removed element or NULL if not found
  */
-void *getHash(HASHTABLE hash, char *s) {
+void *deleteHash(HASHTABLE hash, const void *key) {
+	size_t gap, k, home, mask;
 	void *element;
-	size_t key = genHashKey(hash, s);
 
-	if (hash == NULL)
+	if (hash == NULL || key == NULL)
 		ERROR_EXCEPT(mod[HA_ERR], NULL_POINTER);
 
-	return ((element = hash->table[key]) == NULL) ? NULL : element;
+	mask = hash->capacity - 1;
+	gap = hash_find(hash, key, (*hash->hash_func)(key));
+
+	if (hash->slot[gap].key == NULL)
+		return NULL;
+
+	element = hash->slot[gap].element;
+
+	for (k = (gap + 1) & mask; hash->slot[k].key != NULL; k = (k + 1) & mask) {
+		home = hash_first(hash, hash->slot[k].hash);
+
+		/* element may move to gap if its home slot is not between gap and k */
+		if (((k - home) & mask) >= ((k - gap) & mask)) {
+			hash->slot[gap] = hash->slot[k];
+			gap = k;
+		}
+	}
+
+	hash->slot[gap].key = NULL;
+	hash->used--;
+	return element;
+}
+
+/**
+ * @brief number of stored elements
+ *
+ * @param hash hash table
+ * @retval size_t
+ */
+size_t size_hash(const HASHTABLE hash) {
+	return hash->used;
+}
+
+/**
+ * @brief check for empty hash table
+ *
+ * @param hash hash table
+ * @retval int 1 if empty, 0 otherwise
+ */
+int empty_hash(const HASHTABLE hash) {
+	return hash->used == 0;
+}
+
+/**
+ * @brief hash function for zero terminated strings (FNV-1a)
+ *
+ * @param key string
+ * @retval unsigned long hash value
+ */
+unsigned long hash_string(const void *key) {
+	const unsigned char *s = key;
+	unsigned long h = 2166136261UL;
+
+	while (*s != '\0')
+		h = ((h ^ *s++) * 16777619UL) & 0xffffffffUL;
+
+	return h;
+}
+
+/**
+ * @brief compare function for zero terminated strings
+ *
+ * @param key1 string
+ * @param key2 string
+ * @retval int non zero if equal
+ */
+int equal_string(const void *key1, const void *key2) {
+	return strcmp(key1, key2) == 0;
 }
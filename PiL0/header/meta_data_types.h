@@ -84,3 +84,25 @@ extern int empty_queue(const QUEUE);
 
 /* hash table */
 typedef struct hash_table *HASHTABLE;
+
+extern HASHTABLE init_hash(size_t, unsigned long (*hash_func)(const void *),
+		int (*equal)(const void *, const void *));
+extern void free_hash(HASHTABLE);
+extern void insertHash(HASHTABLE, const void *, void *);
+extern void *getHash(const HASHTABLE, const void *);
+extern void *deleteHash(HASHTABLE, const void *);
+extern size_t size_hash(const HASHTABLE);
+extern int empty_hash(const HASHTABLE);
+extern unsigned long hash_string(const void *);
+extern int equal_string(const void *, const void *);
+
+/* arena */
+typedef struct ARENA *ARPTR;
+
+extern ARPTR init_arena(size_t);
+extern void *arena_alloc(ARPTR, size_t);
+extern void arena_reset(ARPTR);
+extern void free_arena(ARPTR);
+extern size_t arena_used(const ARPTR);
+extern size_t arena_reserved(const ARPTR);
+extern size_t arena_chunks(const ARPTR);
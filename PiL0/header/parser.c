@@ -19,539 +19,706 @@
 /**
  * @file parser.c Library which inherits all necessary functions for parsing
  *
+ * The parser is table driven: productions are expanded onto an explicit item
+ * stack on the heap instead of the C call stack, so the nesting depth of a
+ * program is only limited by memory.
+ *
  * @defgroup parser Parser
  * @brief check token stream (LIFO) from parser for predefined grammar
  * @ingroup global parser
  */
 
 #include"frontend.h"
+#include"containers.h"
 #define TRUE  1
 #define FALSE   0
 
-#ifndef PL_DEBUG
-#define MTNT(q)     release_token(q)
-#define PARSE_ERR(line, mess)   parseError(line, mess)
-#else
+/* move to next token, consumed tokens are traced on level verbose */
+#define MTNT(p) \
+	((TRACING((p)->trace, TRACE_PARSER, TRACE_VERBOSE) ? trace_token(p) : \
+			(void) 0), next_token((p)->token_stream))
+
+/* report syntax error, parser line is traced for finding the rule */
+#define PARSE_ERR(line, mess) \
+	(TRACE(p->trace, TRACE_PARSER, TRACE_INFO, EV_PARSE_ERROR, mess, line, \
+			__LINE__), parseError(line, mess))
 
 /**
- * @brief debug-only: print to standard output token content read from source code
- *
+ * @enum parse_items symbols of the parse stack
  *
- * @param tok token queue <- token stream generated from lexer
- * @retval void
- **/
-static void parse_debout(QUEUE tok) {
-	char c;
-	fputs("Token: ", stdout);
-	switch (getType(tok)) {
-		case 'n':
-			printf("%d\n", getNumber(tok));
-			break;
+ * Nonterminals (N_) choose a production by looking at the current token,
+ * terminals (T_) have to match the current token and actions (A_) build the
+ * AST from the value stack. The grammar is written above every production.
+ */
+enum parse_items {
+	END_OF_PRODUCTION,
+	N_BLOCK, N_VAR, N_VAR_ITEM, N_VAR_MORE, N_CONST, N_CONST_ITEM, N_CONST_MORE,
+	N_PROC, N_STMT, N_LIST_ITEM, N_LIST_MORE, N_CONDITION, N_RELATION,
+	N_EXPRESSION, N_EXPR_REST, N_TERM, N_TERM_REST, N_FACTOR, N_CONST_VALUE,
+	T_PROC_SEMICOLON, T_CONST_EQ, T_ASSIGN, T_END, T_THEN, T_DO,
+	T_CLOSE,
+	A_ENTER, A_CLEAN, A_BLOCK_STMT, A_ASSIGN, A_PRINT, A_IF, A_WHILE, A_ODD,
+	A_REL, A_NEG, A_ARITH
+};
 
-		case 'w':
-			puts(getWord(tok));
-			break;
+/**
+ * @enum productions indices of production[]
+ */
+enum productions {
+	P_BLOCK, P_CONST_ITEM, P_PROC, P_ASSIGN, P_PRINT, P_LIST_ITEM, P_IF,
+	P_WHILE, P_ODD, P_CONDITION, P_RELATION, P_NEG_EXPRESSION, P_EXPRESSION,
+	P_EXPR_REST, P_TERM, P_TERM_REST, P_PARENTHESES
+};
 
-		case 't':
-			c = getToken(tok);
-			putchar(c);
-			putchar('\n');
-			break;
+/**
+ * @var production[]
+ * @brief right hand sides of all productions, pushed in reverse order
+ */
+static const unsigned char production[][8] = {
+	/* block -> VAR var_stmt CONST const_stmt proc stmt */
+	{ A_ENTER, N_VAR, N_CONST, N_PROC, A_BLOCK_STMT, N_STMT, A_CLEAN },
+	/* const_stmt -> const_stmt, identifier = number | identifier = number */
+	{ T_CONST_EQ, N_CONST_VALUE, N_CONST_MORE },
+	/* proc_stmt -> PROCEDURE identifier ; block ; */
+	{ N_BLOCK, T_PROC_SEMICOLON, N_PROC },
+	/* stmt -> identifier = expression */
+	{ T_ASSIGN, N_EXPRESSION, A_ASSIGN },
+	/* stmt -> PRINT expression */
+	{ N_EXPRESSION, A_PRINT },
+	/* stmts -> stmts ; stmt | stmt */
+	{ N_STMT, N_LIST_MORE },
+	/* stmt -> IF condition THEN stmt */
+	{ N_CONDITION, A_IF, T_THEN, N_STMT },
+	/* stmt -> WHILE condition DO stmt */
+	{ N_CONDITION, A_WHILE, T_DO, N_STMT },
+	/* condition -> ODD expression */
+	{ N_EXPRESSION, A_ODD },
+	/* condition -> expression compare expression */
+	{ N_EXPRESSION, N_RELATION },
+	{ N_EXPRESSION, A_REL },
+	/* expression -> - term expr_rest */
+	{ N_TERM, A_NEG, N_EXPR_REST },
+	/* expression -> term expr_rest */
+	{ N_TERM, N_EXPR_REST },
+	/* expr_rest -> + term expr_rest | - term expr_rest | */
+	{ N_TERM, A_ARITH, N_EXPR_REST },
+	/* term -> factor term_rest */
+	{ N_FACTOR, N_TERM_REST },
+	/* term_rest -> * factor term_rest | / factor term_rest | */
+	{ N_FACTOR, A_ARITH, N_TERM_REST },
+	/* factor -> ( expression ) */
+	{ N_EXPRESSION, T_CLOSE }
+};
 
-		default:
-			puts("help!");
-			break;
-	}
-}
+/**
+ * @var terminal[]
+ * @brief token and error message of every terminal T_ item
+ *
+ * Tokens below 256 are characters, others word IDs.
+ */
+static const struct {
+	int token; 					/**< expected token */
+	enum parse_err_codes error; /**< message if token is missing */
+} terminal[] = {
+	{ ';', SYN_MISS_COM },		/* T_PROC_SEMICOLON */
+	{ '=', SYN_MISS_ASS },		/* T_CONST_EQ */
+	{ '=', SYN_MISS_ASS },		/* T_ASSIGN */
+	{ END, SYN_MISS_END },		/* T_END */
+	{ THEN, SYN_IF },			/* T_THEN */
+	{ DO, SYN_WHILE },			/* T_DO */
+	{ ')', SYN_MISS_CB }		/* T_CLOSE */
+};
+
+DEFINE_STACK(item_stack, unsigned char)
+DEFINE_STACK(value_stack, unsigned int)
 
-#define MTNT(q)    parse_debout(q), release_token(q)
-#define PARSE_ERR(line, mess) debug_output(line, mess, __func__, __LINE__)
-#endif
+/**
+ * @struct PARSER
+ *
+ * @brief state of the parser, both stacks grow on the heap
+ *
+ * The value stack holds the block or statement knot a nonterminal fills,
+ * finished expressions, symbols and operators waiting for their action.
+ **/
+struct PARSER {
+	TSPTR token_stream; 		/**< token stream */
+	STPTR symbol_table; 		/**< symbol table */
+	ASTPTR ast; 				/**< AST */
+	struct item_stack item; 	/**< parse stack */
+	struct value_stack value; 	/**< value stack */
+	const TRACER *trace; 		/**< tracer for tokens, productions and errors */
+	SYMBOL constant; 			/**< constant declared last, waiting for its value */
+};
 
 /* prototypes */
-int init_parsing(SOURCECODE);
-void block(SOURCECODE);
-void stmt(SOURCECODE);
-void condition(SOURCECODE);
-void expression(SOURCECODE);
-void term(SOURCECODE);
-void factor(SOURCECODE);
-
-/*static rootBlock block_ptr = NULL;
- static rootStmt stmt_ptr = NULL;
- static rootExpr expr_ptr = NULL;*/
+void init_parsing(SOURCECODE);
+static void parse(struct PARSER *);
 
 /**
- * @brief start with parsing process
+ * @brief record current token as trace event
  *
- * @param code pointer to source code object
- * @retval TRUE/FALSE 1 or 0
+ * Identifiers are recorded with type 'i' and their symbol, other words with
+ * their word ID, numbers with their value and characters with themselves.
+ *
+ * @param *p parser
+ * @retval void
  **/
-int init_parsing(SOURCECODE code) {
+static void trace_token(const struct PARSER *p) {
+	TSPTR ts = p->token_stream;
+	char type = getType(ts);
+	unsigned int value;
+
+	if (type == 'n')
+		value = (unsigned int) getNumber(ts);
+	else if (type == 'w' && getWordID(ts) == IDENTIFIER) {
+		type = 'i';
+		value = getSymbol(ts);
+	} else if (type == 'w')
+		value = (unsigned int) getWordID(ts);
+	else
+		value = (unsigned char) getToken(ts);
 
-	int exit_status;
-	QUEUE token_stream = sc_get_ts(code);
-	STACK symbol_table = NULL;
-
-	sc_set_st(code, init_stack());
-	symbol_table = sc_get_st(code);
-	sc_set_ast_bl(code, init_block());
-	block(code);
-	exit_status = (getToken(token_stream) == '.') ? TRUE : FALSE;
-	MTNT(token_stream);
-
-	if (empty_stack(symbol_table))
-		free_stack(symbol_table);
-	if (empty_queue(token_stream))
-		free_queue(token_stream);
-
-	puts("\nFinished parsing with status: ");
-	return exit_status;
+	trace_emit(p->trace, TRACE_PARSER, EV_PARSE_TOKEN, (unsigned char) type,
+			value, (unsigned int) getLine(ts));
 }
 
 /**
- * @brief check block grammar
+ * @brief start with parsing process
+ *
+ * Syntax errors, a missing '.' at the end and tokens after it included, are
+ * reported to the diagnostic sink and unwind.
  *
- * @param *code pointer to source code object
+ * @param code pointer to source code object
  * @retval void
  **/
-void block(SOURCECODE code) {
-
-	STACK symbol_table = sc_get_st(code);
-	QUEUE token_stream = sc_get_ts(code);
-	AST_BLOCK_PTR block_ptr = sc_get_ast_bl(code);
-	AST_BLOCK_PTR block_tmp = NULL;
-
-	push(symbol_table, generate_tableEntry("new scope", -1));
+void init_parsing(SOURCECODE code) {
 
-	/* block    -> VAR var_stmt
-	 * var_stmt -> var_stmt, identifier | identifier */
-	if (getWordID(token_stream) == VAR) {
-		MTNT(token_stream);
+	int exit_status;
+	struct PARSER parser;
+	DIAG_FRAME frame;
+	TSPTR token_stream = sc_get_ts(code);
+
+	sc_set_st(code, init_symbol_table());
+
+	parser.token_stream = token_stream;
+	parser.symbol_table = sc_get_st(code);
+	parser.ast = sc_get_ast(code);
+	parser.trace = sc_get_tracer(code);
+	parser.constant = NO_SYMBOL;
+	st_set_tracer(parser.symbol_table, parser.trace);
+	item_stack_init(&parser.item);
+	value_stack_init(&parser.value);
+
+	/* the stacks are released before an error unwinds further */
+	diag_push(&frame, NULL, NULL);
+
+	if ((exit_status = setjmp(frame.unwind)) == 0) {
+		/* program -> block . */
+		value_stack_push(&parser.value, init_block(parser.ast));
+		item_stack_push(&parser.item, N_BLOCK);
+		parse(&parser);
+	}
 
-		do {
-			if (getWordID(token_stream) == IDENTIFIER) {
-				if (!stlookup(symbol_table, getWord(token_stream)))
-					push(symbol_table,
-							generate_tableEntry(getWord(token_stream), VAR));
-				else
-					PARSE_ERR(getLine(token_stream), TYP_DOUB_DEC);
+	diag_pop(&frame);
+	item_stack_free(&parser.item);
+	value_stack_free(&parser.value);
 
-				MTNT(token_stream);
-			}
+	if (exit_status != COMPILE_OK)
+		diag_raise(NULL, exit_status);
 
-			else
-				PARSE_ERR(getLine(token_stream), TYP_NO_ID);
+	/* program -> block . and nothing after it */
+	if (getToken(token_stream) != '.')
+		parseError(getLine(token_stream), SYN_END);
 
-			if (getToken(token_stream) == ',')
-				MTNT(token_stream);
-			else if (getToken(token_stream) != ';')
-				PARSE_ERR(getLine(token_stream), SYN_MISS_COM);
-		} while (getToken(token_stream) != ';');
+	MTNT(&parser);
 
-		MTNT(token_stream);
-	}
+	if (getType(token_stream) != '\0')
+		parseError(getLine(token_stream), SYN_END);
 
-	/* block      -> CONST const_stmt
-	 * const_stmt -> const_stmt, identifier = number | identifier = number */
-	if (getWordID(token_stream) == CONST) {
-		MTNT(token_stream);
+	free_symbol_table(sc_get_st(code));
+	sc_set_st(code, NULL);
+}
 
-		do {
-			if (getWordID(token_stream) == IDENTIFIER) {
-				if (!stlookup(symbol_table, getWord(token_stream)))
-					push(symbol_table,
-							generate_tableEntry(getWord(token_stream), CONST));
-				else
-					PARSE_ERR(getLine(token_stream), TYP_DOUB_DEC);
+/**
+ * @brief push right hand side of production onto parse stack
+ *
+ * @param *p parser
+ * @param prod production
+ * @retval void
+ **/
+static void expand(struct PARSER *p, const enum productions prod) {
+	const unsigned char *rhs = production[prod];
+	size_t n = 0;
 
-				MTNT(token_stream);
-			}
+	while (n < sizeof(production[0]) && rhs[n] != END_OF_PRODUCTION)
+		n++;
 
-			else
-				PARSE_ERR(getLine(token_stream), TYP_NO_ID);
+	TRACE(p->trace, TRACE_PARSER, TRACE_VERBOSE, EV_PARSE_EXPAND, prod,
+			item_stack_size(&p->item), getLine(p->token_stream));
 
-			if (getToken(token_stream) == '=')
-				MTNT(token_stream);
-			else
-				PARSE_ERR(getLine(token_stream), SYN_MISS_ASS);
+	while (n-- > 0)
+		item_stack_push(&p->item, rhs[n]);
+}
 
-			if (getNumberID(token_stream) == NUM)
-				MTNT(token_stream);
-			else
-				PARSE_ERR(getLine(token_stream), TYP_CONST_NUM);
+/**
+ * @brief check that current token is declared and usable
+ *
+ * @param *p parser
+ * @param procedure nonzero if identifier has to be a procedure
+ * @param err message if the kind of identifier does not match
+ * @retval void
+ **/
+static void check_identifier(struct PARSER *p, const int procedure,
+		const enum parse_err_codes err) {
+	TSPTR token_stream = p->token_stream;
+	TEPTR table_entry = stlookup(p->symbol_table, getSymbol(token_stream));
+
+	if (table_entry == NULL)
+		PARSE_ERR(getLine(token_stream), TYP_ID_NO_IN);
+	else if ((st_get_typeID(table_entry) == PROCEDURE) != procedure)
+		PARSE_ERR(getLine(token_stream), err);
+}
 
-			if (getToken(token_stream) == ',')
-				MTNT(token_stream);
-			else if (getToken(token_stream) != ';')
-				PARSE_ERR(getLine(token_stream), SYN_MISS_COM);
-		} while (getToken(token_stream) != ';');
+/**
+ * @brief declare identifier of current token in current scope
+ *
+ * VAR and CONST are declared in the scope of the AST as well.
+ *
+ * @param *p parser
+ * @param type_ID VAR, CONST or PROCEDURE
+ * @retval void
+ **/
+static void declare(struct PARSER *p, const int type_ID) {
+	TSPTR token_stream = p->token_stream;
 
-		MTNT(token_stream);
-	}
+	if (getWordID(token_stream) == IDENTIFIER) {
+		if (!stdeclare(p->symbol_table, getSymbol(token_stream), type_ID))
+			PARSE_ERR(getLine(token_stream), TYP_DOUB_DEC);
 
-	/* block     -> proc
-	 * proc      -> proc proc_stmt | proc_stmt
-	 * proc_stmt -> PROCEDURE identifier ; block ; */
+		if (type_ID != PROCEDURE)
+			scope_declare(p->ast, getSymbol(token_stream), type_ID);
 
-	while (getWordID(token_stream) == PROCEDURE) {
-		MTNT(token_stream);
+		if (type_ID == CONST)
+			p->constant = getSymbol(token_stream);
 
-		if (getWordID(token_stream) == IDENTIFIER) {
-			if (!stlookup(symbol_table, getWord(token_stream)))
-				push(symbol_table,
-						generate_tableEntry(getWord(token_stream), PROCEDURE));
-			else
-				PARSE_ERR(getLine(token_stream), TYP_DOUB_DEC);
+		MTNT(p);
+	}
 
-			MTNT(token_stream);
-		} else
-			PARSE_ERR(getLine(token_stream), TYP_NO_ID);
+	else
+		PARSE_ERR(getLine(token_stream), TYP_NO_ID);
+}
 
-		if (getToken(token_stream) == ';')
-			MTNT(token_stream);
-		else
-			PARSE_ERR(getLine(token_stream), SYN_MISS_COM);
+/**
+ * @brief continue or finish list of declarations
+ *
+ * @param *p parser
+ * @param item item which parses the next declaration
+ * @retval void
+ **/
+static void declare_more(struct PARSER *p, const unsigned char item) {
+	TSPTR token_stream = p->token_stream;
 
-		block_init_procedure(block_ptr, top(symbol_table));
-		sc_set_ast_bl(code, block_get_function(block_ptr));
-		block_tmp = block_get_main(block_ptr);
-		block(code);
-		block_ptr = block_tmp;
+	if (getToken(token_stream) == ',') {
+		MTNT(p);
 
-		if (getToken(token_stream) == ';')
-			MTNT(token_stream);
-		else
-			PARSE_ERR(getLine(token_stream), SYN_MISS_COM);
+		if (getToken(token_stream) != ';') {
+			item_stack_push(&p->item, item);
+			return;
+		}
 	}
 
-	sc_set_ast_st(code, block_init_statement(block_ptr));
-	stmt(code);
-	stclean(symbol_table);
+	else if (getToken(token_stream) != ';')
+		PARSE_ERR(getLine(token_stream), SYN_MISS_COM);
+
+	MTNT(p);
 }
 
 /**
- * @brief check statement syntax
+ * @brief choose production of statement and fill statement knot
  *
- * @param *code pointer to source code object
+ * @param *p parser
+ * @param st statement knot to fill
  * @retval void
  **/
-void stmt(SOURCECODE code) {
+static void statement(struct PARSER *p, const AST_STMT_REF st) {
+	TSPTR token_stream = p->token_stream;
+	ASTPTR ast = p->ast;
 
-	STACK symbol_table = sc_get_st(code);
-	QUEUE token_stream = sc_get_ts(code);
-	AST_STMT_PTR statement_ptr = sc_get_ast_st(code);
-	AST_STMT_PTR statement_tmp = NULL;
-	TEPTR table_entry = NULL;
+	stmt_set_line(ast, st, getLine(token_stream));
 
 	switch (getWordID(token_stream)) {
 		/* stmt -> identifier = expression */
 		case (IDENTIFIER):
 
-			table_entry = stlookup(symbol_table, getWord(token_stream));
-
-			if (table_entry == NULL)
-				PARSE_ERR(getLine(token_stream), TYP_ID_NO_IN);
-			else if (st_get_typeID(table_entry) == PROCEDURE)
-				PARSE_ERR(getLine(token_stream), TYP_ONLY_INT);
-
-			MTNT(token_stream);
-
-			if (getToken(token_stream) == '=')
-				MTNT(token_stream);
-			else
-				PARSE_ERR(getLine(token_stream), SYN_MISS_ASS);
-
-			sc_set_ast_ex(code, stmt_init_assignment(statement_ptr, getWord(token_stream)));
-			expression(code);
+			check_identifier(p, FALSE, TYP_ONLY_INT);
+			value_stack_push(&p->value, st);
+			value_stack_push(&p->value, getSymbol(token_stream));
+			MTNT(p);
+			expand(p, P_ASSIGN);
 			break;
 
 		/* stmt -> CALL identifier (only procedure)*/
 		case (CALL):
 
-			MTNT(token_stream);
-			table_entry = stlookup(symbol_table, getWord(token_stream));
-
-			if (table_entry == NULL)
-				PARSE_ERR(getLine(token_stream), TYP_ID_NO_IN);
-			else if (st_get_typeID(table_entry) != PROCEDURE)
-				PARSE_ERR(getLine(token_stream), TYP_ONLY_PROC);
-
-			stmt_init_care(statement_ptr, getWord(token_stream));
-			MTNT(token_stream);
+			MTNT(p);
+			check_identifier(p, TRUE, TYP_ONLY_PROC);
+			stmt_init_care(ast, st, getSymbol(token_stream), CALL);
+			MTNT(p);
 			break;
 
 			/* stmt -> READ identifier (only procedure)*/
 		case (READ):
 
-			MTNT(token_stream);
-			table_entry = stlookup(symbol_table, getWord(token_stream));
-
-			if (table_entry == NULL)
-				PARSE_ERR(getLine(token_stream), TYP_ID_NO_IN);
-			else if (st_get_typeID(table_entry) == PROCEDURE)
-				PARSE_ERR(getLine(token_stream), TYP_ONLY_INT);
-
-			stmt_init_care(statement_ptr, getWord(token_stream));
-			MTNT(token_stream);
+			MTNT(p);
+			check_identifier(p, FALSE, TYP_ONLY_INT);
+			stmt_init_care(ast, st, getSymbol(token_stream), READ);
+			MTNT(p);
 			break;
 
 			/* stmt -> PRINT expression */
 		case (PRINT):
 
-			MTNT(token_stream);
-			sc_set_ast_ex(code, stmt_init_print(statement_ptr));
-			expression(code);
-
+			MTNT(p);
+			value_stack_push(&p->value, st);
+			expand(p, P_PRINT);
 			break;
 
-			/* stmt  -> BEGIN stmts END
-			 * stmts -> stmts ; stmt | stmt */
+			/* stmt -> BEGIN stmts END */
 		case (BEGIN):
 
-			do {
-				MTNT(token_stream);
-				stmt_init_sequence(statement_ptr);
-			    sc_set_ast_st(code, stmt_get_sequence_left(statement_ptr));
-			    statement_tmp = stmt_get_sequence_right(statement_ptr);
-				stmt(code);
-				statement_ptr = statement_tmp;
-			} while (getToken(token_stream) == ';');
-
-			if (getWordID(token_stream) == END)
-				MTNT(token_stream);
-			else
-				PARSE_ERR(getLine(token_stream), SYN_MISS_END);
-
+			stmt_init_list(ast, st);
+			value_stack_push(&p->value, st);
+			item_stack_push(&p->item, N_LIST_ITEM);
 			break;
 
 			/* stmt -> IF condition THEN stmt */
 		case (IF):
 
-			MTNT(token_stream);
-			stmt_init_jumpfor(statement_ptr);
-			sc_set_ast_ex(code, stmt_get_jumpfor_condition(statement_ptr));
-			condition(code);
-
-			if (getWordID(token_stream) == THEN)
-				MTNT(token_stream);
-			else
-				PARSE_ERR(getLine(token_stream), SYN_IF);
-
-			statement_ptr = stmt_get_jumpfor_statement(statement_ptr);
-			stmt(code);
+			MTNT(p);
+			value_stack_push(&p->value, st);
+			expand(p, P_IF);
 			break;
 
 			/* stmt -> WHILE condition DO stmt */
 		case (WHILE):
 
-			MTNT(token_stream);
-			stmt_init_jumpbac(statement_ptr);
-			sc_set_ast_ex(code, stmt_get_jumpbac_condition(statement_ptr));
-			condition(code);
-
-			if (getWordID(token_stream) == DO)
-				MTNT(token_stream);
-			else
-				PARSE_ERR(getLine(token_stream), SYN_WHILE);
-
-			statement_ptr = stmt_get_jumpbac_statement(statement_ptr);
-			stmt(code);
+			MTNT(p);
+			value_stack_push(&p->value, st);
+			expand(p, P_WHILE);
 			break;
 
 			/* stmt -> PASS */
 		case (PASS):
 
-			MTNT(token_stream);
+			MTNT(p);
 			break;
 	}
-
-	sc_set_ast_st(code, statement_ptr);
 }
 
 /**
- * @brief check condition syntax
+ * @brief choose production of nonterminal at current token
  *
- * @param *code pointer to source code object
+ * @param *p parser
+ * @param item nonterminal
  * @retval void
  **/
-void condition(SOURCECODE code) {
+static void predict(struct PARSER *p, const unsigned char item) {
+	TSPTR token_stream = p->token_stream;
+	ASTPTR ast = p->ast;
+	AST_BLOCK_REF block_ptr;
+	SYMBOL procedure_name;
+	int op;
+
+	switch (item) {
+		case (N_BLOCK):
+			expand(p, P_BLOCK);
+			break;
 
-	QUEUE token_stream = sc_get_ts(code);
-	AST_EXPR_PTR expression_ptr = sc_get_ast_ex(code);
-	AST_EXPR_PTR expression_tmp = NULL, expression_tmp_op = expression_ptr;
-	char buf[2];
+			/* block    -> VAR var_stmt
+			 * var_stmt -> var_stmt, identifier | identifier */
+		case (N_VAR):
+			if (getWordID(token_stream) == VAR) {
+				MTNT(p);
+				item_stack_push(&p->item, N_VAR_ITEM);
+			}
+			break;
 
-	/* condition -> ODD expression */
-	if (getWordID(token_stream) == ODD) {
-		MTNT(token_stream);
-		sc_set_ast_ex(code, expr_init_odd(expression_ptr));
-		expression(code);
-	}
+		case (N_VAR_ITEM):
+			declare(p, VAR);
+			item_stack_push(&p->item, N_VAR_MORE);
+			break;
 
-	else {
-		/* condition -> expression > expression | expression < expression */
-
-		expr_init_relation(expression_ptr);
-		sc_set_ast_ex(code, expr_get_relation_left(expression_ptr));
-		expression_tmp = expr_get_relation_right(expression_ptr);
-		expression(code);
-		sc_set_ast_ex(code, expression_tmp);
-
-		if (getToken(token_stream) == '>'
-				|| getToken(token_stream) == '<') {
-			buf[0] = getToken(token_stream), buf[1] = '\0';
-			expr_relation_set_op(expression_tmp_op, buf);
-			MTNT(token_stream);
-			expression(code);
-		}
+		case (N_VAR_MORE):
+			declare_more(p, N_VAR_ITEM);
+			break;
+
+			/* block -> CONST const_stmt */
+		case (N_CONST):
+			if (getWordID(token_stream) == CONST) {
+				MTNT(p);
+				item_stack_push(&p->item, N_CONST_ITEM);
+			}
+			break;
+
+		case (N_CONST_ITEM):
+			declare(p, CONST);
+			expand(p, P_CONST_ITEM);
+			break;
+
+		case (N_CONST_MORE):
+			declare_more(p, N_CONST_ITEM);
+			break;
+
+		case (N_CONST_VALUE):
+			if (getNumberID(token_stream) != NUM)
+				PARSE_ERR(getLine(token_stream), TYP_CONST_NUM);
 
-		else {
-			switch (getWordID(token_stream)) {
-				/* condition -> expression == expression */
-				case (EQ):
+			st_set_value(stlookup(p->symbol_table, p->constant),
+					getNumber(token_stream));
+			scope_set_value(ast, getNumber(token_stream));
+			MTNT(p);
+			break;
+
+			/* block -> proc
+			 * proc  -> proc proc_stmt | proc_stmt */
+		case (N_PROC):
+			if (getWordID(token_stream) != PROCEDURE)
+				break;
+
+			MTNT(p);
+			procedure_name = getSymbol(token_stream);
+			declare(p, PROCEDURE);
+
+			if (getToken(token_stream) == ';')
+				MTNT(p);
+			else
+				PARSE_ERR(getLine(token_stream), SYN_MISS_COM);
 
-					expr_relation_set_op(expression_tmp_op, getWord(token_stream));
-					MTNT(token_stream);
-					expression(code);
-					break;
+			/* the block after the procedure replaces the current block,
+			 * the block within the procedure is parsed first */
+			block_ptr = value_stack_pop(&p->value);
+			block_init_procedure(ast, block_ptr, procedure_name);
+			value_stack_push(&p->value, block_get_main(ast, block_ptr));
+			value_stack_push(&p->value, block_get_function(ast, block_ptr));
+			expand(p, P_PROC);
+			break;
 
-					/* condition -> expression != expression */
-				case (NE):
+		case (N_STMT):
+			statement(p, value_stack_pop(&p->value));
+			break;
 
-					expr_relation_set_op(expression_tmp_op, getWord(token_stream));
-					MTNT(token_stream);
-					expression(code);
-					break;
+		case (N_LIST_ITEM):
+			MTNT(p);
+			value_stack_push(&p->value,
+					stmt_list_append(ast, *value_stack_top(&p->value)));
+			expand(p, P_LIST_ITEM);
+			break;
 
-					/* condition -> expression <= expression */
-				case (LE):
+		case (N_LIST_MORE):
+			if (getToken(token_stream) == ';')
+				item_stack_push(&p->item, N_LIST_ITEM);
+			else {
+				item_stack_push(&p->item, T_END);
+				stmt_end_list(ast, value_stack_pop(&p->value));
+			}
+			break;
 
-					expr_relation_set_op(expression_tmp_op, getWord(token_stream));
-					MTNT(token_stream);
-					expression(code);
-					break;
+		case (N_CONDITION):
+			if (getWordID(token_stream) == ODD) {
+				MTNT(p);
+				expand(p, P_ODD);
+			} else
+				expand(p, P_CONDITION);
+			break;
 
-					/* condition -> expression >= expression */
-				case (GE):
+			/* compare -> > | < | EQ | NE | LE | GE */
+		case (N_RELATION):
+			if (getToken(token_stream) == '>' || getToken(token_stream) == '<')
+				op = getToken(token_stream);
 
-					expr_relation_set_op(expression_tmp_op, getWord(token_stream));
-					MTNT(token_stream);
-					expression(code);
-					break;
+			else {
+				op = getWordID(token_stream);
 
-				default:
+				if (op != EQ && op != NE && op != LE && op != GE)
 					PARSE_ERR(getLine(token_stream), SYN_NO_COMP);
 			}
-		}
-	}
-}
 
-/**
- * @brief check expression syntax
- *
- * @param *code pointer to source code object
- * @retval void
- **/
-void expression(SOURCECODE code) {
+			value_stack_push(&p->value, op);
+			MTNT(p);
+			expand(p, P_RELATION);
+			break;
 
-	QUEUE token_stream = sc_get_ts(code);
-	AST_EXPR_PTR expression_ptr = sc_get_ast_ex(code);
-	AST_EXPR_PTR expression_tmp = NULL, expression_tmp_op = expression_ptr;
+		case (N_EXPRESSION):
+			if (getToken(token_stream) == '-') {
+				MTNT(p);
+				expand(p, P_NEG_EXPRESSION);
+			} else
+				expand(p, P_EXPRESSION);
+			break;
 
-	/* expression -> - term */
-	if (getToken(token_stream) == '-') {
-		expression_ptr = expr_init_unary(expression_ptr, getToken(token_stream));
-		MTNT(token_stream);
-	}
+		case (N_EXPR_REST):
+			if (getToken(token_stream) == '+' || getToken(token_stream) == '-') {
+				value_stack_push(&p->value, getToken(token_stream));
+				MTNT(p);
+				expand(p, P_EXPR_REST);
+			}
+			break;
+
+		case (N_TERM):
+			expand(p, P_TERM);
+			break;
+
+		case (N_TERM_REST):
+			if (getToken(token_stream) == '*' || getToken(token_stream) == '/') {
+				value_stack_push(&p->value, getToken(token_stream));
+				MTNT(p);
+				expand(p, P_TERM_REST);
+			}
+			break;
 
-	/* expression -> term */
-	expr_init_arithmetic(expression_ptr);
-	sc_set_ast_ex(code, expr_get_arithmetic_left(expression_ptr));
-	expression_tmp = expr_get_arithmetic_right(expression_ptr);
-	term(code);
-	sc_set_ast_ex(code, expression_tmp);
-
-	/* expression -> expression + term | expression - term */
-	while (getToken(token_stream) == '+' || getToken(token_stream) == '-') {
-		expr_arithmetic_set_op(expression_tmp_op, getToken(token_stream));
-		MTNT(token_stream);
-		term(code);
+			/* factor -> identifier | number | ( expression ) */
+		case (N_FACTOR):
+			if (getWordID(token_stream) == IDENTIFIER) {
+				check_identifier(p, FALSE, TYP_ONLY_INT);
+				value_stack_push(&p->value,
+						expr_init_identifier(ast, getSymbol(token_stream)));
+				MTNT(p);
+			}
+
+			else if (getNumberID(token_stream) == NUM) {
+				value_stack_push(&p->value,
+						expr_init_number(ast, getNumber(token_stream)));
+				MTNT(p);
+			}
+
+			else if (getToken(token_stream) == '(') {
+				MTNT(p);
+				expand(p, P_PARENTHESES);
+			}
+
+			else
+				PARSE_ERR(getLine(token_stream), SYN_MISS_OB);
+			break;
 	}
 }
 
 /**
- * @brief check term syntax
+ * @brief match current token against terminal
  *
- * @param *code pointer to source code object
+ * @param *p parser
+ * @param item terminal
  * @retval void
  **/
-void term(SOURCECODE code) {
-
-	QUEUE token_stream = sc_get_ts(code);
-	AST_EXPR_PTR expression_ptr = sc_get_ast_ex(code);
-	AST_EXPR_PTR expression_tmp = NULL, expression_tmp_op = expression_ptr;
-
-	/* term -> factor */
-	expr_init_arithmetic(expression_ptr);
-	sc_set_ast_ex(code, expr_get_arithmetic_left(expression_ptr));
-	expression_tmp = expr_get_arithmetic_right(expression_ptr);
-	factor(code);
-	sc_set_ast_ex(code, expression_tmp);
-
-	/* term -> term * factor | term / factor */
-	while (getToken(token_stream) == '*' || getToken(token_stream) == '/') {
-		expr_arithmetic_set_op(expression_tmp_op, getToken(token_stream));
-		MTNT(token_stream);
-		term(code);
-	}
+static void match(struct PARSER *p, const unsigned char item) {
+	TSPTR token_stream = p->token_stream;
+	int token = terminal[item - T_PROC_SEMICOLON].token;
+
+	if ((token < 256) ? getToken(token_stream) == token :
+			getWordID(token_stream) == token)
+		MTNT(p);
+	else
+		PARSE_ERR(getLine(token_stream),
+				terminal[item - T_PROC_SEMICOLON].error);
 }
 
 /**
- * @brief check factor syntax
+ * @brief build AST knot or update symbol table
  *
- * @param *code pointer to source code object
+ * @param *p parser
+ * @param item action
  * @retval void
  **/
-void factor(SOURCECODE code) {
+static void act(struct PARSER *p, const unsigned char item) {
+	struct value_stack *v = &p->value;
+	ASTPTR ast = p->ast;
+	unsigned int left, right, op, st;
+
+	switch (item) {
+		case (A_ENTER):
+			stenter(p->symbol_table);
+			block_init_scope(ast, *value_stack_top(v));
+			break;
 
-	STACK symbol_table = sc_get_st(code);
-	QUEUE token_stream = sc_get_ts(code);
-	TEPTR table_entry = NULL;
-	AST_EXPR_PTR expression_ptr = sc_get_ast_ex(code);
+		case (A_CLEAN):
+			stclean(p->symbol_table);
+			value_stack_pop(v);
+			break;
 
-	/* factor -> identifier */
-	if (getWordID(token_stream) == IDENTIFIER) {
+		case (A_BLOCK_STMT):
+			value_stack_push(v, block_init_statement(ast, *value_stack_top(v)));
+			break;
 
-		table_entry = stlookup(symbol_table, getWord(token_stream));
+		case (A_ASSIGN):
+			right = value_stack_pop(v);
+			op = value_stack_pop(v);
+			stmt_init_assignment(ast, value_stack_pop(v), op, right);
+			break;
 
-		if (table_entry == NULL)
-			PARSE_ERR(getLine(token_stream), TYP_ID_NO_IN);
-		else if (st_get_typeID(table_entry) == PROCEDURE)
-			PARSE_ERR(getLine(token_stream), TYP_ONLY_INT);
+		case (A_PRINT):
+			right = value_stack_pop(v);
+			stmt_init_print(ast, value_stack_pop(v), right);
+			break;
 
-		expr_init_identifier(expression_ptr, getWord(token_stream));
-		MTNT(token_stream);
-		/* factor -> number */
-	}
+			/* the statement knot is replaced by the knot of the inner statement */
+		case (A_IF):
+			right = value_stack_pop(v);
+			st = value_stack_pop(v);
+			stmt_init_jumpfor(ast, st, right);
+			value_stack_push(v, stmt_get_jumpfor_statement(ast, st));
+			break;
+
+		case (A_WHILE):
+			right = value_stack_pop(v);
+			st = value_stack_pop(v);
+			stmt_init_jumpbac(ast, st, right);
+			value_stack_push(v, stmt_get_jumpbac_statement(ast, st));
+			break;
+
+		case (A_ODD):
+			value_stack_push(v, expr_init_odd(ast, value_stack_pop(v)));
+			break;
+
+		case (A_REL):
+			right = value_stack_pop(v);
+			op = value_stack_pop(v);
+			left = value_stack_pop(v);
+			value_stack_push(v, expr_init_relation(ast, op, left, right));
+			break;
+
+		case (A_NEG):
+			value_stack_push(v, expr_init_unary(ast, '-', value_stack_pop(v)));
+			break;
 
-	else if (getNumberID(token_stream) == NUM) {
-		expr_init_number(expression_ptr, getNumber(token_stream));
-		MTNT(token_stream);
-		/* factor -> ( expression ) */
+		case (A_ARITH):
+			right = value_stack_pop(v);
+			op = value_stack_pop(v);
+			left = value_stack_pop(v);
+			value_stack_push(v,
+					expr_init_arithmetic(ast, (char) op, left, right));
+			break;
 	}
+}
 
-	else if (getToken(token_stream) == '(') {
-		MTNT(token_stream);
-		expression(code);
+/**
+ * @brief LL(1) parser loop
+ *
+ * Takes items from the parse stack until it is empty. Nesting only grows
+ * the stacks on the heap, never the C stack.
+ *
+ * @param *p parser
+ * @retval void
+ **/
+static void parse(struct PARSER *p) {
+	unsigned char item;
+
+	while (!item_stack_empty(&p->item)) {
+		item = item_stack_pop(&p->item);
 
-		if (getToken(token_stream) == ')')
-			MTNT(token_stream);
+		if (item < T_PROC_SEMICOLON)
+			predict(p, item);
+		else if (item < A_ENTER)
+			match(p, item);
 		else
-			PARSE_ERR(getLine(token_stream), SYN_MISS_CB);
+			act(p, item);
 	}
-
-	else
-		PARSE_ERR(getLine(token_stream), SYN_MISS_OB);
 }
-
@@ -0,0 +1,325 @@
+/*
+ * PiL0 - PL0 Compiler for Raspberry PI
+ * Copyright (C) 2013  Philipp Wiesner
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file report.c Library for measuring the phases of a compilation
+ *
+ * Every phase is enclosed by report_begin() and report_end(), which record
+ * wall clock and CPU time, counted allocations, peak resident memory, the
+ * chunks of the token arena and the tokens and AST knots existing at the end
+ * of the phase. print_report() writes them as table or as JSON document. All
+ * functions accept NULL instead of a report and do nothing then, so phases
+ * can be enclosed whether a report was asked for or not.
+ *
+ * CPU time is measured per thread, as other compilations may run on other
+ * threads of the process. Threads helping a compilation, like those of the
+ * parallel lexer, add their CPU time with report_add_cpu().
+ *
+ * @defgroup report Time Report
+ * @brief time, allocations and memory per compiler phase
+ * @ingroup global report
+ */
+
+#if defined(__unix__) || defined(__APPLE__)
+#define _XOPEN_SOURCE 600
+#define PL_HAVE_RUSAGE
+#endif
+
+#include"frontend.h"
+#include"containers.h"
+#include<time.h>
+
+#ifdef PL_HAVE_RUSAGE
+#include<sys/time.h>
+#include<sys/resource.h>
+#endif
+
+#define REPORT_ERR "Time Report"
+
+/**
+ * @struct PHASE
+ *
+ * @brief measurements of one phase
+ */
+struct PHASE {
+	const char *name; 			/**< name of phase */
+	double wall; 				/**< wall clock seconds */
+	double cpu; 				/**< CPU seconds of compiling thread and its helpers */
+	unsigned long allocations; 	/**< counted allocations */
+	unsigned long bytes; 		/**< bytes requested by allocations */
+	long peak_rss; 				/**< peak resident set size at end in KB, -1 if unknown */
+	size_t arena_bytes; 		/**< bytes of token arena chunks at end of phase */
+	size_t arena_chunks; 		/**< token arena chunks at end of phase */
+	size_t tokens; 				/**< tokens at end of phase */
+	size_t knots; 				/**< AST knots at end of phase */
+};
+
+DEFINE_VECTOR(phase_vector, struct PHASE)
+
+/**
+ * @struct TIME_REPORT
+ *
+ * @brief finished phases and start values of the running one
+ */
+struct TIME_REPORT {
+	struct phase_vector phase; 	/**< finished phases, running one on top */
+	double wall; 				/**< wall clock at start of running phase */
+	double cpu; 				/**< CPU time at start of running phase */
+	double helpers; 			/**< CPU time of helper threads in running phase */
+	unsigned long allocations; 	/**< allocations at start of running phase */
+	unsigned long bytes; 		/**< bytes at start of running phase */
+};
+
+/**
+ * @brief monotonic wall clock time in seconds
+ *
+ * @retval double
+ */
+static double wall_time() {
+#if defined(PL_HAVE_RUSAGE) && defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+		return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+	return (double) time(NULL);
+}
+
+/**
+ * @brief CPU time of calling thread in seconds
+ *
+ * Falls back to the CPU time of the process without a thread clock.
+ *
+ * @retval double
+ */
+double report_thread_cpu() {
+#if defined(PL_HAVE_RUSAGE) && defined(CLOCK_THREAD_CPUTIME_ID)
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+		return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+	return (double) clock() / CLOCKS_PER_SEC;
+}
+
+/**
+ * @brief peak resident set size in kilobytes
+ *
+ * @retval long peak or -1 if unknown
+ */
+static long peak_rss() {
+#ifdef PL_HAVE_RUSAGE
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return -1;
+
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+#else
+	return -1;
+#endif
+}
+
+/**
+ * @brief create new empty report
+ *
+ * @retval TRPTR new report
+ */
+TRPTR init_report() {
+	TRPTR r = NULL;
+
+	if ((r = pl_malloc(sizeof(*r))) == NULL)
+		error(REPORT_ERR, __FILE__, __func__, __LINE__, ERR_MEMORY);
+
+	phase_vector_init(&r->phase);
+	return r;
+}
+
+/**
+ * @brief free report
+ *
+ * @param r report or NULL
+ * @retval void
+ */
+void free_report(TRPTR r) {
+	if (r == NULL)
+		return;
+
+	phase_vector_free(&r->phase);
+	free(r);
+}
+
+/**
+ * @brief start measuring a phase
+ *
+ * @param r report or NULL
+ * @param *name name of phase, has to stay valid as long as the report
+ * @retval void
+ */
+void report_begin(TRPTR r, const char *name) {
+	struct PHASE phase = { 0 };
+
+	if (r == NULL)
+		return;
+
+	phase.name = name;
+	phase_vector_push(&r->phase, phase);
+
+	r->allocations = alloc_count();
+	r->bytes = alloc_bytes();
+	r->cpu = report_thread_cpu();
+	r->helpers = 0;
+	r->wall = wall_time();
+}
+
+/**
+ * @brief finish measuring the phase started last
+ *
+ * @param r report or NULL
+ * @param tokens tokens existing at end of phase
+ * @param knots AST knots existing at end of phase
+ * @param arena token arena or NULL
+ * @retval void
+ */
+void report_end(TRPTR r, const size_t tokens, const size_t knots,
+		const ARPTR arena) {
+	struct PHASE *phase;
+	double wall;
+
+	if (r == NULL)
+		return;
+
+	wall = wall_time();
+	phase = phase_vector_top(&r->phase);
+	phase->wall = wall - r->wall;
+	phase->cpu = report_thread_cpu() - r->cpu + r->helpers;
+	phase->allocations = alloc_count() - r->allocations;
+	phase->bytes = alloc_bytes() - r->bytes;
+	phase->peak_rss = peak_rss();
+	phase->arena_bytes = (arena != NULL) ? arena_reserved(arena) : 0;
+	phase->arena_chunks = (arena != NULL) ? arena_chunks(arena) : 0;
+	phase->tokens = tokens;
+	phase->knots = knots;
+}
+
+/**
+ * @brief add CPU time of a helper thread to the running phase
+ *
+ * Calls from several threads have to be serialized by the caller.
+ *
+ * @param r report or NULL
+ * @param seconds CPU time the helper spent on the phase
+ * @retval void
+ */
+void report_add_cpu(TRPTR r, const double seconds) {
+	if (r == NULL)
+		return;
+
+	r->helpers += seconds;
+}
+
+/**
+ * @brief print phases as table
+ *
+ * @param r report
+ * @param out stream
+ * @retval void
+ */
+static void print_table(const TRPTR r, FILE *out) {
+	struct PHASE total = { 0 };
+	size_t i;
+
+	total.name = "total";
+	fprintf(out, "%-10s %10s %10s %11s %11s %9s %9s %6s %10s %10s\n",
+			"phase", "wall ms", "cpu ms", "allocations", "alloc KB", "peak KB",
+			"arena KB", "chunks", "tokens", "knots");
+
+	for (i = 0; i <= phase_vector_size(&r->phase); i++) {
+		const struct PHASE *p = &total;
+
+		if (i < phase_vector_size(&r->phase)) {
+			p = phase_vector_at(&r->phase, i);
+			total.wall += p->wall;
+			total.cpu += p->cpu;
+			total.allocations += p->allocations;
+			total.bytes += p->bytes;
+			total.peak_rss = p->peak_rss;
+			total.arena_bytes = p->arena_bytes;
+			total.arena_chunks = p->arena_chunks;
+			total.tokens = p->tokens;
+			total.knots = p->knots;
+		}
+
+		fprintf(out,
+				"%-10s %10.3f %10.3f %11lu %11.1f %9ld %9.1f %6lu %10lu %10lu\n",
+				p->name, p->wall * 1e3, p->cpu * 1e3, p->allocations,
+				p->bytes / 1024.0, p->peak_rss, p->arena_bytes / 1024.0,
+				(unsigned long) p->arena_chunks, (unsigned long) p->tokens,
+				(unsigned long) p->knots);
+	}
+}
+
+/**
+ * @brief print phases as JSON document
+ *
+ * @param r report
+ * @param out stream
+ * @retval void
+ */
+static void print_json(const TRPTR r, FILE *out) {
+	size_t i;
+
+	fputs("{\n  \"phases\": [", out);
+
+	for (i = 0; i < phase_vector_size(&r->phase); i++) {
+		const struct PHASE *p = phase_vector_at(&r->phase, i);
+
+		fprintf(out, "%s\n    { \"name\": \"%s\", \"wall_ms\": %.3f, "
+				"\"cpu_ms\": %.3f, \"allocations\": %lu, \"alloc_bytes\": %lu, "
+				"\"peak_rss_kb\": %ld, \"arena_bytes\": %lu, \"arena_chunks\": %lu, "
+				"\"tokens\": %lu, \"knots\": %lu }",
+				(i > 0) ? "," : "", p->name, p->wall * 1e3, p->cpu * 1e3,
+				p->allocations, p->bytes, p->peak_rss,
+				(unsigned long) p->arena_bytes, (unsigned long) p->arena_chunks,
+				(unsigned long) p->tokens, (unsigned long) p->knots);
+	}
+
+	fputs("\n  ]\n}\n", out);
+}
+
+/**
+ * @brief print report
+ *
+ * @param r report or NULL
+ * @param out stream
+ * @param format REPORT_TABLE or REPORT_JSON
+ * @retval void
+ */
+void print_report(const TRPTR r, FILE *out, const int format) {
+	if (r == NULL)
+		return;
+
+	if (format == REPORT_JSON)
+		print_json(r, out);
+	else
+		print_table(r, out);
+}
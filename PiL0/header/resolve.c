@@ -0,0 +1,243 @@
+/*
+ * PiL0 - PL0 Compiler for Raspberry PI
+ * Copyright (C) 2013  Philipp Wiesner
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file resolve.c Library for resolving identifiers to addresses
+ *
+ * After parsing, the AST is walked once with the scopes opened and closed
+ * the way the parser did. Every declaration gets its address, every
+ * identifier expression, assignment, CALL and READ stores the address of the
+ * declaration it refers to, so backends address frames directly and never
+ * look at names again.
+ *
+ * Unless folding is switched off, constants are propagated on the way:
+ * identifier expressions of a CONST become numbers holding its value.
+ *
+ * Scopes are numbered in the order their blocks appear in the source, which
+ * is the order the walk opens them: the main program is 0, procedures
+ * follow in order of declaration. This number is the index of a procedure.
+ *
+ * @defgroup resolve Resolver
+ * @brief static addresses of VAR, CONST and PROCEDURE declarations
+ * @ingroup parser resolve
+ */
+
+#include"frontend.h"
+#include"containers.h"
+
+/**
+ * @struct OPEN_SCOPE
+ *
+ * @brief scope whose blocks are being walked
+ */
+struct OPEN_SCOPE {
+	AST_SCOPE_REF scope; 		/**< index of scope */
+	AST_BLOCK_REF block; 		/**< first block, closes the scope when left */
+};
+
+DEFINE_STACK(open_stack, struct OPEN_SCOPE)
+
+/**
+ * @struct RESOLVER
+ *
+ * @brief state of the walk
+ */
+struct RESOLVER {
+	ASTPTR ast; 				/**< AST to resolve */
+	STPTR table; 				/**< declarations visible at current knot */
+	struct open_stack open; 	/**< open scopes, innermost on top */
+	AST_SCOPE_REF next; 		/**< scope opened next */
+	SYMBOL procedure; 			/**< name of procedure whose scope is opened next */
+	size_t line; 				/**< line of statement walked last */
+	int propagate; 				/**< replace constants by their value */
+};
+
+/**
+ * @brief open scope and declare its VAR and CONST
+ *
+ * @param *r resolver
+ * @param bl first block of scope
+ * @retval void
+ */
+static void open_scope(struct RESOLVER *r, const AST_BLOCK_REF bl) {
+	struct OPEN_SCOPE open;
+	AST_ADDRESS address;
+	unsigned int slot;
+	size_t size = scope_get_size(r->ast, r->next);
+	int kind, value;
+
+	open.scope = r->next++;
+	open.block = bl;
+	address.depth = (unsigned int) open_stack_size(&r->open);
+	scope_set_owner(r->ast, open.scope, r->procedure, address.depth,
+			open_stack_empty(&r->open) ? AST_NONE :
+					open_stack_top(&r->open)->scope);
+	open_stack_push(&r->open, open);
+	stenter(r->table);
+
+	for (slot = 0; slot < size; slot++) {
+		SYMBOL s = scope_get_decl(r->ast, open.scope, slot, &kind, &value);
+		TEPTR te;
+
+		stdeclare(r->table, s, kind);
+		te = stlookup(r->table, s);
+		address.slot = slot;
+		st_set_address(te, address);
+		st_set_value(te, value);
+	}
+}
+
+/**
+ * @brief look up identifier and check its kind
+ *
+ * @param *r resolver
+ * @param s identifier
+ * @param kind PROCEDURE, VAR or 0 for VAR or CONST
+ * @retval TEPTR declaration
+ */
+static TEPTR lookup(struct RESOLVER *r, const SYMBOL s, const int kind) {
+	TEPTR te = stlookup(r->table, s);
+	int type;
+
+	if (te == NULL)
+		parseError((int) r->line, TYP_ID_NO_IN);
+	else {
+		type = st_get_typeID(te);
+
+		if (kind == PROCEDURE && type != PROCEDURE)
+			parseError((int) r->line, TYP_ONLY_PROC);
+		else if (kind != PROCEDURE && type == PROCEDURE)
+			parseError((int) r->line, TYP_ONLY_INT);
+		else if (kind == VAR && type == CONST)
+			parseError((int) r->line, TYP_ASSIGN_CONST);
+	}
+
+	return te;
+}
+
+/**
+ * @brief pre callback, opens scopes, declares procedures and resolves names
+ */
+static int resolve_pre(void *data, const ASTPTR ast, const int class,
+		const unsigned int ref) {
+	struct RESOLVER *r = data;
+	AST_ADDRESS address;
+	TEPTR te;
+
+	switch (class) {
+	case (AST_CLASS_BLOCK):
+		if (r->next < ast_scopes(ast) && scope_get_block(ast, r->next) == ref)
+			open_scope(r, ref);
+
+		/* the procedure is visible in its own block and after it */
+		if (block_get_tag(ast, ref) == BLOCK_PROC) {
+			r->procedure = block_get_identifier(ast, ref);
+			address.depth = scope_get_depth(ast, open_stack_top(&r->open)->scope);
+			address.slot = r->next;
+			stdeclare(r->table, r->procedure, PROCEDURE);
+			st_set_address(stlookup(r->table, r->procedure), address);
+		}
+		break;
+
+	case (AST_CLASS_STMT):
+		r->line = stmt_get_line(ast, ref);
+
+		if (stmt_get_tag(ast, ref) == STMT_ASSIGN)
+			stmt_set_address(ast, ref, st_get_address(
+					lookup(r, stmt_get_identifier(ast, ref), VAR)));
+		else if (stmt_get_tag(ast, ref) == STMT_CARE)
+			stmt_set_address(ast, ref, st_get_address(
+					lookup(r, stmt_get_identifier(ast, ref),
+							(stmt_get_care(ast, ref) == CALL) ? PROCEDURE : VAR)));
+		break;
+
+	case (AST_CLASS_EXPR):
+		if (expr_get_tag(ast, ref) != EXPR_IDENTIFIER)
+			break;
+
+		te = lookup(r, expr_get_identifier(ast, ref), 0);
+
+		if (r->propagate && st_get_typeID(te) == CONST)
+			expr_set_number(ast, ref, st_get_value(te));
+		else
+			expr_set_address(ast, ref, st_get_address(te));
+		break;
+	}
+
+	return VISIT_CONTINUE;
+}
+
+/**
+ * @brief post callback, closes scope after its last block
+ */
+static int resolve_post(void *data, const ASTPTR ast, const int class,
+		const unsigned int ref) {
+	struct RESOLVER *r = data;
+
+	(void) ast;
+
+	if (class == AST_CLASS_BLOCK && !open_stack_empty(&r->open)
+			&& open_stack_top(&r->open)->block == ref) {
+		stclean(r->table);
+		open_stack_pop(&r->open);
+	}
+
+	return VISIT_CONTINUE;
+}
+
+/**
+ * @brief resolve all identifiers of parsed program
+ *
+ * Assigning or reading into a constant is reported as error.
+ *
+ * @param code pointer to source code object
+ * @retval void
+ */
+void resolve(SOURCECODE code) {
+	struct RESOLVER r;
+	AST_VISITOR v;
+	AWPTR walker = init_walker(0);
+	DIAG_FRAME frame;
+	int status;
+
+	r.ast = sc_get_ast(code);
+	r.table = init_symbol_table();
+	r.next = 0;
+	r.procedure = NO_SYMBOL;
+	r.line = 0;
+	r.propagate = !sc_get_options(code)->no_fold;
+	open_stack_init(&r.open);
+
+	v.pre = resolve_pre;
+	v.post = resolve_post;
+	v.data = &r;
+
+	/* release the walk before an error unwinds further */
+	diag_push(&frame, NULL, NULL);
+
+	if ((status = setjmp(frame.unwind)) == 0)
+		walk_ast(walker, r.ast, AST_CLASS_BLOCK, 0, &v);
+
+	diag_pop(&frame);
+	open_stack_free(&r.open);
+	free_symbol_table(r.table);
+	free_walker(walker);
+
+	if (status != COMPILE_OK)
+		diag_raise(NULL, status);
+}
@@ -0,0 +1,450 @@
+/*
+ * PiL0 - PL0 Compiler for Raspberry PI
+ * Copyright (C) 2013  Philipp Wiesner
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file scan.c Library for character classification and skipping character runs
+ *
+ * Classifies characters by a locale independent table and skips runs of white
+ * space, identifier and digit characters. Besides the portable version there
+ * are vector versions for SSE2 and AVX2 on x86 and NEON on ARM which test 16 or
+ * 32 characters at once. The version is chosen at runtime.
+ *
+ * @ingroup lexer
+ */
+
+#include"frontend.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_X86
+#include<immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SCAN_ARM_NEON
+#include<arm_neon.h>
+#endif
+
+#define SP CC_SPACE
+#define NL (CC_SPACE | CC_NEWLINE)
+#define AL CC_ALPHA
+#define DI CC_DIGIT
+
+/**
+ * @var char_class[]
+ * @brief character class of every byte
+ *
+ * Control characters, DEL and blank are white space, only ASCII letters and
+ * digits belong to identifiers and numbers.
+ **/
+const unsigned char char_class[256] = {
+	SP, SP, SP, SP, SP, SP, SP, SP, SP, SP, NL, SP, SP, SP, SP, SP,
+	SP, SP, SP, SP, SP, SP, SP, SP, SP, SP, SP, SP, SP, SP, SP, SP,
+	SP,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	DI, DI, DI, DI, DI, DI, DI, DI, DI, DI,  0,  0,  0,  0,  0,  0,
+	 0, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL,
+	AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL,  0,  0,  0,  0,  0,
+	 0, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL,
+	AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL,  0,  0,  0,  0, SP,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+};
+
+#undef SP
+#undef NL
+#undef AL
+#undef DI
+
+#define CLASS(p) char_class[(unsigned char) *(p)]
+
+/**
+ * @brief skip white space and count new lines
+ *
+ * @param *p first character
+ * @param *end end of text
+ * @param *lines line counter which is increased for every new line
+ * @retval char* first character which is no white space
+ */
+static const char *skip_space_scalar(const char *p, const char *end,
+		size_t *lines) {
+	for (; p < end && (CLASS(p) & CC_SPACE); p++)
+		*lines += (*p == '\n');
+
+	return p;
+}
+
+/**
+ * @brief skip letters and digits
+ *
+ * @param *p first character
+ * @param *end end of text
+ * @retval char* first character which is no letter or digit
+ */
+static const char *skip_alnum_scalar(const char *p, const char *end) {
+	while (p < end && (CLASS(p) & (CC_ALPHA | CC_DIGIT)))
+		p++;
+
+	return p;
+}
+
+/**
+ * @brief skip digits
+ *
+ * @param *p first character
+ * @param *end end of text
+ * @retval char* first character which is no digit
+ */
+static const char *skip_digit_scalar(const char *p, const char *end) {
+	while (p < end && (CLASS(p) & CC_DIGIT))
+		p++;
+
+	return p;
+}
+
+static const CHAR_SCANNER scalar_scanner = { "scalar", skip_space_scalar,
+		skip_alnum_scalar, skip_digit_scalar };
+
+#ifdef SCAN_X86
+
+/*
+ * Unsigned range checks use min: x <= k (unsigned) <=> min(x, k) == x.
+ * The mask of bytes outside of a class is inverted movemask, its lowest set
+ * bit is the length of the run.
+ */
+
+/**
+ * @brief SSE2 version of skip_space_scalar()
+ */
+__attribute__((target("sse2")))
+static const char *skip_space_sse2(const char *p, const char *end,
+		size_t *lines) {
+	const __m128i blank = _mm_set1_epi8(' '), del = _mm_set1_epi8(127);
+	const __m128i nl = _mm_set1_epi8('\n');
+
+	while (end - p >= 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *) p);
+		__m128i sp = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(v, blank), v),
+				_mm_cmpeq_epi8(v, del));
+		unsigned int other = ~_mm_movemask_epi8(sp) & 0xFFFF;
+		unsigned int newline = _mm_movemask_epi8(_mm_cmpeq_epi8(v, nl));
+
+		if (other != 0) {
+			unsigned int run = __builtin_ctz(other);
+
+			*lines += __builtin_popcount(newline & ((1u << run) - 1));
+			return p + run;
+		}
+
+		*lines += __builtin_popcount(newline);
+		p += 16;
+	}
+
+	return skip_space_scalar(p, end, lines);
+}
+
+/**
+ * @brief SSE2 version of skip_alnum_scalar()
+ */
+__attribute__((target("sse2")))
+static const char *skip_alnum_sse2(const char *p, const char *end) {
+	const __m128i zero = _mm_set1_epi8('0'), nine = _mm_set1_epi8(9);
+	const __m128i a = _mm_set1_epi8('a'), z = _mm_set1_epi8(25);
+	const __m128i lower = _mm_set1_epi8(0x20);
+
+	while (end - p >= 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *) p);
+		__m128i d = _mm_sub_epi8(v, zero);
+		__m128i l = _mm_sub_epi8(_mm_or_si128(v, lower), a);
+		__m128i in = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(d, nine), d),
+				_mm_cmpeq_epi8(_mm_min_epu8(l, z), l));
+		unsigned int other = ~_mm_movemask_epi8(in) & 0xFFFF;
+
+		if (other != 0)
+			return p + __builtin_ctz(other);
+
+		p += 16;
+	}
+
+	return skip_alnum_scalar(p, end);
+}
+
+/**
+ * @brief SSE2 version of skip_digit_scalar()
+ */
+__attribute__((target("sse2")))
+static const char *skip_digit_sse2(const char *p, const char *end) {
+	const __m128i zero = _mm_set1_epi8('0'), nine = _mm_set1_epi8(9);
+
+	while (end - p >= 16) {
+		__m128i d = _mm_sub_epi8(_mm_loadu_si128((const __m128i *) p), zero);
+		unsigned int other = ~_mm_movemask_epi8(
+				_mm_cmpeq_epi8(_mm_min_epu8(d, nine), d)) & 0xFFFF;
+
+		if (other != 0)
+			return p + __builtin_ctz(other);
+
+		p += 16;
+	}
+
+	return skip_digit_scalar(p, end);
+}
+
+/**
+ * @brief AVX2 version of skip_space_scalar()
+ */
+__attribute__((target("avx2")))
+static const char *skip_space_avx2(const char *p, const char *end,
+		size_t *lines) {
+	const __m256i blank = _mm256_set1_epi8(' '), del = _mm256_set1_epi8(127);
+	const __m256i nl = _mm256_set1_epi8('\n');
+
+	while (end - p >= 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) p);
+		__m256i sp = _mm256_or_si256(
+				_mm256_cmpeq_epi8(_mm256_min_epu8(v, blank), v),
+				_mm256_cmpeq_epi8(v, del));
+		unsigned int other = ~(unsigned int) _mm256_movemask_epi8(sp);
+		unsigned int newline = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl));
+
+		if (other != 0) {
+			unsigned int run = __builtin_ctz(other);
+
+			if (run > 0)
+				*lines += __builtin_popcount(
+						newline & (0xFFFFFFFFu >> (32 - run)));
+			return p + run;
+		}
+
+		*lines += __builtin_popcount(newline);
+		p += 32;
+	}
+
+	return skip_space_sse2(p, end, lines);
+}
+
+/**
+ * @brief AVX2 version of skip_alnum_scalar()
+ */
+__attribute__((target("avx2")))
+static const char *skip_alnum_avx2(const char *p, const char *end) {
+	const __m256i zero = _mm256_set1_epi8('0'), nine = _mm256_set1_epi8(9);
+	const __m256i a = _mm256_set1_epi8('a'), z = _mm256_set1_epi8(25);
+	const __m256i lower = _mm256_set1_epi8(0x20);
+
+	while (end - p >= 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) p);
+		__m256i d = _mm256_sub_epi8(v, zero);
+		__m256i l = _mm256_sub_epi8(_mm256_or_si256(v, lower), a);
+		__m256i in = _mm256_or_si256(
+				_mm256_cmpeq_epi8(_mm256_min_epu8(d, nine), d),
+				_mm256_cmpeq_epi8(_mm256_min_epu8(l, z), l));
+		unsigned int other = ~(unsigned int) _mm256_movemask_epi8(in);
+
+		if (other != 0)
+			return p + __builtin_ctz(other);
+
+		p += 32;
+	}
+
+	return skip_alnum_sse2(p, end);
+}
+
+/**
+ * @brief AVX2 version of skip_digit_scalar()
+ */
+__attribute__((target("avx2")))
+static const char *skip_digit_avx2(const char *p, const char *end) {
+	const __m256i zero = _mm256_set1_epi8('0'), nine = _mm256_set1_epi8(9);
+
+	while (end - p >= 32) {
+		__m256i d = _mm256_sub_epi8(_mm256_loadu_si256((const __m256i *) p),
+				zero);
+		unsigned int other = ~(unsigned int) _mm256_movemask_epi8(
+				_mm256_cmpeq_epi8(_mm256_min_epu8(d, nine), d));
+
+		if (other != 0)
+			return p + __builtin_ctz(other);
+
+		p += 32;
+	}
+
+	return skip_digit_sse2(p, end);
+}
+
+static const CHAR_SCANNER sse2_scanner = { "sse2", skip_space_sse2,
+		skip_alnum_sse2, skip_digit_sse2 };
+
+static const CHAR_SCANNER avx2_scanner = { "avx2", skip_space_avx2,
+		skip_alnum_avx2, skip_digit_avx2 };
+
+#endif
+
+#ifdef SCAN_ARM_NEON
+
+/*
+ * NEON has no movemask, so a block is only tested for a byte outside of the
+ * class. The scalar version then finds the exact position inside this block.
+ */
+
+/**
+ * @brief check if any byte of vector is set
+ *
+ * @param v vector
+ * @retval unsigned nonzero if any byte is nonzero
+ */
+static unsigned int neon_any(uint8x16_t v) {
+#ifdef __aarch64__
+	return vmaxvq_u8(v);
+#else
+	uint8x8_t x = vorr_u8(vget_low_u8(v), vget_high_u8(v));
+	x = vpmax_u8(x, x);
+	x = vpmax_u8(x, x);
+	x = vpmax_u8(x, x);
+	return vget_lane_u8(x, 0);
+#endif
+}
+
+/**
+ * @brief count bytes which are set to 0xFF
+ *
+ * @param v vector of comparison results
+ * @retval unsigned number of set bytes
+ */
+static unsigned int neon_count(uint8x16_t v) {
+	uint8x16_t ones = vandq_u8(v, vdupq_n_u8(1));
+#ifdef __aarch64__
+	return vaddvq_u8(ones);
+#else
+	uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(ones)));
+	return (unsigned int) (vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
+#endif
+}
+
+/**
+ * @brief NEON version of skip_space_scalar()
+ */
+static const char *skip_space_neon(const char *p, const char *end,
+		size_t *lines) {
+	const uint8x16_t blank = vdupq_n_u8(' '), del = vdupq_n_u8(127);
+	const uint8x16_t nl = vdupq_n_u8('\n');
+
+	while (end - p >= 16) {
+		uint8x16_t v = vld1q_u8((const unsigned char *) p);
+		uint8x16_t sp = vorrq_u8(vcleq_u8(v, blank), vceqq_u8(v, del));
+
+		if (neon_any(vmvnq_u8(sp)))
+			break;
+
+		*lines += neon_count(vceqq_u8(v, nl));
+		p += 16;
+	}
+
+	return skip_space_scalar(p, end, lines);
+}
+
+/**
+ * @brief NEON version of skip_alnum_scalar()
+ */
+static const char *skip_alnum_neon(const char *p, const char *end) {
+	const uint8x16_t zero = vdupq_n_u8('0'), nine = vdupq_n_u8(9);
+	const uint8x16_t a = vdupq_n_u8('a'), z = vdupq_n_u8(25);
+	const uint8x16_t lower = vdupq_n_u8(0x20);
+
+	while (end - p >= 16) {
+		uint8x16_t v = vld1q_u8((const unsigned char *) p);
+		uint8x16_t in = vorrq_u8(vcleq_u8(vsubq_u8(v, zero), nine),
+				vcleq_u8(vsubq_u8(vorrq_u8(v, lower), a), z));
+
+		if (neon_any(vmvnq_u8(in)))
+			break;
+
+		p += 16;
+	}
+
+	return skip_alnum_scalar(p, end);
+}
+
+/**
+ * @brief NEON version of skip_digit_scalar()
+ */
+static const char *skip_digit_neon(const char *p, const char *end) {
+	const uint8x16_t zero = vdupq_n_u8('0'), nine = vdupq_n_u8(9);
+
+	while (end - p >= 16) {
+		uint8x16_t v = vld1q_u8((const unsigned char *) p);
+
+		if (neon_any(vmvnq_u8(vcleq_u8(vsubq_u8(v, zero), nine))))
+			break;
+
+		p += 16;
+	}
+
+	return skip_digit_scalar(p, end);
+}
+
+static const CHAR_SCANNER neon_scanner = { "neon", skip_space_neon,
+		skip_alnum_neon, skip_digit_neon };
+
+#endif
+
+/**
+ * @brief return character scanner for instruction set
+ *
+ * @param isa SCAN_AUTO for best supported one or a specific instruction set
+ * @retval CHAR_SCANNER* scanner or NULL if instruction set is not supported
+ */
+const CHAR_SCANNER *get_scanner(int isa) {
+	switch (isa) {
+		case SCAN_SCALAR:
+			return &scalar_scanner;
+
+#ifdef SCAN_X86
+		case SCAN_SSE2:
+			return __builtin_cpu_supports("sse2") ? &sse2_scanner : NULL;
+
+		case SCAN_AVX2:
+			return __builtin_cpu_supports("avx2") ? &avx2_scanner : NULL;
+
+		case SCAN_AUTO:
+			if (__builtin_cpu_supports("avx2"))
+				return &avx2_scanner;
+			if (__builtin_cpu_supports("sse2"))
+				return &sse2_scanner;
+			return &scalar_scanner;
+#endif
+
+#ifdef SCAN_ARM_NEON
+		case SCAN_NEON:
+		case SCAN_AUTO:
+			return &neon_scanner;
+#endif
+
+#if !defined(SCAN_X86) && !defined(SCAN_ARM_NEON)
+		case SCAN_AUTO:
+			return &scalar_scanner;
+#endif
+
+		default:
+			return NULL;
+	}
+}
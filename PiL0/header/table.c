@@ -19,10 +19,17 @@
 /**
  * @file table.c Library for Table Generation
  *
+ * Declarations are kept in one array in declaration order. For every symbol
+ * the index of its innermost visible declaration is stored, and every entry
+ * remembers the declaration it shadows. Looking up a name is one array access,
+ * leaving a scope truncates the array to the size it had when the scope was
+ * entered and restores the shadowed declarations.
+ *
  * @ingroup parser
  */
 
 #include"frontend.h"
+#include"containers.h"
 
 #define TABLE "Symbol-Table"
 
@@ -33,89 +40,167 @@
  *
  **/
 struct TABLE_ENTRY {
-	char word[MAX_LENGTH]; /**< symbol name */
+	SYMBOL symbol; /**< interned symbol name */
 	int type_ID; /**< symbol ID */
+	AST_ADDRESS address; /**< address of declaration, set while resolving */
+	int value; /**< value of constant */
+	size_t shadowed; /**< index + 1 of declaration hidden by this one, 0 if none */
 };
 
+DEFINE_VECTOR(entry_vector, struct TABLE_ENTRY)
+DEFINE_VECTOR(index_vector, size_t)
+DEFINE_STACK(scope_stack, size_t)
+
 /**
- * @brief create new symbol table entry
+ * @struct SYMBOL_TABLE
  *
- * @param *w Symbol which should be stored
- * @param n identifier-type ID
- * @retval new_entry
+ * @brief declarations of all open scopes
+ *
+ **/
+struct SYMBOL_TABLE {
+	struct entry_vector entry; /**< declarations in declaration order */
+	struct index_vector visible; /**< index + 1 of visible declaration for every symbol, 0 if none */
+	struct scope_stack scope; /**< number of declarations when scope was entered */
+	const TRACER *trace; /**< tracer for scopes, declarations and lookups */
+};
+
+/**
+ * @brief create new empty symbol table
+ *
+ * @retval STPTR new symbol table
  **/
-TEPTR generate_tableEntry(const char *w, const int n) {
-	TEPTR new_entry = NULL;
-	
-	if ((new_entry = malloc(sizeof(*new_entry))) == NULL)
+STPTR init_symbol_table() {
+	STPTR st = NULL;
+
+	if ((st = pl_malloc(sizeof(*st))) == NULL)
 		error(TABLE, __FILE__, __func__, __LINE__, ERR_MEMORY);
-	
-	strcpy(new_entry->word, w);
-	new_entry->type_ID = n;
-	return new_entry;
+
+	entry_vector_init(&st->entry);
+	index_vector_init(&st->visible);
+	scope_stack_init(&st->scope);
+	st->trace = &no_trace;
+	return st;
 }
 
 /**
- * @brief clean symbol table after scope finish
+ * @brief free symbol table
  *
- * @param *symbol_table pointer to symbol table
+ * @param st symbol table
  * @retval void
  **/
-void stclean(STACK symbol_table) {
-	TEPTR tmp = pop(symbol_table);
-	
-	while (tmp->type_ID != -1) {
-		free(tmp);
-		tmp = NULL;
-		tmp = pop(symbol_table);
-	}
-	
-	free(tmp);
+void free_symbol_table(STPTR st) {
+	if (st == NULL)
+		return;
+
+	entry_vector_free(&st->entry);
+	index_vector_free(&st->visible);
+	scope_stack_free(&st->scope);
+	free(st);
 }
 
 /**
- * @brief compare word of two table entries
+ * @brief set tracer which records scopes, declarations and lookups
  *
- * @param comp1 entry one
- * @param comp2 entry two
- * @retval int
- */
-static int stcompare(TEPTR comp1, TEPTR comp2) {
-	if (comp1 == NULL || comp2 == NULL)
-		return 0;
-	else
-		return strcmp(comp1->word, comp2->word);
+ * @param st symbol table
+ * @param *tr tracer, has to live as long as the symbol table
+ * @retval void
+ **/
+void st_set_tracer(STPTR st, const TRACER *tr) {
+	st->trace = tr;
 }
 
 /**
- * @brief cast given object to table element type
+ * @brief enter new scope
  *
- * @param *obj object to cast
- * @retval TEPTR element as type of table element
- */
-static TEPTR stcast(void *obj) {
-	return (TEPTR) obj;
+ * @param st symbol table
+ * @retval void
+ **/
+void stenter(STPTR st) {
+	scope_stack_push(&st->scope, entry_vector_size(&st->entry));
+	TRACE(st->trace, TRACE_SYMTAB, TRACE_INFO, EV_ST_ENTER,
+			scope_stack_size(&st->scope), 0, 0);
+}
+
+/**
+ * @brief clean symbol table after scope finish
+ *
+ * Drops all declarations of the scope and makes the declarations they hid visible again.
+ *
+ * @param st symbol table
+ * @retval void
+ **/
+void stclean(STPTR st) {
+	size_t mark;
+
+	TRACE(st->trace, TRACE_SYMTAB, TRACE_INFO, EV_ST_CLEAN,
+			scope_stack_size(&st->scope), 0, 0);
+	mark = scope_stack_pop(&st->scope);
+
+	while (entry_vector_size(&st->entry) > mark) {
+		struct TABLE_ENTRY te = entry_vector_pop(&st->entry);
+		*index_vector_at(&st->visible, te.symbol) = te.shadowed;
+	}
+}
+
+/**
+ * @brief declare symbol in current scope
+ *
+ * @param st symbol table
+ * @param sym symbol which should be declared
+ * @param n identifier-type ID
+ * @retval int 0 if symbol is already declared in current scope, 1 otherwise
+ **/
+int stdeclare(STPTR st, const SYMBOL sym, const int n) {
+	struct TABLE_ENTRY te;
+	size_t *visible;
+
+	if (sym == NO_SYMBOL)
+		return 0;
+
+	if (sym >= index_vector_size(&st->visible))
+		index_vector_resize(&st->visible, sym + 1, 0);
+
+	visible = index_vector_at(&st->visible, sym);
+
+	/* visible declaration belongs to current scope */
+	if (*visible > *scope_stack_top(&st->scope)) {
+		TRACE(st->trace, TRACE_SYMTAB, TRACE_VERBOSE, EV_ST_DECLARE, sym, n, 0);
+		return 0;
+	}
+
+	TRACE(st->trace, TRACE_SYMTAB, TRACE_VERBOSE, EV_ST_DECLARE, sym, n, 1);
+
+	te.symbol = sym;
+	te.type_ID = n;
+	te.address.depth = AST_NONE;
+	te.address.slot = AST_NONE;
+	te.value = 0;
+	te.shadowed = *visible;
+	entry_vector_push(&st->entry, te);
+	*visible = entry_vector_size(&st->entry);
+	return 1;
 }
 
 /**
  * @brief look for word in symbol table and return it
  *
- * @param symbol_table symbol table
- * @param *w word looking for
- * @retval TEPTR
+ * The entry stays valid until the next declaration.
+ *
+ * @param st symbol table
+ * @param sym symbol looking for
+ * @retval TEPTR entry or NULL if not found
  */
-TEPTR stlookup(STACK symbol_table, const char *w) {
-	TEPTR tmp = NULL;
-	
-	if ((tmp = malloc(sizeof(*tmp))) == NULL)
-		error(TABLE, __FILE__, __func__,
-		__LINE__, ERR_MEMORY);
-	
-	strcpy(tmp->word, w);
-	tmp->type_ID = 0;
-	
-	return (TEPTR) linst(symbol_table, tmp, (void *(*)(void *)) stcast,
-			(int (*)(void *, void *)) stcompare);
+TEPTR stlookup(const STPTR st, const SYMBOL sym) {
+	TEPTR te = NULL;
+	size_t i;
+
+	if (sym < index_vector_size(&st->visible)
+			&& (i = *index_vector_at(&st->visible, sym)) != 0)
+		te = entry_vector_at(&st->entry, i - 1);
+
+	TRACE(st->trace, TRACE_SYMTAB, TRACE_VERBOSE, EV_ST_LOOKUP, sym,
+			st_get_typeID(te), 0);
+	return te;
 }
 
 /**
@@ -127,3 +212,45 @@ TEPTR stlookup(STACK symbol_table, const char *w) {
 int st_get_typeID(TEPTR te) {
 	return (te == NULL) ? 0 : te->type_ID;
 }
+
+/**
+ * @brief set address of declaration
+ *
+ * @param te pointer to table entry
+ * @param address address of declaration
+ * @retval void
+ */
+void st_set_address(TEPTR te, const AST_ADDRESS address) {
+	te->address = address;
+}
+
+/**
+ * @brief get address of declaration
+ *
+ * @param te pointer to table entry
+ * @retval AST_ADDRESS
+ */
+AST_ADDRESS st_get_address(TEPTR te) {
+	return te->address;
+}
+
+/**
+ * @brief set value of constant
+ *
+ * @param te pointer to table entry
+ * @param n value
+ * @retval void
+ */
+void st_set_value(TEPTR te, const int n) {
+	te->value = n;
+}
+
+/**
+ * @brief get value of constant
+ *
+ * @param te pointer to table entry
+ * @retval int value, 0 for other declarations
+ */
+int st_get_value(TEPTR te) {
+	return te->value;
+}
@@ -19,6 +19,10 @@
 /**
  * @file token.c Library for Token Generation and Global Objects
  *
+ * The token stream is stored as parallel arrays (struct of arrays) which grow
+ * geometrically. The parser reads the token at the cursor and advances the
+ * cursor instead of releasing single token objects.
+ *
  * @ingroup lexer
  */
 
@@ -29,194 +33,414 @@
 #define TOKEN_ERR "Token"
 
 /**
- * @struct TOKEN_OBJECT
+ * @brief create span from pointer and length
  *
- * @brief stores one token, token type and line number
+ * @param *s first character
+ * @param length number of characters
+ * @retval SPAN
+ **/
+SPAN make_span(const char *s, size_t length) {
+	SPAN span;
+
+	span.start = s;
+	span.length = length;
+	return span;
+}
+
+/**
+ * @brief compare two spans
  *
+ * @param s1 first span
+ * @param s2 second span
+ * @retval int 0 if both spans contain the same characters
  **/
-struct TOKEN_OBJECT {
-	char type; /**< Token-Type */
-	size_t line; /**< code line number */
-
-	/**
-	 * @union un_element
-	 *
-	 * @brief Different Token for storing symbols.
-	 *
-	 * Except for Token: token all token have an ID which helps identifying
-	 * the type of the keyword, identifier or number.
-	 **/
-	union un_element {
-		/**
-		 * @struct st_token
-		 *
-		 * Stores single character symbols like: +, -, >, <, etc.
-		 **/
-		struct st_token {
-			char t; /**< single character */
-		} token;
-
-		/**
-		 * @struct st_number
-		 *
-		 * Stores numbers.
-		 **/
-		struct st_number {
-			int n; /**< number */
-			unsigned int ID; /**< number identifier */
-		} number;
-
-		/**
-		 * @struct st_word
-		 *
-		 * Stores keywords and identifier.
-		 **/
-		struct st_word {
-			unsigned int ID; /**< keyword / identifier identifier */
-			char w[MAX_LENGTH]; /**< keyword / identifier */
-		} word;
-	} element;
+int span_compare(const SPAN s1, const SPAN s2) {
+	if (s1.length != s2.length)
+		return 1;
+
+	return memcmp(s1.start, s2.start, s1.length);
+}
+
+/**
+ * @struct TOKEN_STREAM
+ *
+ * @brief stores tokens of the source text in parallel arrays
+ *
+ * Token i is stored at index i & (capacity - 1) of every array. When the whole
+ * source text is lexed in advance the arrays grow and never wrap around. With
+ * a refill function set the arrays form a fixed size window which the lexer
+ * refills whenever the parser has read all tokens in it.
+ *
+ * The last token is an end token (type '\0') so the parser can read at the
+ * cursor without bounds checks.
+ **/
+struct TOKEN_STREAM {
+	char *type; 		/**< Token-Type: 'n' number, 'w' word, 't' symbol, '\0' end */
+	int *ID; 			/**< keyword / identifier ID, NUM or symbol character */
+	int *value; 		/**< value of number or symbol of identifier */
+	size_t *line; 		/**< code line number */
+	size_t *offset; 	/**< offset of token in source text */
+	size_t *length; 	/**< length of token in source text */
+	size_t count; 		/**< number of tokens written */
+	size_t capacity; 	/**< number of allocated array elements, power of two */
+	size_t cursor; 		/**< number of current token */
+	const char *text; 	/**< source text spans refer to */
+	int (*refill)(void *); /**< function which writes further tokens */
+	void *refill_state; /**< argument of refill function, owned by token stream */
 };
 
 /**
- * @brief create new token
+ * @brief resize all arrays of token stream
+ *
+ * @param ts token stream
+ * @param capacity new number of elements
+ * @retval void
+ */
+static void ts_resize(TSPTR ts, size_t capacity) {
+	char *type;
+	int *ID, *value;
+	size_t *line, *offset, *length;
+
+	if ((type = pl_realloc(ts->type, capacity * sizeof(*type))) == NULL)
+		error(TOKEN_ERR, __FILE__, __func__, __LINE__, ERR_MEMORY);
+	ts->type = type;
+
+	if ((ID = pl_realloc(ts->ID, capacity * sizeof(*ID))) == NULL)
+		error(TOKEN_ERR, __FILE__, __func__, __LINE__, ERR_MEMORY);
+	ts->ID = ID;
+
+	if ((value = pl_realloc(ts->value, capacity * sizeof(*value))) == NULL)
+		error(TOKEN_ERR, __FILE__, __func__, __LINE__, ERR_MEMORY);
+	ts->value = value;
+
+	if ((line = pl_realloc(ts->line, capacity * sizeof(*line))) == NULL)
+		error(TOKEN_ERR, __FILE__, __func__, __LINE__, ERR_MEMORY);
+	ts->line = line;
+
+	if ((offset = pl_realloc(ts->offset, capacity * sizeof(*offset))) == NULL)
+		error(TOKEN_ERR, __FILE__, __func__, __LINE__, ERR_MEMORY);
+	ts->offset = offset;
+
+	if ((length = pl_realloc(ts->length, capacity * sizeof(*length))) == NULL)
+		error(TOKEN_ERR, __FILE__, __func__, __LINE__, ERR_MEMORY);
+	ts->length = length;
+
+	ts->capacity = capacity;
+}
+
+/**
+ * @brief create new empty token stream
+ *
+ * @param *text source text the tokens will refer to
+ * @param capacity initial number of elements, has to be a power of two
+ * @retval ts new token stream
+ */
+TSPTR init_token_stream(const char *text, size_t capacity) {
+	TSPTR ts = NULL;
+
+	if ((ts = pl_malloc(sizeof(*ts))) == NULL)
+		error(TOKEN_ERR, __FILE__, __func__, __LINE__, ERR_MEMORY);
+
+	ts->type = NULL;
+	ts->ID = NULL;
+	ts->value = NULL;
+	ts->line = NULL;
+	ts->offset = NULL;
+	ts->length = NULL;
+	ts->count = 0;
+	ts->capacity = 0;
+	ts->cursor = 0;
+	ts->text = text;
+	ts->refill = NULL;
+	ts->refill_state = NULL;
+
+	ts_resize(ts, capacity);
+
+	return ts;
+}
+
+/**
+ * @brief turn token stream into a window which is refilled on demand
+ *
+ * @param ts token stream
+ * @param refill function which appends tokens while ts_space() allows it and returns 0 after the end token
+ * @param *state argument of refill function, freed with the token stream
+ * @retval void
+ */
+void ts_set_refill(TSPTR ts, int (*refill)(void *), void *state) {
+	ts->refill = refill;
+	ts->refill_state = state;
+}
+
+/**
+ * @brief free token stream
+ *
+ * @param ts token stream
+ * @retval void
+ */
+void free_token_stream(TSPTR ts) {
+	if (ts == NULL)
+		return;
+
+	free(ts->type);
+	free(ts->ID);
+	free(ts->value);
+	free(ts->line);
+	free(ts->offset);
+	free(ts->length);
+	free(ts->refill_state);
+	free(ts);
+}
+
+/**
+ * @brief number of tokens which can be appended without overwriting unread tokens
  *
- * @param *t symbol, keyword, identifier or number to generate new token of
- * @param *n identifier number of keyword, identifier or number
- * @param *ln number of program code line
- * @retval *new_token_element pointer to new token
+ * @param ts token stream
+ * @retval size_t
+ */
+size_t ts_space(const TSPTR ts) {
+	return ts->capacity - (ts->count - ts->cursor);
+}
+
+/**
+ * @brief append new token
+ *
+ * Arrays grow if there is no space left. This never happens for a window,
+ * because the lexer only refills its free space.
+ *
+ * @param ts token stream
+ * @param type token type: 'n' number, 'w' keyword / identifier, 't' symbol, '\0' end
+ * @param w span of the token inside the source text
+ * @param n value of number or ID of keyword / identifier
+ * @param sym symbol of identifier or NO_SYMBOL
+ * @param ln number of program code line
+ * @retval void
  **/
-TOPTR generate_token(const char *t, const int *n, const int *ln) {
-	TOPTR new_token_element = NULL;
+void append_token(TSPTR ts, const char type, const SPAN w, const int n,
+		const SYMBOL sym, const size_t ln) {
+	size_t i;
 
-	if ((new_token_element = malloc(sizeof(*new_token_element))) == NULL)
-		error(
-		TOKEN_ERR, __FILE__, __func__, __LINE__, ERR_MEMORY);
+	if (ts_space(ts) == 0)
+		ts_resize(ts, ts->capacity * 2);
 
-	if (isdigit(*t) > 0) {
-		new_token_element->type = 'n';
-		new_token_element->element.number.n = atoi(t);
-		new_token_element->element.number.ID = *n;
-	}
+	i = ts->count & (ts->capacity - 1);
 
-	else if (isalpha(*t) > 0) {
-		new_token_element->type = 'w';
-		strcpy(new_token_element->element.word.w, t);
-		new_token_element->element.word.ID = *n;
-	}
+	switch (type) {
+		case 'n':
+			ts->ID[i] = NUM;
+			ts->value[i] = n;
+			break;
 
-	else {
-		new_token_element->type = 't';
-		new_token_element->element.token.t = *t;
+		case 'w':
+			ts->ID[i] = n;
+			ts->value[i] = (int) sym;
+			break;
+
+		case 't':
+			ts->ID[i] = (unsigned char) *w.start;
+			ts->value[i] = 0;
+			break;
+
+		default:
+			ts->ID[i] = 0;
+			ts->value[i] = 0;
+			break;
 	}
 
-	new_token_element->line = *ln;
-	return new_token_element;
+	ts->type[i] = type;
+	ts->line[i] = ln;
+	ts->offset[i] = w.start - ts->text;
+	ts->length[i] = w.length;
+	ts->count++;
 }
 
 /**
- * @brief free memory for token
+ * @brief append end token behind the last token
  *
- * @param token_element token pointer
- * @return void
+ * @param ts token stream
+ * @param ln line number of end of source text
+ * @retval void
  */
-void free_token(TOPTR token_element) {
-	free(token_element);
-	token_element = NULL;
+void end_token_stream(TSPTR ts, const size_t ln) {
+	append_token(ts, '\0', make_span(ts->text, 0), 0, NO_SYMBOL, ln);
 }
 
 /**
- * @brief remove element from qeue and free memory
+ * @brief number of tokens written
  *
- * @param token_queue queue pointer
- * @return void
+ * @param ts token stream
+ * @retval size_t
+ */
+size_t ts_count(const TSPTR ts) {
+	return ts->count;
+}
+
+/**
+ * @brief reserve n tokens behind the last token
+ *
+ * The reserved tokens count as written and have to be filled with ts_fill()
+ * before the stream is read. Only for streams which are lexed in advance.
+ *
+ * @param ts token stream
+ * @param n number of tokens
+ * @retval size_t index of first reserved token
+ */
+size_t ts_reserve(TSPTR ts, const size_t n) {
+	size_t first = ts->count, capacity = ts->capacity;
+
+	while (capacity - first < n)
+		capacity *= 2;
+
+	if (capacity != ts->capacity)
+		ts_resize(ts, capacity);
+
+	ts->count += n;
+	return first;
+}
+
+/**
+ * @brief copy all tokens of another stream into reserved tokens
+ *
+ * Used to stitch the streams of separately lexed chunks of one source text,
+ * so both streams have to refer to the same text. Different slots can be
+ * filled at the same time from different threads.
+ *
+ * @param ts token stream with reserved tokens
+ * @param first index of first reserved token to fill
+ * @param src token stream to copy, lexed in advance
+ * @param line_base number added to line numbers of src
+ * @param *symbols maps symbols of src to symbols of ts
+ * @retval void
  */
-void release_token(const QUEUE token_queue) {
-	TOPTR tmp = (TOPTR) qudel(token_queue);
+void ts_fill(TSPTR ts, const size_t first, const TSPTR src,
+		const size_t line_base, const SYMBOL *symbols) {
+	size_t i;
 
-	free_token(tmp);
-	tmp = NULL;
+	memcpy(ts->type + first, src->type, src->count * sizeof(*src->type));
+	memcpy(ts->ID + first, src->ID, src->count * sizeof(*src->ID));
+	memcpy(ts->offset + first, src->offset, src->count * sizeof(*src->offset));
+	memcpy(ts->length + first, src->length, src->count * sizeof(*src->length));
+
+	for (i = 0; i < src->count; i++) {
+		ts->value[first + i] =
+				(src->type[i] == 'w' && src->ID[i] == IDENTIFIER) ?
+						(int) symbols[src->value[i]] : src->value[i];
+		ts->line[first + i] = src->line[i] + line_base;
+	}
 }
 
 /**
+ * @brief move cursor to next token
  *
- * @brief return token
+ * Asks the lexer for further tokens if all tokens in the window are read.
+ * The cursor stops at the end token.
  *
- * @param token_queue queue pointer
- * @retval TOPTR
+ * @param ts token stream
+ * @return void
  */
-TOPTR getTOKEN(const QUEUE token_queue) {
-	return (TOPTR) head(token_queue);
+void next_token(TSPTR ts) {
+	if (ts->cursor + 1 < ts->count)
+		ts->cursor++;
+
+	else if (ts->refill != NULL) {
+		if (!(*ts->refill)(ts->refill_state))
+			ts->refill = NULL;
+
+		if (ts->cursor + 1 < ts->count)
+			ts->cursor++;
+	}
 }
 
+/**
+ * @brief index of current token in arrays
+ */
+#define CUR(ts) ((ts)->cursor & ((ts)->capacity - 1))
+
 /**
  * @brief return token type
  *
- * @param token_queue queue pointer
+ * @param ts token stream
  * @retval char
  */
-char getType(const QUEUE token_queue) {
-	return getTOKEN(token_queue)->type;
+char getType(const TSPTR ts) {
+	return ts->type[CUR(ts)];
 }
 
 /**
  * @brief return line number of token
  *
- * @param token_queue queue pointer
+ * @param ts token stream
  * @retval size_t
  */
-size_t getLine(const QUEUE token_queue) {
-	return getTOKEN(token_queue)->line;
+size_t getLine(const TSPTR ts) {
+	return ts->line[CUR(ts)];
 }
 
 /**
  * @brief return number of token: number
  *
- * @param token_queue queue pointer
+ * @param ts token stream
  * @retval int
  */
-int getNumber(const QUEUE token_queue) {
-	return getTOKEN(token_queue)->element.number.n;
+int getNumber(const TSPTR ts) {
+	return ts->value[CUR(ts)];
 }
 
 /**
  * @brief return id of token: number
  *
- * @param token_queue queue pointer
- * @retval int
+ * @param ts token stream
+ * @retval int NUM or 0 if token is no number
  */
-int getNumberID(const QUEUE token_queue) {
-	return getTOKEN(token_queue)->element.number.ID;
+int getNumberID(const TSPTR ts) {
+	return (ts->type[CUR(ts)] == 'n') ? NUM : 0;
 }
 
 /**
- * @brief return pointer to word of token: word
+ * @brief return span of word of token: word
  *
- * @param token_queue queue pointer
- * @retval char*
+ * @param ts token stream
+ * @retval SPAN empty span if token is no word
  */
-char *getWord(const QUEUE token_queue) {
-	return getTOKEN(token_queue)->element.word.w;
+SPAN getWord(const TSPTR ts) {
+	size_t i = CUR(ts);
+	return (ts->type[i] == 'w') ?
+			make_span(ts->text + ts->offset[i], ts->length[i]) :
+			make_span("", 0);
 }
 
 /**
  * @brief return id of token: word
  *
- * @param token_queue queue pointer
- * @retval int
+ * @param ts token stream
+ * @retval int keyword / identifier ID or 0 if token is no word
  */
-int getWordID(const QUEUE token_queue) {
-	return getTOKEN(token_queue)->element.word.ID;
+int getWordID(const TSPTR ts) {
+	size_t i = CUR(ts);
+	return (ts->type[i] == 'w') ? ts->ID[i] : 0;
+}
+
+/**
+ * @brief return interned symbol of token: identifier
+ *
+ * @param ts token stream
+ * @retval SYMBOL symbol or NO_SYMBOL if token is no identifier
+ */
+SYMBOL getSymbol(const TSPTR ts) {
+	size_t i = CUR(ts);
+	return (ts->type[i] == 'w' && ts->ID[i] == IDENTIFIER) ?
+			(SYMBOL) ts->value[i] : NO_SYMBOL;
 }
 
 /**
  * @brief return symbol of token: token
  *
- * @param token_queue queue pointer
- * @retval char
+ * @param ts token stream
+ * @retval char symbol or '\0' if token is no symbol
  */
-char getToken(const QUEUE token_queue) {
-	return getTOKEN(token_queue)->element.token.t;
+char getToken(const TSPTR ts) {
+	size_t i = CUR(ts);
+	return (ts->type[i] == 't') ? (char) ts->ID[i] : '\0';
 }
 
 #endif
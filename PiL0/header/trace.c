@@ -0,0 +1,490 @@
+/*
+ * PiL0 - PL0 Compiler for Raspberry PI
+ * Copyright (C) 2013  Philipp Wiesner
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file trace.c Library for recording trace events at runtime
+ *
+ * Events are 16 byte records with a category, a kind and three arguments.
+ * They are written into a ring buffer of the compilation, which keeps the
+ * newest events once it is full. After compiling the ring is written to a
+ * file together with the names of all symbols, and trace_decode() turns
+ * the file into text later, so recording never formats anything.
+ *
+ * Which categories are recorded on which level is chosen at runtime with
+ * trace_options(), e.g. "parser,ast:2" or "all:2".
+ *
+ * @defgroup trace Tracing
+ * @brief binary trace events in a ring buffer, decoded offline
+ * @ingroup global trace
+ */
+
+#include"frontend.h"
+
+#define TRACE_ERR "Trace"
+#define TRACE_RING_EVENTS 65536
+#define TRACE_MAGIC "PL0TRACE"
+#define TRACE_VERSION 1
+#define TRACE_RECORD 16
+
+/* lexer threads record concurrently */
+#if defined(__GNUC__)
+#define TRACE_NEXT(counter) __sync_fetch_and_add(&(counter), 1)
+#else
+#define TRACE_NEXT(counter) ((counter)++)
+#endif
+
+/**
+ * @struct TRACE_EVENT
+ *
+ * @brief one recorded event
+ */
+struct TRACE_EVENT {
+	unsigned char category; 	/**< one of trace_categories */
+	unsigned short event; 		/**< one of trace_events */
+	unsigned int a; 			/**< first argument */
+	unsigned int b; 			/**< second argument */
+	unsigned int c; 			/**< third argument */
+};
+
+/**
+ * @struct TRACE_RING
+ *
+ * @brief ring buffer of events with power of two size
+ */
+struct TRACE_RING {
+	struct TRACE_EVENT *event; 	/**< events */
+	unsigned long mask; 		/**< size - 1 */
+	unsigned long next; 		/**< number of events recorded so far */
+};
+
+/**
+ * @var no_trace
+ * @brief tracer which records nothing, used until a tracer is set
+ */
+const TRACER no_trace = { { TRACE_OFF }, NULL };
+
+/**
+ * @var category_name[]
+ * @brief names of trace_categories used in options and decoded traces
+ */
+static const char *category_name[TRACE_CATEGORIES] = { "lexer", "parser",
+		"ast", "symtab" };
+
+/**
+ * @var event_format[]
+ * @brief name and printf format of the arguments of every trace event
+ *
+ * Formats may leave out trailing arguments. A symbol argument is printed
+ * with its name, the symbol member tells which argument is one: 1 for a,
+ * 2 for b, 0 for none.
+ */
+static const struct {
+	const char *name; 			/**< name of event */
+	const char *format; 		/**< format of arguments a, b, c */
+	int symbol; 				/**< argument holding a symbol */
+} event_format[TRACE_EVENTS] = {
+	{ "token", "type %c value %u line %u", 0 },			/* EV_LEX_TOKEN */
+	{ "chunk", "%u: %u tokens %u lines", 0 },			/* EV_LEX_CHUNK */
+	{ "end", "%u tokens %u lines", 0 },				/* EV_LEX_END */
+	{ "token", "type %c value %u line %u", 0 },			/* EV_PARSE_TOKEN */
+	{ "expand", "production %u depth %u line %u", 0 },	/* EV_PARSE_EXPAND */
+	{ "error", "message %u line %u parser.c:%u", 0 },	/* EV_PARSE_ERROR */
+	{ "procedure", "%u function %u main %u", 0 },		/* EV_AST_PROCEDURE */
+	{ "statement", "%u statement %u", 0 },			/* EV_AST_STATEMENT */
+	{ "care", "%u identifier %u", 2 },				/* EV_AST_CARE */
+	{ "print", "%u expression %u", 0 },				/* EV_AST_PRINT */
+	{ "jumpbac", "%u condition %u statement %u", 0 },	/* EV_AST_JUMPBAC */
+	{ "jumpfor", "%u condition %u statement %u", 0 },	/* EV_AST_JUMPFOR */
+	{ "assignment", "%u expression %u", 0 },		/* EV_AST_ASSIGNMENT */
+	{ "list", "%u item %u", 0 },					/* EV_AST_LIST */
+	{ "number", "%u value %u", 0 },					/* EV_AST_NUMBER */
+	{ "identifier", "%u identifier %u", 2 },		/* EV_AST_IDENTIFIER */
+	{ "arithmetic", "%u left %u right %u", 0 },			/* EV_AST_ARITHMETIC */
+	{ "relation", "%u left %u right %u", 0 },			/* EV_AST_RELATION */
+	{ "unary", "%u branch %u", 0 },					/* EV_AST_UNARY */
+	{ "odd", "%u branch %u", 0 },					/* EV_AST_ODD */
+	{ "enter", "scope %u", 0 },					/* EV_ST_ENTER */
+	{ "clean", "scope %u", 0 },					/* EV_ST_CLEAN */
+	{ "declare", "%u type %u new %u", 1 },				/* EV_ST_DECLARE */
+	{ "lookup", "%u type %u", 1 }					/* EV_ST_LOOKUP */
+};
+
+/**
+ * @brief create ring buffer for the categories which are traced
+ *
+ * Nothing is allocated if no category is traced.
+ *
+ * @param *tr tracer
+ * @param *threshold one of trace_levels for every category
+ * @param events size of ring buffer, rounded up to a power of two, 0 for default
+ * @retval void
+ */
+void init_tracer(TRACER *tr, const unsigned char *threshold,
+		unsigned long events) {
+	struct TRACE_RING *ring = NULL;
+	unsigned long size = 1;
+	int i, traced = 0;
+
+	*tr = no_trace;
+
+	for (i = 0; i < TRACE_CATEGORIES; i++)
+		traced |= threshold[i];
+
+	if (!traced)
+		return;
+
+	if (events == 0)
+		events = TRACE_RING_EVENTS;
+
+	while (size < events)
+		size *= 2;
+
+	if ((ring = pl_malloc(sizeof(*ring))) == NULL
+			|| (ring->event = pl_malloc(size * sizeof(*ring->event))) == NULL)
+		error(TRACE_ERR, __FILE__, __func__, __LINE__, ERR_MEMORY);
+
+	ring->mask = size - 1;
+	ring->next = 0;
+
+	for (i = 0; i < TRACE_CATEGORIES; i++)
+		tr->threshold[i] = threshold[i];
+
+	tr->ring = ring;
+}
+
+/**
+ * @brief free ring buffer and stop tracing
+ *
+ * @param *tr tracer
+ * @retval void
+ */
+void free_tracer(TRACER *tr) {
+	if (tr->ring != NULL) {
+		free(tr->ring->event);
+		free(tr->ring);
+	}
+
+	*tr = no_trace;
+}
+
+/**
+ * @brief record event, called by TRACE() only if the category is traced
+ *
+ * @param *tr tracer
+ * @param category one of trace_categories
+ * @param event one of trace_events
+ * @param a first argument
+ * @param b second argument
+ * @param c third argument
+ * @retval void
+ */
+void trace_emit(const TRACER *tr, const int category, const int event,
+		const unsigned int a, const unsigned int b, const unsigned int c) {
+	struct TRACE_RING *ring = tr->ring;
+	struct TRACE_EVENT *e = &ring->event[TRACE_NEXT(ring->next) & ring->mask];
+
+	e->category = (unsigned char) category;
+	e->event = (unsigned short) event;
+	e->a = a;
+	e->b = b;
+	e->c = c;
+}
+
+/**
+ * @brief write 32 bit number little endian
+ *
+ * @param *p destination
+ * @param n number
+ * @retval void
+ */
+static void put_u32(unsigned char *p, unsigned long n) {
+	p[0] = (unsigned char) n;
+	p[1] = (unsigned char) (n >> 8);
+	p[2] = (unsigned char) (n >> 16);
+	p[3] = (unsigned char) (n >> 24);
+}
+
+/**
+ * @brief read 32 bit number little endian
+ *
+ * @param *p source
+ * @retval unsigned long number
+ */
+static unsigned long get_u32(const unsigned char *p) {
+	return p[0] | (unsigned long) p[1] << 8 | (unsigned long) p[2] << 16
+			| (unsigned long) p[3] << 24;
+}
+
+/**
+ * @brief write recorded events and symbol names to binary trace file
+ *
+ * The file starts with TRACE_MAGIC, version, number of stored and of
+ * recorded events and number of symbols, all 32 bit little endian. Events
+ * follow oldest first, each as category, unused byte, 16 bit kind and the
+ * three arguments, then every symbol name as length and characters.
+ *
+ * @param *tr tracer
+ * @param out binary stream
+ * @param ip intern pool of symbol names or NULL
+ * @retval int 1 if written, 0 if nothing was traced or writing failed
+ */
+int trace_write(const TRACER *tr, FILE *out, const IPPTR ip) {
+	const struct TRACE_RING *ring = tr->ring;
+	unsigned char record[TRACE_RECORD];
+	unsigned long i, first, stored, symbols = (ip != NULL) ?
+			(unsigned long) size_intern_pool(ip) : 0;
+
+	if (ring == NULL)
+		return 0;
+
+	stored = (ring->next > ring->mask) ? ring->mask + 1 : ring->next;
+	first = ring->next - stored;
+
+	memcpy(record, TRACE_MAGIC, 8);
+	put_u32(record + 8, TRACE_VERSION);
+	put_u32(record + 12, stored);
+	fwrite(record, 1, TRACE_RECORD, out);
+	put_u32(record, ring->next);
+	put_u32(record + 4, symbols);
+	fwrite(record, 1, 8, out);
+
+	for (i = first; i < ring->next; i++) {
+		const struct TRACE_EVENT *e = &ring->event[i & ring->mask];
+
+		record[0] = e->category;
+		record[1] = 0;
+		record[2] = (unsigned char) e->event;
+		record[3] = (unsigned char) (e->event >> 8);
+		put_u32(record + 4, e->a);
+		put_u32(record + 8, e->b);
+		put_u32(record + 12, e->c);
+		fwrite(record, 1, TRACE_RECORD, out);
+	}
+
+	for (i = 0; i < symbols; i++) {
+		SPAN w = symbol_name(ip, (SYMBOL) i);
+
+		put_u32(record, w.length);
+		fwrite(record, 1, 4, out);
+		fwrite(w.start, 1, w.length, out);
+	}
+
+	return !ferror(out);
+}
+
+/**
+ * @brief bytes from current position to end of file
+ *
+ * @param in binary stream
+ * @retval long bytes or -1 if the stream cannot seek
+ */
+static long bytes_left(FILE *in) {
+	long here = ftell(in), end;
+
+	if (here < 0 || fseek(in, 0, SEEK_END) != 0)
+		return -1;
+
+	end = ftell(in);
+
+	if (fseek(in, here, SEEK_SET) != 0 || end < here)
+		return -1;
+
+	return end - here;
+}
+
+/**
+ * @brief print one event of a binary trace file as text line
+ *
+ * @param out text stream
+ * @param *e event record
+ * @param **name symbol names, NULL for missing ones
+ * @param symbols number of symbol names
+ * @retval void
+ */
+static void print_event(FILE *out, const unsigned char *e, char **name,
+		const unsigned long symbols) {
+	unsigned int category = e[0], event = e[2] | e[3] << 8;
+	unsigned long arg[3];
+	int symbol;
+
+	if (category >= TRACE_CATEGORIES || event >= TRACE_EVENTS)
+		return;
+
+	arg[0] = get_u32(e + 4);
+	arg[1] = get_u32(e + 8);
+	arg[2] = get_u32(e + 12);
+
+	fprintf(out, "%-7s %-11s ", category_name[category],
+			event_format[event].name);
+	symbol = event_format[event].symbol;
+
+	/* characters are printed as such, identifiers with their name */
+	if ((event == EV_LEX_TOKEN || event == EV_PARSE_TOKEN) && arg[0] == 't')
+		fprintf(out, "type t value '%c' line %u", (char) arg[1],
+				(unsigned int) arg[2]);
+	else
+		fprintf(out, event_format[event].format, (unsigned int) arg[0],
+				(unsigned int) arg[1], (unsigned int) arg[2]);
+
+	if (event == EV_PARSE_TOKEN && arg[0] == 'i')
+		symbol = 2;
+
+	if (symbol > 0) {
+		unsigned long s = arg[symbol - 1];
+
+		if (s < symbols && name[s] != NULL)
+			fprintf(out, " (%s)", name[s]);
+	}
+
+	fputc('\n', out);
+}
+
+/**
+ * @brief print binary trace file as text, one line per event
+ *
+ * The counts of the header are checked against the length of the file
+ * before anything is allocated, so a damaged or truncated file is rejected
+ * instead of being printed in part. Internal errors are reported to the
+ * diagnostic sink and end decoding, not the program.
+ *
+ * @param in binary stream written by trace_write(), has to be seekable
+ * @param out text stream
+ * @retval int 1 on success, 0 if the file is no trace or truncated
+ */
+int trace_decode(FILE *in, FILE *out) {
+	unsigned char record[TRACE_RECORD], * volatile events = NULL;
+	char ** volatile name = NULL;
+	unsigned long i, stored, recorded, symbols, left;
+	volatile int ok = 0;
+	DIAG_FRAME frame;
+	long length;
+	int status;
+
+	if (fread(record, 1, TRACE_RECORD, in) != TRACE_RECORD
+			|| memcmp(record, TRACE_MAGIC, 8) != 0
+			|| get_u32(record + 8) != TRACE_VERSION)
+		return 0;
+
+	stored = get_u32(record + 12);
+
+	if (fread(record, 1, 8, in) != 8 || (length = bytes_left(in)) < 0)
+		return 0;
+
+	recorded = get_u32(record);
+	symbols = get_u32(record + 4);
+	left = (unsigned long) length;
+
+	/* every event takes a record and every name at least its length */
+	if (recorded < stored || stored > left / TRACE_RECORD
+			|| symbols > (left - stored * TRACE_RECORD) / 4)
+		return 0;
+
+	left -= stored * TRACE_RECORD + symbols * 4;
+
+	/* release what was read before an error returns */
+	diag_push(&frame, NULL, NULL);
+
+	if ((status = setjmp(frame.unwind)) == 0) {
+		if ((events = pl_malloc(stored * TRACE_RECORD + 1)) == NULL
+				|| (name = pl_calloc(symbols + 1, sizeof(*name))) == NULL)
+			error(TRACE_ERR, __FILE__, __func__, __LINE__, ERR_MEMORY);
+
+		ok = fread(events, TRACE_RECORD, stored, in) == stored;
+
+		/* characters of the names have to fit into what is left */
+		for (i = 0; ok && i < symbols; i++) {
+			unsigned long n;
+
+			if (fread(record, 1, 4, in) != 4
+					|| (n = get_u32(record)) > left) {
+				ok = 0;
+				break;
+			}
+
+			left -= n;
+
+			if ((name[i] = pl_malloc(n + 1)) == NULL)
+				error(TRACE_ERR, __FILE__, __func__, __LINE__, ERR_MEMORY);
+
+			ok = fread(name[i], 1, n, in) == n;
+			name[i][n] = '\0';
+		}
+
+		if (ok && recorded > stored)
+			fprintf(out, "%lu older events were overwritten\n",
+					recorded - stored);
+
+		for (i = 0; ok && i < stored; i++)
+			print_event(out, events + i * TRACE_RECORD, name, symbols);
+	}
+
+	diag_pop(&frame);
+
+	for (i = 0; name != NULL && i < symbols; i++)
+		free(name[i]);
+
+	free(name);
+	free(events);
+	return status == COMPILE_OK && ok;
+}
+
+/**
+ * @brief set trace levels from a list of categories
+ *
+ * The list is separated by commas, every entry is a category name or "all",
+ * optionally followed by ':' and a level, which defaults to TRACE_INFO.
+ *
+ * @param *options compile options
+ * @param *spec list, e.g. "parser,ast:2"
+ * @retval int 1 if list is valid, 0 otherwise
+ */
+int trace_options(struct compile_options *options, const char *spec) {
+	while (*spec != '\0') {
+		size_t length = strcspn(spec, ",:");
+		int i, level = TRACE_INFO, found = 0;
+
+		if (spec[length] == ':') {
+			level = spec[length + 1] - '0';
+
+			if (level < TRACE_OFF || level > TRACE_VERBOSE
+					|| (spec[length + 2] != ',' && spec[length + 2] != '\0'))
+				return 0;
+		}
+
+		for (i = 0; i < TRACE_CATEGORIES; i++)
+			if ((length == 3 && strncmp(spec, "all", 3) == 0)
+					|| (strlen(category_name[i]) == length
+							&& strncmp(spec, category_name[i], length) == 0)) {
+				options->trace[i] = (unsigned char) level;
+				found = 1;
+			}
+
+		if (!found)
+			return 0;
+
+		spec += length;
+
+		if (*spec == ':')
+			spec += 2;
+
+		if (*spec == ',')
+			spec++;
+	}
+
+	return 1;
+}
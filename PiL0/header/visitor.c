@@ -0,0 +1,175 @@
+/*
+ * PiL0 - PL0 Compiler for Raspberry PI
+ * Copyright (C) 2013  Philipp Wiesner
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file visitor.c Library for walking an abstract syntax tree
+ *
+ * A walker visits the knots of an AST depth first and calls the pre callback
+ * of a visitor before and the post callback after the branches of each knot.
+ * Instead of recursion the walker keeps one frame per open knot on its own
+ * stack, which only grows with the nesting depth of the program and is kept
+ * from walk to walk, so a walker which is used again does not allocate.
+ *
+ *     AWPTR w = init_walker(0);
+ *     AST_VISITOR v = { count_knot, NULL, &count };
+ *
+ *     walk_ast(w, ast, AST_CLASS_BLOCK, 0, &v);
+ *
+ * walks the whole program, the root block has index 0.
+ *
+ * @defgroup visitor Visitor
+ * @brief depth first walk over the AST with pre and post order callbacks
+ * @ingroup ast visitor
+ */
+
+#include"frontend.h"
+#include"containers.h"
+
+#define __WALKER__ "AST Walker"
+
+/**
+ * @struct VISIT_FRAME
+ *
+ * @brief knot whose branches are being walked
+ */
+struct VISIT_FRAME {
+	unsigned char class; 		/**< one of ast_classes */
+	unsigned int ref; 			/**< index of knot */
+	unsigned int next; 			/**< number of next branch */
+};
+
+DEFINE_STACK(frame_stack, struct VISIT_FRAME)
+
+/**
+ * @struct AST_WALKER
+ *
+ * @brief stack of open knots, reused by every walk
+ */
+struct AST_WALKER {
+	struct frame_stack frame; 	/**< open knots, innermost on top */
+};
+
+/**
+ * @brief create new walker
+ *
+ * @param depth nesting depth to reserve frames for, 0 for default
+ * @retval AWPTR new walker
+ */
+AWPTR init_walker(const size_t depth) {
+	AWPTR w = NULL;
+
+	if ((w = pl_malloc(sizeof(*w))) == NULL)
+		error(__WALKER__, __FILE__, __func__, __LINE__, ERR_MEMORY);
+
+	frame_stack_init(&w->frame);
+	frame_stack_reserve(&w->frame, depth);
+	return w;
+}
+
+/**
+ * @brief free walker
+ *
+ * @param w walker
+ * @retval void
+ */
+void free_walker(AWPTR w) {
+	if (w == NULL)
+		return;
+
+	frame_stack_free(&w->frame);
+	free(w);
+}
+
+/**
+ * @brief depth of knot passed to a callback, 0 for the knot the walk started at
+ *
+ * @param w walker
+ * @retval size_t depth
+ */
+size_t walker_depth(const AWPTR w) {
+	return frame_stack_size(&w->frame);
+}
+
+/**
+ * @brief call pre callback and open knot
+ *
+ * A pruned knot is opened without branches, so its post callback is called
+ * next.
+ *
+ * @param w walker
+ * @param ast AST
+ * @param class one of ast_classes
+ * @param ref knot
+ * @param *v visitor
+ * @retval int VISIT_STOP if walk has to end
+ */
+static int enter(AWPTR w, const ASTPTR ast, const int class,
+		const unsigned int ref, const AST_VISITOR *v) {
+	struct VISIT_FRAME frame;
+	int result = (v->pre != NULL) ? v->pre(v->data, ast, class, ref) :
+			VISIT_CONTINUE;
+
+	if (result == VISIT_STOP)
+		return VISIT_STOP;
+
+	frame.class = (unsigned char) class;
+	frame.ref = ref;
+	frame.next = (result == VISIT_PRUNE) ? AST_NONE : 0;
+	frame_stack_push(&w->frame, frame);
+	return VISIT_CONTINUE;
+}
+
+/**
+ * @brief walk knot and all its branches depth first
+ *
+ * @param w walker
+ * @param ast AST
+ * @param class one of ast_classes, class of first knot
+ * @param ref first knot
+ * @param *v visitor
+ * @retval int VISIT_STOP if a callback ended the walk, else VISIT_CONTINUE
+ */
+int walk_ast(AWPTR w, const ASTPTR ast, const int class,
+		const unsigned int ref, const AST_VISITOR *v) {
+	frame_stack_truncate(&w->frame, 0);
+
+	if (enter(w, ast, class, ref, v) == VISIT_STOP)
+		return VISIT_STOP;
+
+	while (!frame_stack_empty(&w->frame)) {
+		struct VISIT_FRAME *top = frame_stack_top(&w->frame), frame;
+		unsigned int child;
+		int child_class = (top->next == AST_NONE) ? -1 :
+				ast_child(ast, top->class, top->ref, top->next++, &child);
+
+		if (child_class >= 0) {
+			if (enter(w, ast, child_class, child, v) == VISIT_STOP)
+				return VISIT_STOP;
+
+			continue;
+		}
+
+		frame = frame_stack_pop(&w->frame);
+
+		if (v->post != NULL
+				&& v->post(v->data, ast, frame.class, frame.ref) == VISIT_STOP)
+			return VISIT_STOP;
+	}
+
+	return VISIT_CONTINUE;
+}
@@ -0,0 +1,578 @@
+/*
+ * PiL0 - PL0 Compiler for Raspberry PI
+ * Copyright (C) 2013  Philipp Wiesner
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file vm.c Library for running register bytecode
+ *
+ * Frames lie one after the other in one array of cells; a frame is the VAR
+ * and CONST cells of its scope followed by the temporaries. The display
+ * holds the newest frame of every nesting depth, which is the static link
+ * chain of the running procedure: a CALL of a procedure at depth d replaces
+ * display[d] and RET restores it. So LOAD and STORE reach any enclosing
+ * scope in one step.
+ *
+ * With GCC the handlers are reached by computed goto: before running, every
+ * opcode word is replaced by the address of its handler (direct threading),
+ * and each handler jumps to the next one itself. Other compilers, or
+ * building with -DPL_VM_SWITCH, use one switch in a loop.
+ *
+ * Building with -DPL_VM_PROFILE counts every executed instruction by the
+ * opcode of the one before and prints the most frequent pairs to standard
+ * error after each run; superinstructions are chosen from these counts.
+ *
+ * @ingroup bytecode
+ */
+
+#include"bytecode.h"
+#include<limits.h>
+
+#if defined(__GNUC__) && !defined(PL_VM_SWITCH)
+#define VM_THREADED
+#endif
+
+#define __VM__ "VM"
+
+/**
+ * @def VM_MAX_CALLS
+ * @brief nested procedure calls before a program is stopped, as in interpret()
+ */
+#define VM_MAX_CALLS (1UL << 22)
+
+/**
+ * @def VM_STACK_INIT
+ * @brief cells of the frame array before it grows the first time
+ */
+#define VM_STACK_INIT 4096
+
+#ifdef PL_VM_PROFILE
+/* pairs listed by vm_profile() */
+#define VM_PROFILE_PAIRS 24
+
+/**
+ * @var unsigned long vm_pairs[][]
+ * @brief executed instructions by opcode of the instruction before, row
+ * OPCODES counts the first instruction of a run
+ **/
+static unsigned long vm_pairs[OPCODES + 1][OPCODES];
+
+/**
+ * @var int vm_last
+ * @brief opcode executed last
+ **/
+static int vm_last = OPCODES;
+
+/**
+ * @brief count instruction
+ *
+ * @param op opcode
+ * @retval int op
+ */
+static int vm_count(const int op) {
+	vm_pairs[vm_last][op]++;
+	vm_last = op;
+	return op;
+}
+
+/**
+ * @brief print most frequent pairs and number of executed instructions
+ *
+ * @param out stream
+ * @retval void
+ */
+static void vm_profile(FILE *out) {
+	unsigned long total = 0, best, shown = ULONG_MAX;
+	int i, j, n;
+
+	for (i = 0; i <= OPCODES; i++)
+		for (j = 0; j < OPCODES; j++)
+			total += vm_pairs[i][j];
+
+	fprintf(out, "%lu instructions\n", total);
+
+	/* pairs of equal count are printed together, so never twice */
+	for (n = 0; n < VM_PROFILE_PAIRS; ) {
+		best = 0;
+
+		for (i = 0; i < OPCODES; i++)
+			for (j = 0; j < OPCODES; j++)
+				if (vm_pairs[i][j] > best && vm_pairs[i][j] < shown)
+					best = vm_pairs[i][j];
+
+		if (best == 0)
+			break;
+
+		for (i = 0; i < OPCODES; i++)
+			for (j = 0; j < OPCODES; j++)
+				if (vm_pairs[i][j] == best) {
+					fprintf(out, "%12lu %5.1f%%  %-8s %s\n", best,
+							100.0 * best / total, bc_names[i], bc_names[j]);
+					n++;
+				}
+
+		shown = best;
+	}
+
+	vm_last = OPCODES;
+}
+#define VM_COUNT(op) vm_count(op)
+#else
+#define VM_COUNT(op) (op)
+#endif
+
+#ifdef VM_THREADED
+/**
+ * @union VM_WORD
+ *
+ * @brief word of threaded code: address of handler or operand
+ */
+typedef union {
+	const void *handler; 	/**< opcode word replaced by its handler */
+	int operand; 			/**< operand word */
+} VM_WORD;
+
+#define ARG(i) (pc[i].operand)
+#define VM_LABEL(name, operands, registers) __extension__ &&L_##name,
+#define VM_CASE(name) L_##name:
+#ifdef PL_VM_PROFILE
+#define VM_DISPATCH() __extension__ ({ \
+	vm_count(vm->bc->code.data[pc - code]); goto *pc->handler; })
+#else
+#define VM_DISPATCH() __extension__ ({ goto *pc->handler; })
+#endif
+#else
+typedef int VM_WORD;
+
+#define ARG(i) (pc[i])
+#define VM_CASE(name) case (OP_##name):
+#define VM_DISPATCH() continue
+#endif
+
+/* register operand of the running frame */
+#define R(i) fp[ARG(i)]
+
+/* go on with the instruction after one with n operands */
+#define VM_NEXT(n) { pc += (n) + 1; VM_DISPATCH(); }
+
+/* go on at word index t */
+#define VM_JUMP(t) { pc = code + (t); VM_DISPATCH(); }
+
+/* wrap around like two's complement, as fold_arithmetic() */
+#define VM_WRAP(a, op, b) ((int) ((unsigned int) (a) op (unsigned int) (b)))
+
+/**
+ * @struct VM_CALL
+ *
+ * @brief what RET restores
+ *
+ * Word and cell indices instead of pointers keep records small, deep
+ * recursion is bound by the memory they take, and need no moving when the
+ * frames grow.
+ */
+struct VM_CALL {
+	unsigned int pc; 		/**< instruction after CALL */
+	unsigned int fp; 		/**< frame of caller */
+	unsigned int saved; 	/**< display entry replaced by callee */
+	unsigned int depth; 	/**< static nesting depth of callee */
+	unsigned int frame; 	/**< size of frame of caller */
+};
+
+/**
+ * @struct VM
+ *
+ * @brief state of a running program
+ *
+ * The running frame and the top of the call stack live in locals of
+ * vm_execute(), which passes them when frames or calls have to move.
+ */
+struct VM {
+	BCPTR bc; 					/**< program */
+	FILE *in; 					/**< READ takes numbers from here */
+	FILE *out; 					/**< PRINT writes numbers to here */
+	VM_WORD *code; 				/**< instructions, threaded copy if owned */
+	int *stack; 				/**< frames */
+	int *stack_end; 			/**< first cell after stack */
+	int **display; 				/**< newest frame of every nesting depth */
+	struct VM_CALL *calls; 		/**< active procedures, oldest first */
+	struct VM_CALL *calls_end; 	/**< first record after calls */
+};
+
+/**
+ * @brief report error of running program
+ *
+ * @param *vm VM
+ * @param pc failing instruction
+ * @param code one of run_err_codes
+ * @retval void
+ */
+static void vm_fail(const struct VM *vm, const VM_WORD *pc, const int code) {
+	runError((int) bc_line(vm->bc, (size_t) (pc - vm->code)),
+			(enum run_err_codes) code);
+}
+
+/**
+ * @brief make room for cells, moving frames
+ *
+ * The frames are copied to a larger array, the display is moved along while
+ * the old array is still valid.
+ *
+ * @param *vm VM
+ * @param fp running frame
+ * @param live cells of running frame, copied along with older frames
+ * @param need cells needed from fp on
+ * @retval int* running frame after moving
+ */
+static int *grow(struct VM *vm, int *fp, const size_t live,
+		const size_t need) {
+	size_t used = (size_t) (fp - vm->stack) + need;
+	size_t capacity = (size_t) (vm->stack_end - vm->stack);
+	unsigned int d;
+	int *stack;
+
+	while (capacity < used)
+		capacity *= 2;
+
+	if ((stack = pl_malloc(capacity * sizeof(int))) == NULL)
+		ERROR_EXCEPT(__VM__, ERR_MEMORY);
+
+	memcpy(stack, vm->stack, ((size_t) (fp - vm->stack) + live) * sizeof(int));
+
+	for (d = 0; d <= vm->bc->depth; d++)
+		vm->display[d] = stack + (vm->display[d] - vm->stack);
+
+	fp = stack + (fp - vm->stack);
+	free(vm->stack);
+	vm->stack = stack;
+	vm->stack_end = stack + capacity;
+	return fp;
+}
+
+/**
+ * @brief make room for call records
+ *
+ * @param *vm VM
+ * @param *top first unused call record, which is calls_end
+ * @param *pc CALL instruction, for reporting too many calls
+ * @retval struct VM_CALL* first unused call record after moving
+ */
+static struct VM_CALL *more_calls(struct VM *vm, struct VM_CALL *top,
+		const VM_WORD *pc) {
+	size_t used = (size_t) (top - vm->calls);
+	size_t capacity = (used > 0) ? 2 * used : VM_STACK_INIT;
+	struct VM_CALL *calls;
+
+	if (used >= VM_MAX_CALLS)
+		vm_fail(vm, pc, RUN_CALL_DEPTH);
+
+	if (capacity > VM_MAX_CALLS)
+		capacity = VM_MAX_CALLS;
+
+	if ((calls = pl_realloc(vm->calls, capacity * sizeof(*calls))) == NULL)
+		ERROR_EXCEPT(__VM__, ERR_MEMORY);
+
+	vm->calls = calls;
+	vm->calls_end = calls + capacity;
+	return calls + used;
+}
+
+/**
+ * @brief run instructions from entry of main program until HALT
+ *
+ * @param *vm VM with main frame on the stack
+ * @retval void
+ */
+static void vm_execute(struct VM *vm) {
+	const struct BC_PROCEDURE *procedure = vm->bc->procedure.data;
+	const int *image = vm->bc->image.data;
+	int **display = vm->display;
+	const VM_WORD *code, *pc;
+	struct VM_CALL *top = vm->calls;
+	int *fp = vm->stack;
+	unsigned int frame = procedure[0].frame;
+	int a, b;
+
+#ifdef VM_THREADED
+	static const void *const handler[OPCODES] = { BC_OPCODES(VM_LABEL) };
+	size_t i, n = word_vector_size(&vm->bc->code);
+
+	if ((vm->code = pl_malloc((n > 0 ? n : 1) * sizeof(VM_WORD))) == NULL)
+		ERROR_EXCEPT(__VM__, ERR_MEMORY);
+
+	/* opcode words become handlers, operands are copied */
+	for (i = 0; i < n; i += 1 + bc_operands[vm->bc->code.data[i]]) {
+		unsigned int j;
+
+		vm->code[i].handler = handler[vm->bc->code.data[i]];
+
+		for (j = 1; j <= bc_operands[vm->bc->code.data[i]]; j++)
+			vm->code[i + j].operand = vm->bc->code.data[i + j];
+	}
+#endif
+
+	code = vm->code;
+	pc = code + procedure[0].entry;
+
+#ifdef VM_THREADED
+	VM_DISPATCH();
+#else
+	for (;;)
+		switch (VM_COUNT(*pc)) {
+#endif
+
+	VM_CASE(MOVE)
+		R(1) = R(2);
+		VM_NEXT(2)
+
+	VM_CASE(LOAD)
+		R(1) = display[ARG(2)][ARG(3)];
+		VM_NEXT(3)
+
+	VM_CASE(STORE)
+		display[ARG(1)][ARG(2)] = R(3);
+		VM_NEXT(3)
+
+	VM_CASE(ADD)
+		R(1) = VM_WRAP(R(2), +, R(3));
+		VM_NEXT(3)
+
+	VM_CASE(SUB)
+		R(1) = VM_WRAP(R(2), -, R(3));
+		VM_NEXT(3)
+
+	VM_CASE(MUL)
+		R(1) = VM_WRAP(R(2), *, R(3));
+		VM_NEXT(3)
+
+	VM_CASE(DIV)
+		a = R(2);
+		b = R(3);
+
+		if (b == 0 || (b == -1 && a == INT_MIN))
+			vm_fail(vm, pc, (b == 0) ? RUN_DIV_ZERO : RUN_DIV_OVERFLOW);
+
+		R(1) = a / b;
+		VM_NEXT(3)
+
+	VM_CASE(NEG)
+		R(1) = VM_WRAP(0, -, R(2));
+		VM_NEXT(2)
+
+	VM_CASE(ODD)
+		R(1) = R(2) % 2 != 0;
+		VM_NEXT(2)
+
+	VM_CASE(EQ)
+		R(1) = R(2) == R(3);
+		VM_NEXT(3)
+
+	VM_CASE(NE)
+		R(1) = R(2) != R(3);
+		VM_NEXT(3)
+
+	VM_CASE(LT)
+		R(1) = R(2) < R(3);
+		VM_NEXT(3)
+
+	VM_CASE(LE)
+		R(1) = R(2) <= R(3);
+		VM_NEXT(3)
+
+	VM_CASE(GT)
+		R(1) = R(2) > R(3);
+		VM_NEXT(3)
+
+	VM_CASE(GE)
+		R(1) = R(2) >= R(3);
+		VM_NEXT(3)
+
+	VM_CASE(JUMP)
+		VM_JUMP(ARG(1))
+
+	VM_CASE(JUMPF)
+		if (R(1) == 0)
+			VM_JUMP(ARG(2))
+
+		VM_NEXT(2)
+
+	VM_CASE(JUMPT)
+		if (R(1) != 0)
+			VM_JUMP(ARG(2))
+
+		VM_NEXT(2)
+
+	VM_CASE(CALL) {
+		const struct BC_PROCEDURE *callee = &procedure[ARG(1)];
+		const int *init = image + callee->image;
+		unsigned int cell;
+
+		if (top == vm->calls_end)
+			top = more_calls(vm, top, pc);
+
+		if (fp + frame + callee->frame > vm->stack_end)
+			fp = grow(vm, fp, frame, frame + callee->frame);
+
+		top->pc = (unsigned int) (pc - code) + 2;
+		top->fp = (unsigned int) (fp - vm->stack);
+		top->saved = (unsigned int) (display[callee->depth] - vm->stack);
+		top->depth = callee->depth;
+		top->frame = frame;
+		top++;
+
+		fp += frame;
+
+		for (cell = 0; cell < callee->frame; cell++)
+			fp[cell] = init[cell];
+
+		display[callee->depth] = fp;
+		frame = callee->frame;
+		VM_JUMP(callee->entry)
+	}
+
+	VM_CASE(RET)
+		top--;
+		display[top->depth] = vm->stack + top->saved;
+		fp = vm->stack + top->fp;
+		frame = top->frame;
+		pc = code + top->pc;
+		VM_DISPATCH();
+
+	VM_CASE(READ)
+		if (fscanf(vm->in, "%d", &R(1)) != 1)
+			vm_fail(vm, pc, RUN_NO_INPUT);
+
+		VM_NEXT(1)
+
+	VM_CASE(PRINT)
+		fprintf(vm->out, "%d\n", R(1));
+		VM_NEXT(1)
+
+	VM_CASE(HALT)
+		return;
+
+	VM_CASE(JEQ)
+		if (R(1) == R(2))
+			VM_JUMP(ARG(3))
+
+		VM_NEXT(3)
+
+	VM_CASE(JNE)
+		if (R(1) != R(2))
+			VM_JUMP(ARG(3))
+
+		VM_NEXT(3)
+
+	VM_CASE(JLT)
+		if (R(1) < R(2))
+			VM_JUMP(ARG(3))
+
+		VM_NEXT(3)
+
+	VM_CASE(JLE)
+		if (R(1) <= R(2))
+			VM_JUMP(ARG(3))
+
+		VM_NEXT(3)
+
+	VM_CASE(JGT)
+		if (R(1) > R(2))
+			VM_JUMP(ARG(3))
+
+		VM_NEXT(3)
+
+	VM_CASE(JGE)
+		if (R(1) >= R(2))
+			VM_JUMP(ARG(3))
+
+		VM_NEXT(3)
+
+	VM_CASE(ADDS) {
+		int *cell = &display[ARG(1)][ARG(2)];
+
+		*cell = VM_WRAP(*cell, +, R(3));
+		VM_NEXT(3)
+	}
+
+#ifndef VM_THREADED
+		}
+#endif
+}
+
+/**
+ * @brief run emitted bytecode
+ *
+ * READ and PRINT use the input and output of the compile options like
+ * interpret(), which prints the same numbers and reports the same errors.
+ *
+ * @param code pointer to source code object
+ * @retval void
+ */
+void vm_run(SOURCECODE code) {
+	const struct compile_options *options = sc_get_options(code);
+	struct VM vm;
+	DIAG_FRAME frame;
+	int status;
+
+	vm.bc = sc_get_bc(code);
+	vm.in = (options->input != NULL) ? options->input : stdin;
+	vm.out = (options->output != NULL) ? options->output : stdout;
+	vm.code = NULL;
+	vm.stack = vm.stack_end = NULL;
+	vm.display = NULL;
+	vm.calls = vm.calls_end = NULL;
+
+	/* release the frames before an error unwinds further */
+	diag_push(&frame, NULL, NULL);
+
+	if ((status = setjmp(frame.unwind)) == 0
+			&& !procedure_vector_empty(&vm.bc->procedure)) {
+		const struct BC_PROCEDURE *main = procedure_vector_at(&vm.bc->procedure, 0);
+		size_t capacity = (main->frame > VM_STACK_INIT) ? main->frame : VM_STACK_INIT;
+		unsigned int d;
+
+		vm.stack = pl_malloc(capacity * sizeof(int));
+		vm.display = pl_malloc((vm.bc->depth + 1) * sizeof(int *));
+
+		if (vm.stack == NULL || vm.display == NULL)
+			ERROR_EXCEPT(__VM__, ERR_MEMORY);
+
+		vm.stack_end = vm.stack + capacity;
+		memcpy(vm.stack, vm.bc->image.data + main->image, main->frame * sizeof(int));
+
+		for (d = 0; d <= vm.bc->depth; d++)
+			vm.display[d] = vm.stack;
+
+#ifndef VM_THREADED
+		vm.code = vm.bc->code.data;
+#endif
+		vm_execute(&vm);
+	}
+
+	diag_pop(&frame);
+	fflush(vm.out);
+#ifdef PL_VM_PROFILE
+	vm_profile(stderr);
+#endif
+#ifdef VM_THREADED
+	free(vm.code);
+#endif
+	free(vm.stack);
+	free(vm.display);
+	free(vm.calls);
+
+	if (status != COMPILE_OK)
+		diag_raise(NULL, status);
+}
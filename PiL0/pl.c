@@ -24,26 +24,118 @@
 
 #include"global.h"
 #include<stdlib.h>
+#include<string.h>
+
+/**
+ * @brief print command line usage
+ *
+ * @param *name program name
+ * @retval void
+ */
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s [options] [source file]\n\n"
+			"Options:\n"
+			"  --stream    lex on demand while parsing\n"
+			"  --jobs=N    lex large files on N threads\n"
+			"  --no-fold   keep constant expressions and dead branches\n"
+			"  --run[=vm|ast]  run program after compiling on bytecode VM (default)\n"
+			"              or AST interpreter, READ from standard input and\n"
+			"              PRINT to standard output\n"
+			"  --list      print emitted bytecode\n"
+			"  --time-report[=json]\n"
+			"              print time, allocations and memory of every phase\n",
+			name);
+	fputs("  --trace=CATEGORY[:LEVEL],...\n"
+			"              record events of lexer, parser, ast, symtab or all,\n"
+			"              level 1 (default) or 2 for every token\n"
+			"  --trace-events=N  keep last N events (default 65536)\n"
+			"  --trace-file=FILE write events to FILE (default pil0.trace)\n"
+			"  --trace-decode=FILE  print events recorded in FILE and exit\n",
+			stderr);
+}
+
+/**
+ * @brief print binary trace file as text
+ *
+ * @param *name trace file
+ * @retval int exit status
+ */
+static int decode(const char *name) {
+	FILE *in = fopen(name, "rb");
+	int ok;
+
+	if (in == NULL) {
+		fprintf(stderr, "Couldn't open %s!\n", name);
+		return EXIT_FAILURE;
+	}
+
+	if (!(ok = trace_decode(in, stdout)))
+		fprintf(stderr, "%s is no complete trace file!\n", name);
+
+	fclose(in);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 
 int main(int argc, char *argv[]) {
 
 	FILE *raw_code;
-	int status;
+	const char *source = "../source_code.pl0";
+	struct compile_options options = { 0 };
+	enum compile_status status;
+	int i;
+
+	options.progress = stdout;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--stream") == 0)
+			options.stream = 1;
+		else if (strncmp(argv[i], "--jobs=", 7) == 0
+				&& (options.jobs = atoi(argv[i] + 7)) > 0)
+			continue;
+		else if (strcmp(argv[i], "--run") == 0
+				|| strcmp(argv[i], "--run=vm") == 0)
+			options.run = RUN_VM;
+		else if (strcmp(argv[i], "--run=ast") == 0)
+			options.run = RUN_AST;
+		else if (strcmp(argv[i], "--list") == 0)
+			options.listing = stdout;
+		else if (strcmp(argv[i], "--no-fold") == 0)
+			options.no_fold = 1;
+		else if (strcmp(argv[i], "--time-report") == 0)
+			options.time_report = REPORT_TABLE;
+		else if (strcmp(argv[i], "--time-report=json") == 0)
+			options.time_report = REPORT_JSON;
+		else if (strncmp(argv[i], "--trace=", 8) == 0
+				&& trace_options(&options, argv[i] + 8))
+			continue;
+		else if (strncmp(argv[i], "--trace-events=", 15) == 0)
+			options.trace_events = strtoul(argv[i] + 15, NULL, 10);
+		else if (strncmp(argv[i], "--trace-file=", 13) == 0)
+			options.trace_file = argv[i] + 13;
+		else if (strncmp(argv[i], "--trace-decode=", 15) == 0)
+			return decode(argv[i] + 15);
+		else if (argv[i][0] == '-' && argv[i][1] == '-') {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		} else
+			source = argv[i];
+	}
 
-	raw_code = fopen("../source_code.pl0", "r");
+	raw_code = fopen(source, "r");
 
-	if (raw_code != NULL)
-		status = compile(raw_code);
-	else {
+	if (raw_code != NULL) {
+		status = compile(raw_code, &options);
+		fclose(raw_code);
+	} else {
 		puts("Couldn't open Source Code!");
 		return EXIT_FAILURE;
 	}
 
-	if (status)
+	if (status == COMPILE_OK)
 		puts("Successful!");
 	else
 		puts("Ugh...there went something wrong!");
 
-	return EXIT_SUCCESS;
+	return (status == COMPILE_OK) ? EXIT_SUCCESS : 10;
 }
 
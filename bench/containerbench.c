@@ -0,0 +1,298 @@
+/*
+ * PiL0 - PL0 Compiler for Raspberry PI
+ * Copyright (C) 2013  Philipp Wiesner
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file containerbench.c Benchmark for meta list containers against HASHTABLE and containers.h
+ *
+ * Stores n named elements and looks every name up several times, once with
+ * push() / linst() on a STACK, the way the symbol table used to search, and
+ * once with insertHash() / getHash() on a HASHTABLE. The stack is skipped for
+ * sizes where its quadratic lookup takes too long.
+ *
+ * Then compares push / pop and search of the meta list STACK and QUEUE with
+ * the macro generated stack, vector and deque of containers.h.
+ *
+ * Build from the repository root:
+ *
+ *     gcc -ansi -pedantic -O2 -IPiL0/header bench/containerbench.c PiL0/header/meta_data_types.c PiL0/header/err_handling.c -o containerbench
+ *
+ * Usage: containerbench [max elements]
+ */
+
+#include"meta_data_types.h"
+#include"containers.h"
+#include<stdio.h>
+#include<string.h>
+#include<time.h>
+
+#define MAX_ELEMENTS 1000000
+#define MAX_STACK 32000
+#define LOOKUPS 4
+#define OPERATIONS 4000000
+#define SEARCH_SIZE 1000
+
+/**
+ * @struct NAMED
+ *
+ * @brief element stored in the containers
+ */
+struct NAMED {
+	char name[16]; /**< key */
+	int value; /**< payload */
+};
+
+#define NAMED_MATCH(element, key) (strcmp((element)->name, (key)) == 0)
+
+DEFINE_STACK(named_stack, struct NAMED)
+DEFINE_VECTOR_SEARCH(named_stack, struct NAMED, const char *, NAMED_MATCH)
+DEFINE_DEQUE(named_deque, struct NAMED)
+
+/**
+ * @brief cast stack content to element
+ *
+ * @param *obj stack content
+ * @retval void* element
+ */
+static void *named_cast(void *obj) {
+	return obj;
+}
+
+/**
+ * @brief compare name of element with name of key element
+ *
+ * @param *element element of stack
+ * @param *key element holding name looking for
+ * @retval int 0 if equal
+ */
+static int named_compare(void *element, void *key) {
+	return strcmp(((struct NAMED *) element)->name,
+			((struct NAMED *) key)->name);
+}
+
+/**
+ * @brief seconds since start
+ *
+ * @param start clock value at start
+ * @retval double
+ */
+static double elapsed(clock_t start) {
+	return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/**
+ * @brief look up elements in stack
+ *
+ * @param *elements array of elements
+ * @param n number of elements
+ * @retval double seconds for all lookups
+ */
+static double bench_stack(struct NAMED *elements, size_t n) {
+	STACK st = init_stack();
+	clock_t start = clock();
+	size_t i, r, found = 0;
+	double seconds;
+
+	for (i = 0; i < n; i++)
+		push(st, &elements[i]);
+
+	for (r = 0; r < LOOKUPS; r++)
+		for (i = 0; i < n; i++)
+			found += linst(st, &elements[(i * 7919) % n], named_cast,
+					named_compare) != NULL;
+
+	seconds = elapsed(start);
+
+	if (found != n * LOOKUPS)
+		fputs("stack lookup failed!\n", stderr);
+
+	flush_stack(st);
+	free_stack(st);
+	return seconds;
+}
+
+/**
+ * @brief look up elements in hash table
+ *
+ * @param *elements array of elements
+ * @param n number of elements
+ * @retval double seconds for all lookups
+ */
+static double bench_hash(struct NAMED *elements, size_t n) {
+	HASHTABLE hash = init_hash(0, hash_string, equal_string);
+	clock_t start = clock();
+	size_t i, r, found = 0;
+	double seconds;
+
+	for (i = 0; i < n; i++)
+		insertHash(hash, elements[i].name, &elements[i]);
+
+	for (r = 0; r < LOOKUPS; r++)
+		for (i = 0; i < n; i++)
+			found += getHash(hash, elements[(i * 7919) % n].name)
+					== &elements[(i * 7919) % n];
+
+	seconds = elapsed(start);
+
+	if (found != n * LOOKUPS)
+		fputs("hash lookup failed!\n", stderr);
+
+	free_hash(hash);
+	return seconds;
+}
+
+/**
+ * @brief print time per operation of meta list and macro container
+ *
+ * @param *what operation
+ * @param list seconds of meta list
+ * @param macro seconds of macro container
+ * @param n number of operations
+ * @retval void
+ */
+static void report(const char *what, double list, double macro, size_t n) {
+	printf("%-22s %12.1f %14.1f %10.1fx\n", what, list * 1e9 / n,
+			macro * 1e9 / n, (macro > 0) ? list / macro : 0);
+}
+
+/**
+ * @brief compare push / pop and search of meta list and macro containers
+ *
+ * @param *elements array of at least SEARCH_SIZE elements
+ * @retval void
+ */
+static void bench_containers(struct NAMED *elements) {
+	STACK st = init_stack();
+	QUEUE qu = init_queue();
+	struct named_stack vs;
+	struct named_deque dq;
+	clock_t start;
+	double list, macro;
+	size_t i, r, found = 0;
+
+	named_stack_init(&vs);
+	named_deque_init(&dq);
+
+	printf("\n%-22s %12s %14s %11s\n", "operation", "meta ns/op",
+			"macro ns/op", "speedup");
+
+	/* push and pop, meta list stores pointers, stack stores elements */
+	start = clock();
+	for (r = 0; r < OPERATIONS / SEARCH_SIZE; r++) {
+		for (i = 0; i < SEARCH_SIZE; i++)
+			push(st, &elements[i]);
+		for (i = 0; i < SEARCH_SIZE; i++)
+			found += ((struct NAMED *) pop(st))->value;
+	}
+	list = elapsed(start);
+
+	start = clock();
+	for (r = 0; r < OPERATIONS / SEARCH_SIZE; r++) {
+		for (i = 0; i < SEARCH_SIZE; i++)
+			named_stack_push(&vs, elements[i]);
+		for (i = 0; i < SEARCH_SIZE; i++)
+			found += named_stack_pop(&vs).value;
+	}
+	macro = elapsed(start);
+	report("stack push + pop", list, macro, OPERATIONS);
+
+	/* append and remove at head */
+	start = clock();
+	for (r = 0; r < OPERATIONS / SEARCH_SIZE; r++) {
+		for (i = 0; i < SEARCH_SIZE; i++)
+			append(qu, &elements[i]);
+		for (i = 0; i < SEARCH_SIZE; i++)
+			found += ((struct NAMED *) qudel(qu))->value;
+	}
+	list = elapsed(start);
+
+	start = clock();
+	for (r = 0; r < OPERATIONS / SEARCH_SIZE; r++) {
+		for (i = 0; i < SEARCH_SIZE; i++)
+			named_deque_push_back(&dq, elements[i]);
+		for (i = 0; i < SEARCH_SIZE; i++)
+			found += named_deque_pop_front(&dq).value;
+	}
+	macro = elapsed(start);
+	report("queue append + remove", list, macro, OPERATIONS);
+
+	/* search every element in a stack of SEARCH_SIZE elements */
+	for (i = 0; i < SEARCH_SIZE; i++) {
+		push(st, &elements[i]);
+		named_stack_push(&vs, elements[i]);
+	}
+
+	start = clock();
+	for (r = 0; r < LOOKUPS; r++)
+		for (i = 0; i < SEARCH_SIZE; i++)
+			found += linst(st, &elements[i], named_cast, named_compare) != NULL;
+	list = elapsed(start);
+
+	start = clock();
+	for (r = 0; r < LOOKUPS; r++)
+		for (i = 0; i < SEARCH_SIZE; i++)
+			found += named_stack_search(&vs, elements[i].name) != NULL;
+	macro = elapsed(start);
+	report("stack search", list, macro, LOOKUPS * SEARCH_SIZE);
+
+	/* keep results alive */
+	if (found == 0)
+		puts("");
+
+	flush_stack(st);
+	free_stack(st);
+	free_queue(qu);
+	named_stack_free(&vs);
+	named_deque_free(&dq);
+}
+
+int main(int argc, char *argv[]) {
+	size_t max = (argc > 1) ? (size_t) atol(argv[1]) : MAX_ELEMENTS, n, i;
+	struct NAMED *elements = NULL;
+
+	if (max < SEARCH_SIZE)
+		max = SEARCH_SIZE;
+
+	if ((elements = malloc(max * sizeof(*elements))) == NULL)
+		error("containerbench", __FILE__, __func__, __LINE__, ERR_MEMORY);
+
+	for (i = 0; i < max; i++) {
+		sprintf(elements[i].name, "id%lu", (unsigned long) i);
+		elements[i].value = (int) i;
+	}
+
+	printf("%10s %12s %14s %12s %14s\n", "elements", "stack/s", "stack ns/op",
+			"hash/s", "hash ns/op");
+
+	for (n = 1000; n <= max; n *= 4) {
+		double hash = bench_hash(elements, n);
+
+		if (n <= MAX_STACK) {
+			double stack = bench_stack(elements, n);
+			printf("%10lu %12.4f %14.1f %12.4f %14.1f\n", (unsigned long) n,
+					stack, stack * 1e9 / (n * (LOOKUPS + 1)), hash,
+					hash * 1e9 / (n * (LOOKUPS + 1)));
+		} else
+			printf("%10lu %12s %14s %12.4f %14.1f\n", (unsigned long) n, "-",
+					"-", hash, hash * 1e9 / (n * (LOOKUPS + 1)));
+	}
+
+	bench_containers(elements);
+
+	free(elements);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,309 @@
+/*
+ * PiL0 - PL0 Compiler for Raspberry PI
+ * Copyright (C) 2013  Philipp Wiesner
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file frontbench.c Throughput benchmark for lexer and parser
+ *
+ * Runs lexer and parser on a source file, or on a series of generated programs
+ * which double in size from step to step, and reports tokens and lines per
+ * second, allocations and peak resident memory after each phase, and the
+ * memory taken by the AST and the token arena. The growth column divides the time of a phase
+ * by the time of the previous step, so linear phases stay near 2 while
+ * quadratic ones approach 4.
+ *
+ * Build from the repository root:
+ *
+ *     gcc -ansi -pedantic -O2 -DPLGEN_NO_MAIN -IPiL0/header -Ibench bench/frontbench.c bench/plgen.c PiL0/header/[a-z]*.c -lpthread -o frontbench
+ *
+ * Allocations are counted if built with GNU ld and
+ *
+ *     -DBENCH_COUNT_ALLOC -Wl,--wrap=malloc,--wrap=realloc
+ *
+ * Usage: frontbench [file | vars=N consts=N depth=N statements=N operands=N seed=N] [steps=N] [jobs=N]
+ *
+ * The report is written to standard error.
+ */
+
+#if defined(__unix__) || defined(__APPLE__)
+#define _XOPEN_SOURCE 500
+#define BENCH_HAVE_RUSAGE
+#endif
+
+#include"frontend.h"
+#include"plgen.h"
+#include<time.h>
+
+#ifdef BENCH_HAVE_RUSAGE
+#include<sys/time.h>
+#include<sys/resource.h>
+#endif
+
+#define STEPS 4
+
+#ifdef BENCH_COUNT_ALLOC
+static unsigned long allocations = 0;
+
+extern void *__real_malloc(size_t);
+extern void *__real_realloc(void *, size_t);
+
+/**
+ * @brief count call and forward to malloc
+ */
+void *__wrap_malloc(size_t size) {
+	allocations++;
+	return __real_malloc(size);
+}
+
+/**
+ * @brief count call and forward to realloc
+ */
+void *__wrap_realloc(void *ptr, size_t size) {
+	allocations++;
+	return __real_realloc(ptr, size);
+}
+#endif
+
+/**
+ * @struct MEASURE
+ *
+ * @brief counters at the start of a phase
+ */
+struct MEASURE {
+	double seconds; 			/**< wall clock time */
+	unsigned long allocations; 	/**< malloc and realloc calls so far */
+};
+
+/**
+ * @brief wall clock time in seconds
+ *
+ * @retval double
+ */
+static double wall_time() {
+#ifdef BENCH_HAVE_RUSAGE
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+#else
+	return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/**
+ * @brief peak resident set size in kilobytes
+ *
+ * @retval long peak or -1 if unknown
+ */
+static long peak_rss() {
+#ifdef BENCH_HAVE_RUSAGE
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return -1;
+
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+#else
+	return -1;
+#endif
+}
+
+/**
+ * @brief start measuring a phase
+ *
+ * @param *m counters
+ * @retval void
+ */
+static void measure_start(struct MEASURE *m) {
+#ifdef BENCH_COUNT_ALLOC
+	m->allocations = allocations;
+#else
+	m->allocations = 0;
+#endif
+	m->seconds = wall_time();
+}
+
+/**
+ * @brief finish measuring a phase and print one line of the report
+ *
+ * @param *m counters from start of phase
+ * @param *phase name of phase
+ * @param tokens number of tokens of program
+ * @param lines number of lines of program
+ * @param *previous time of phase in previous step, updated, 0 if none
+ * @retval void
+ */
+static void measure_stop(const struct MEASURE *m, const char *phase,
+		size_t tokens, size_t lines, double *previous) {
+	double seconds = wall_time() - m->seconds;
+	char allocs[24] = "-", growth[16] = "-";
+
+	if (seconds <= 0)
+		seconds = 1e-9;
+
+#ifdef BENCH_COUNT_ALLOC
+	sprintf(allocs, "%lu", allocations - m->allocations);
+#endif
+
+	if (*previous > 0)
+		sprintf(growth, "%.2f", seconds / *previous);
+
+	*previous = seconds;
+
+	fprintf(stderr, "%-6s %10lu %9lu %8.3f %12.0f %11.0f %11s %9ld %6s\n", phase,
+			(unsigned long) tokens, (unsigned long) lines, seconds,
+			tokens / seconds, lines / seconds, allocs, peak_rss(), growth);
+}
+
+/**
+ * @brief read whole file into memory
+ *
+ * @param *f file
+ * @param *length returns length of file
+ * @retval char* file content
+ */
+static char *read_all(FILE *f, size_t *length) {
+	char *buf = NULL;
+	long size;
+
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	if ((buf = malloc(size + 1)) == NULL)
+		error("frontbench", __FILE__, __func__, __LINE__, ERR_MEMORY);
+
+	*length = fread(buf, 1, size, f);
+	return buf;
+}
+
+/**
+ * @brief lex and parse one program and print the report lines
+ *
+ * @param *text source text
+ * @param length length of text
+ * @param jobs number of lexer threads
+ * @param *previous times of lex and parse phase of previous step
+ * @retval void
+ */
+static void bench(const char *text, size_t length, int jobs, double *previous) {
+	struct compile_options options = { 0 };
+	SOURCECODE code = sc_init();
+	struct MEASURE m;
+	size_t tokens, lines = 1;
+	const char *p = text, *end = text + length;
+	TSPTR ts;
+
+	while ((p = memchr(p, '\n', end - p)) != NULL) {
+		lines++;
+		p++;
+	}
+
+	options.jobs = jobs;
+	sc_set_options(code, &options);
+	sc_set_text(code, text, length);
+
+	measure_start(&m);
+	lexer_parallel(code);
+	ts = sc_get_ts(code);
+	tokens = ts_count(ts);
+	measure_stop(&m, "lex", tokens, lines, &previous[0]);
+
+	measure_start(&m);
+	init_parsing(code);
+	measure_stop(&m, "parse", tokens, lines, &previous[1]);
+
+	fprintf(stderr, "ast    %lu knots in %lu bytes\n",
+			(unsigned long) ast_knots(sc_get_ast(code)),
+			(unsigned long) ast_bytes(sc_get_ast(code)));
+	fprintf(stderr, "arena  %lu chunks, %lu bytes reserved, %lu bytes used at most\n",
+			(unsigned long) arena_chunks(sc_get_token_arena(code)),
+			(unsigned long) arena_reserved(sc_get_token_arena(code)),
+			(unsigned long) arena_used(sc_get_token_arena(code)));
+
+	sc_destroy(code);
+}
+
+int main(int argc, char *argv[]) {
+	struct program_shape shape;
+	const char *source = NULL;
+	double previous[2] = { 0, 0 };
+	int steps = STEPS, jobs = 1, i;
+	size_t length;
+	char *text;
+
+	plgen_default(&shape);
+
+	for (i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "steps=", 6) == 0)
+			steps = atoi(argv[i] + 6);
+		else if (strncmp(argv[i], "jobs=", 5) == 0)
+			jobs = atoi(argv[i] + 5);
+		else if (!plgen_option(&shape, argv[i]))
+			source = argv[i];
+	}
+
+	fprintf(stderr, "%-6s %10s %9s %8s %12s %11s %11s %9s %6s\n", "phase",
+			"tokens", "lines", "time/s", "tokens/s", "lines/s", "allocations",
+			"peak KB", "growth");
+
+	if (source != NULL) {
+		FILE *f = fopen(source, "rb");
+
+		if (f == NULL) {
+			fprintf(stderr, "Couldn't open %s!\n", source);
+			return EXIT_FAILURE;
+		}
+
+		text = read_all(f, &length);
+		fclose(f);
+		fprintf(stderr, "%s: %lu bytes\n", source, (unsigned long) length);
+		bench(text, length, jobs, previous);
+		free(text);
+		return EXIT_SUCCESS;
+	}
+
+	for (i = 0; i < steps; i++) {
+		FILE *f = tmpfile();
+
+		if (f == NULL) {
+			fputs("Couldn't create temporary file!\n", stderr);
+			return EXIT_FAILURE;
+		}
+
+		plgen(f, &shape);
+		text = read_all(f, &length);
+		fclose(f);
+
+		fprintf(stderr, "vars=%lu consts=%lu depth=%lu statements=%lu "
+				"operands=%lu: %lu bytes\n", shape.vars, shape.consts,
+				shape.depth, shape.statements, shape.operands,
+				(unsigned long) length);
+		bench(text, length, jobs, previous);
+		free(text);
+
+		shape.vars *= 2;
+		shape.consts *= 2;
+		shape.statements *= 2;
+	}
+
+	return EXIT_SUCCESS;
+}
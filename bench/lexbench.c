@@ -0,0 +1,176 @@
+/*
+ * PiL0 - PL0 Compiler for Raspberry PI
+ * Copyright (C) 2013  Philipp Wiesner
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file lexbench.c Throughput benchmark for the lexical scanner
+ *
+ * Lexes a source file or a generated identifier-heavy corpus several times with
+ * every character scanner the machine supports and reports identifiers and
+ * megabytes per second.
+ *
+ * Build from the repository root:
+ *
+ *     gcc -ansi -pedantic -O2 -IPiL0/header bench/lexbench.c PiL0/header/[a-z]*.c -o lexbench
+ *
+ * Usage: lexbench [file] [repetitions]
+ */
+
+#include"frontend.h"
+#include<time.h>
+
+#define CORPUS_SIZE (8 * 1024 * 1024)
+#define REPETITIONS 10
+
+/**
+ * @brief generate corpus of mostly identifiers mixed with keywords
+ *
+ * @param *length returns length of corpus
+ * @retval char* corpus
+ */
+static char *generate_corpus(size_t *length) {
+	static const char *words[] = { "BEGIN", "END", "IF", "THEN", "WHILE",
+			"DO", "VAR", "CONST", "PROCEDURE", "CALL", "ODD", "PRINT", "READ" };
+	static const char alnum[] =
+			"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+	char *corpus = NULL;
+	size_t n = 0, column = 0;
+	unsigned long seed = 12345;
+
+	if ((corpus = malloc(CORPUS_SIZE)) == NULL)
+		error("lexbench", __FILE__, __func__, __LINE__, ERR_MEMORY);
+
+	while (n < CORPUS_SIZE - 64) {
+		seed = seed * 1103515245 + 12345;
+
+		if ((seed >> 16) % 5 == 0) {
+			const char *w = words[(seed >> 8) % (sizeof(words) / sizeof(*words))];
+
+			while (*w != '\0')
+				corpus[n++] = *w++;
+		} else {
+			size_t len = 1 + (seed >> 20) % 12, i;
+
+			corpus[n++] = alnum[(seed >> 4) % 52];
+
+			for (i = 1; i < len; i++) {
+				seed = seed * 1103515245 + 12345;
+				corpus[n++] = alnum[(seed >> 16) % 62];
+			}
+		}
+
+		if (++column == 12) {
+			corpus[n++] = '\n';
+			column = 0;
+		} else
+			corpus[n++] = ' ';
+	}
+
+	*length = n;
+	return corpus;
+}
+
+/**
+ * @brief read file into memory
+ *
+ * @param *name file name
+ * @param *length returns length of file
+ * @retval char* file content
+ */
+static char *read_file(const char *name, size_t *length) {
+	FILE *f = fopen(name, "rb");
+	char *buf = NULL;
+	long size;
+
+	if (f == NULL) {
+		fprintf(stderr, "Couldn't open %s!\n", name);
+		exit(EXIT_FAILURE);
+	}
+
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	if ((buf = malloc(size + 1)) == NULL)
+		error("lexbench", __FILE__, __func__, __LINE__, ERR_MEMORY);
+
+	*length = fread(buf, 1, size, f);
+	fclose(f);
+	return buf;
+}
+
+/**
+ * @brief lex text several times with one character scanner and print throughput
+ *
+ * @param *text source text
+ * @param length length of text
+ * @param repetitions number of runs
+ * @param isa instruction set of character scanner
+ * @retval void
+ */
+static void bench(const char *text, size_t length, int repetitions, int isa) {
+	struct compile_options options = { 0 };
+	size_t tokens = 0, identifiers = 0;
+	clock_t start, stop;
+	double seconds;
+	int r;
+
+	options.isa = isa;
+	start = clock();
+
+	for (r = 0; r < repetitions; r++) {
+		SOURCECODE code = sc_init();
+		TSPTR ts;
+
+		sc_set_options(code, &options);
+		sc_set_text(code, text, length);
+		lexer(code);
+		ts = sc_get_ts(code);
+
+		for (; getType(ts) != '\0'; next_token(ts)) {
+			tokens++;
+			identifiers += getWordID(ts) == IDENTIFIER;
+		}
+
+		sc_destroy(code);
+	}
+
+	stop = clock();
+	seconds = (double) (stop - start) / CLOCKS_PER_SEC;
+
+	printf("%-8s %10lu %12lu %8.3f %8.1f %14.0f\n", get_scanner(isa)->name,
+			(unsigned long) (tokens / repetitions),
+			(unsigned long) (identifiers / repetitions), seconds,
+			length * (double) repetitions / seconds / 1e6, identifiers / seconds);
+}
+
+int main(int argc, char *argv[]) {
+	size_t length;
+	char *text = (argc > 1) ? read_file(argv[1], &length) : generate_corpus(&length);
+	int repetitions = (argc > 2) ? atoi(argv[2]) : REPETITIONS, isa;
+
+	printf("input: %lu bytes x %d\n\n", (unsigned long) length, repetitions);
+	printf("%-8s %10s %12s %8s %8s %14s\n", "scanner", "tokens", "identifiers",
+			"time/s", "MB/s", "identifiers/s");
+
+	for (isa = SCAN_SCALAR; isa <= SCAN_NEON; isa++)
+		if (get_scanner(isa) != NULL)
+			bench(text, length, repetitions, isa);
+
+	free(text);
+	return EXIT_SUCCESS;
+}
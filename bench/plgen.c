@@ -0,0 +1,426 @@
+/*
+ * PiL0 - PL0 Compiler for Raspberry PI
+ * Copyright (C) 2013  Philipp Wiesner
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file plgen.c Synthetic PL/0 program generator
+ *
+ * Writes a valid PL/0 program of a chosen shape: many VAR / CONST declarations
+ * in the main block, a chain of nested PROCEDUREs, a long BEGIN ... END sequence
+ * and expressions with many operands. Statements refer to identifiers of
+ * every visible scope, so global names are looked up through all local ones.
+ * The same shape and seed always give the same program.
+ *
+ * Build from the repository root:
+ *
+ *     gcc -ansi -pedantic -O2 bench/plgen.c -o plgen
+ *
+ * Usage: plgen [vars=N] [consts=N] [depth=N] [statements=N] [operands=N] [seed=N]
+ *
+ * Defining PLGEN_NO_MAIN leaves out main(), so other benchmarks can link the generator.
+ */
+
+#include"plgen.h"
+#include<stdlib.h>
+#include<string.h>
+
+#define NESTED_STATEMENTS 4
+#define LOCALS 2
+#define LINE_WIDTH 72
+
+/**
+ * @struct GENERATOR
+ *
+ * @brief output and state of random choices while generating
+ */
+struct GENERATOR {
+	FILE *out; 							/**< generated program */
+	const struct program_shape *shape; 	/**< shape of program */
+	unsigned long seed; 				/**< state of random numbers */
+	size_t column; 						/**< column of current output line */
+};
+
+/**
+ * @brief next random number
+ *
+ * @param *g generator
+ * @param n number of possible values
+ * @retval unsigned long between 0 and n - 1
+ */
+static unsigned long gen_random(struct GENERATOR *g, unsigned long n) {
+	g->seed = (g->seed * 1103515245UL + 12345UL) & 0xffffffffUL;
+	return (n > 0) ? (g->seed >> 8) % n : 0;
+}
+
+/**
+ * @brief write text, break line if it gets too long
+ *
+ * @param *g generator
+ * @param *s text
+ * @retval void
+ */
+static void gen_put(struct GENERATOR *g, const char *s) {
+	size_t length = strlen(s);
+
+	if (g->column + length > LINE_WIDTH && g->column > 0) {
+		fputs("\n\t", g->out);
+		g->column = 4;
+	}
+
+	fputs(s, g->out);
+	g->column += length;
+}
+
+/**
+ * @brief end current output line
+ *
+ * @param *g generator
+ * @retval void
+ */
+static void gen_newline(struct GENERATOR *g) {
+	fputc('\n', g->out);
+	g->column = 0;
+}
+
+/**
+ * @brief write name of a variable visible at a nesting level
+ *
+ * @param *g generator
+ * @param level nesting level of the block
+ * @retval void
+ */
+static void gen_variable(struct GENERATOR *g, unsigned long level) {
+	char buf[48];
+
+	if (level == 0 || gen_random(g, 2) == 0)
+		sprintf(buf, "v%lu", gen_random(g, g->shape->vars));
+	else
+		sprintf(buf, "l%luv%lu", 1 + gen_random(g, level), gen_random(g, LOCALS));
+
+	gen_put(g, buf);
+}
+
+/**
+ * @brief write variable, constant or number
+ *
+ * @param *g generator
+ * @param level nesting level of the block
+ * @retval void
+ */
+static void gen_operand(struct GENERATOR *g, unsigned long level) {
+	char buf[32];
+	unsigned long choice = gen_random(g, 10);
+
+	if (choice < 6) {
+		gen_variable(g, level);
+		return;
+	}
+
+	if (choice < 8 && g->shape->consts > 0)
+		sprintf(buf, "c%lu", gen_random(g, g->shape->consts));
+	else
+		sprintf(buf, "%lu", 1 + gen_random(g, 99));
+
+	gen_put(g, buf);
+}
+
+/**
+ * @brief write expression with n operands
+ *
+ * Splits the operands near the middle, so parentheses nest only
+ * logarithmic deep however long the expression is.
+ *
+ * @param *g generator
+ * @param level nesting level of the block
+ * @param n number of operands
+ * @retval void
+ */
+static void gen_expression(struct GENERATOR *g, unsigned long level,
+		unsigned long n) {
+	static const char *ops[] = { " + ", " - ", " * ", " / " };
+	unsigned long k;
+	int brackets;
+
+	if (n <= 1) {
+		gen_operand(g, level);
+		return;
+	}
+
+	k = n / 2 + gen_random(g, 2) * (n % 2);
+	brackets = gen_random(g, 4) == 0;
+
+	if (brackets)
+		gen_put(g, "(");
+
+	gen_expression(g, level, k);
+
+	if (brackets)
+		gen_put(g, ")");
+
+	gen_put(g, ops[gen_random(g, 4)]);
+	gen_expression(g, level, n - k);
+}
+
+/**
+ * @brief write condition
+ *
+ * @param *g generator
+ * @param level nesting level of the block
+ * @retval void
+ */
+static void gen_condition(struct GENERATOR *g, unsigned long level) {
+	static const char *rel[] = { " > ", " < ", " == ", " != ", " >= ", " <= " };
+	unsigned long n = g->shape->operands;
+
+	if (gen_random(g, 8) == 0) {
+		gen_put(g, "ODD ");
+		gen_expression(g, level, n);
+		return;
+	}
+
+	gen_expression(g, level, (n + 1) / 2);
+	gen_put(g, rel[gen_random(g, 6)]);
+	gen_expression(g, level, n / 2 + (n < 2));
+}
+
+/**
+ * @brief write assignment
+ *
+ * @param *g generator
+ * @param level nesting level of the block
+ * @retval void
+ */
+static void gen_assignment(struct GENERATOR *g, unsigned long level) {
+	gen_variable(g, level);
+	gen_put(g, " = ");
+	gen_expression(g, level, g->shape->operands);
+}
+
+/**
+ * @brief write one statement
+ *
+ * @param *g generator
+ * @param level nesting level of the block
+ * @retval void
+ */
+static void gen_statement(struct GENERATOR *g, unsigned long level) {
+	unsigned long choice = gen_random(g, 20);
+	char buf[32];
+
+	if (choice < 10)
+		gen_assignment(g, level);
+
+	else if (choice < 13) {
+		gen_put(g, "IF ");
+		gen_condition(g, level);
+		gen_put(g, " THEN ");
+		gen_assignment(g, level);
+	}
+
+	else if (choice < 15) {
+		gen_put(g, "WHILE ");
+		gen_condition(g, level);
+		gen_put(g, " DO BEGIN ");
+		gen_assignment(g, level);
+		gen_put(g, "; ");
+		gen_assignment(g, level);
+		gen_put(g, " END");
+	}
+
+	else if (choice < 17) {
+		gen_put(g, "PRINT ");
+		gen_expression(g, level, g->shape->operands);
+	}
+
+	else if (choice < 19 && (level > 0 || g->shape->depth > 0)) {
+		/* procedure of this block or one of the enclosing procedures */
+		unsigned long callable = level + (level < g->shape->depth);
+
+		sprintf(buf, "CALL p%lu", 1 + gen_random(g, callable));
+		gen_put(g, buf);
+	}
+
+	else {
+		gen_put(g, "READ ");
+		gen_variable(g, level);
+	}
+}
+
+/**
+ * @brief write block of a nesting level and all nested procedures
+ *
+ * @param *g generator
+ * @param level nesting level, 0 is the main block
+ * @retval void
+ */
+static void gen_block(struct GENERATOR *g, unsigned long level) {
+	unsigned long i, statements;
+	char buf[64];
+
+	if (level == 0) {
+		for (i = 0; i < g->shape->vars; i++) {
+			sprintf(buf, (i == 0) ? "VAR v%lu" : ", v%lu", i);
+			gen_put(g, buf);
+		}
+
+		gen_put(g, ";");
+		gen_newline(g);
+
+		for (i = 0; i < g->shape->consts; i++) {
+			sprintf(buf, (i == 0) ? "CONST c%lu = %lu" : ", c%lu = %lu", i,
+					gen_random(g, 1000));
+			gen_put(g, buf);
+		}
+
+		if (g->shape->consts > 0) {
+			gen_put(g, ";");
+			gen_newline(g);
+		}
+
+		statements = g->shape->statements;
+	}
+
+	else {
+		for (i = 0; i < LOCALS; i++) {
+			sprintf(buf, (i == 0) ? "VAR l%luv%lu" : ", l%luv%lu", level, i);
+			gen_put(g, buf);
+		}
+
+		gen_put(g, ";");
+		gen_newline(g);
+		statements = NESTED_STATEMENTS;
+	}
+
+	if (level < g->shape->depth) {
+		sprintf(buf, "PROCEDURE p%lu;", level + 1);
+		gen_put(g, buf);
+		gen_newline(g);
+		gen_block(g, level + 1);
+		gen_put(g, ";");
+		gen_newline(g);
+	}
+
+	gen_put(g, "BEGIN");
+	gen_newline(g);
+
+	for (i = 0; i < statements; i++) {
+		gen_put(g, "\t");
+		gen_statement(g, level);
+
+		if (i + 1 < statements)
+			gen_put(g, ";");
+
+		gen_newline(g);
+	}
+
+	gen_put(g, "END");
+}
+
+/**
+ * @brief set default shape
+ *
+ * @param *shape program shape
+ * @retval void
+ */
+void plgen_default(struct program_shape *shape) {
+	shape->vars = 1000;
+	shape->consts = 100;
+	shape->depth = 16;
+	shape->statements = 10000;
+	shape->operands = 8;
+	shape->seed = 12345;
+}
+
+/**
+ * @brief set one part of shape from an argument name=value
+ *
+ * @param *shape program shape
+ * @param *arg argument
+ * @retval int 1 if argument is valid, 0 otherwise
+ */
+int plgen_option(struct program_shape *shape, const char *arg) {
+	static const char *names[] = { "vars=", "consts=", "depth=", "statements=",
+			"operands=", "seed=" };
+	unsigned long *fields[6];
+	char *end;
+	unsigned long value;
+	size_t i;
+
+	fields[0] = &shape->vars;
+	fields[1] = &shape->consts;
+	fields[2] = &shape->depth;
+	fields[3] = &shape->statements;
+	fields[4] = &shape->operands;
+	fields[5] = &shape->seed;
+
+	for (i = 0; i < 6; i++)
+		if (strncmp(arg, names[i], strlen(names[i])) == 0) {
+			value = strtoul(arg + strlen(names[i]), &end, 10);
+
+			if (*end != '\0')
+				return 0;
+
+			/* statements need a variable and expressions an operand */
+			if ((fields[i] == &shape->vars || fields[i] == &shape->operands)
+					&& value == 0)
+				value = 1;
+
+			*fields[i] = value;
+			return 1;
+		}
+
+	return 0;
+}
+
+/**
+ * @brief write program of the given shape
+ *
+ * @param *out output file
+ * @param *shape program shape
+ * @retval void
+ */
+void plgen(FILE *out, const struct program_shape *shape) {
+	struct GENERATOR g;
+
+	g.out = out;
+	g.shape = shape;
+	g.seed = shape->seed;
+	g.column = 0;
+
+	gen_block(&g, 0);
+	gen_put(&g, " .");
+	gen_newline(&g);
+}
+
+#ifndef PLGEN_NO_MAIN
+int main(int argc, char *argv[]) {
+	struct program_shape shape;
+	int i;
+
+	plgen_default(&shape);
+
+	for (i = 1; i < argc; i++)
+		if (!plgen_option(&shape, argv[i])) {
+			fprintf(stderr, "Usage: %s [vars=N] [consts=N] [depth=N] "
+					"[statements=N] [operands=N] [seed=N]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+
+	plgen(stdout, &shape);
+	return EXIT_SUCCESS;
+}
+#endif
@@ -0,0 +1,45 @@
+/*
+ * PiL0 - PL0 Compiler for Raspberry PI
+ * Copyright (C) 2013  Philipp Wiesner
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file plgen.h Header-File for the synthetic PL/0 program generator
+ */
+
+#ifndef __PLGEN_H
+#define __PLGEN_H
+#include<stdio.h>
+
+/**
+ * @struct program_shape
+ *
+ * @brief size of the parts of a generated program
+ */
+struct program_shape {
+	unsigned long vars; 		/**< VAR declarations of the main block */
+	unsigned long consts; 		/**< CONST declarations of the main block */
+	unsigned long depth; 		/**< nesting depth of PROCEDUREs */
+	unsigned long statements; 	/**< statements in BEGIN ... END of the main block */
+	unsigned long operands; 	/**< operands per expression */
+	unsigned long seed; 		/**< seed of the random choices */
+};
+
+extern void plgen_default(struct program_shape *);
+extern int plgen_option(struct program_shape *, const char *);
+extern void plgen(FILE *, const struct program_shape *);
+
+#endif
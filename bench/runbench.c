@@ -0,0 +1,208 @@
+/*
+ * PiL0 - PL0 Compiler for Raspberry PI
+ * Copyright (C) 2013  Philipp Wiesner
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file runbench.c Benchmark for running programs
+ *
+ * Compiles a program once and runs it several times with the AST interpreter
+ * and with the bytecode VM, and reports the fastest run of each engine, its
+ * speedup over the interpreter, and the memory taken by the AST and by the
+ * bytecode. Numbers are printed to the null device.
+ *
+ * Without a file, a loop calling the recursive fact procedure of
+ * source_code.pl0 for 12 down to 0 is run, READ takes the number of rounds.
+ *
+ * Build from the repository root:
+ *
+ *     gcc -ansi -pedantic -O2 -IPiL0/header bench/runbench.c PiL0/header/[a-z]*.c -lpthread -o runbench
+ *
+ * and once more with -DPL_VM_SWITCH to measure the switch instead of threaded
+ * dispatch, or with -DPL_VM_PROFILE to have every VM run print its most
+ * frequent opcode pairs.
+ *
+ * Usage: runbench [file] [input=N] [runs=N]
+ */
+
+#include"frontend.h"
+#include<time.h>
+
+#define RUNS 5
+#define INPUT 1000000
+
+#ifdef _WIN32
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
+
+/**
+ * @var char fact_loop[]
+ * @brief program run without file
+ **/
+static const char fact_loop[] = "VAR n, f, i, s;\n"
+		"PROCEDURE fact;\n"
+		"BEGIN\n"
+		"	IF n >= 1 THEN\n"
+		"	BEGIN\n"
+		"		f = n * f;\n"
+		"		n = n - 1;\n"
+		"		CALL fact\n"
+		"	END\n"
+		"END;\n"
+		"BEGIN\n"
+		"	READ i;\n"
+		"	s = 0;\n"
+		"	WHILE i > 0 DO\n"
+		"	BEGIN\n"
+		"		n = 12;\n"
+		"		f = 1;\n"
+		"		CALL fact;\n"
+		"		s = s + f;\n"
+		"		i = i - 1\n"
+		"	END;\n"
+		"	PRINT s\n"
+		"END.\n";
+
+/**
+ * @brief seconds since start
+ *
+ * @param start clock value at start
+ * @retval double
+ */
+static double elapsed(clock_t start) {
+	return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/**
+ * @brief fastest of several runs of one engine
+ *
+ * @param code compiled program
+ * @param *options options whose input is rewound before every run
+ * @param engine RUN_AST or RUN_VM
+ * @param runs number of runs
+ * @retval double seconds
+ */
+static double fastest(SOURCECODE code, struct compile_options *options,
+		const int engine, const int runs) {
+	double best = 0, seconds;
+	clock_t start;
+	int i;
+
+	for (i = 0; i < runs; i++) {
+		rewind(options->input);
+		start = clock();
+
+		if (engine == RUN_AST)
+			interpret(code);
+		else
+			vm_run(code);
+
+		seconds = elapsed(start);
+
+		if (i == 0 || seconds < best)
+			best = seconds;
+	}
+
+	return (best > 0) ? best : 1e-9;
+}
+
+/**
+ * @brief compile program and run it with both engines
+ *
+ * @param *text source text
+ * @param length length of text
+ * @param input number READ takes
+ * @param runs runs per engine
+ * @retval void
+ */
+static void bench(const char *text, size_t length, long input, int runs) {
+	struct compile_options options = { 0 };
+	SOURCECODE code = sc_init();
+	double ast, vm;
+
+	options.input = tmpfile();
+	options.output = fopen(NULL_DEVICE, "w");
+
+	if (options.input == NULL || options.output == NULL) {
+		fputs("Couldn't open input or output!\n", stderr);
+		exit(EXIT_FAILURE);
+	}
+
+	fprintf(options.input, "%ld\n", input);
+	sc_set_text(code, text, length);
+	sc_set_options(code, &options);
+	lexer(code);
+
+	init_parsing(code);
+
+	resolve(code);
+	fold(code);
+	emit_bytecode(code);
+
+	fprintf(stderr, "AST %lu bytes, bytecode %lu bytes\n",
+			(unsigned long) ast_bytes(sc_get_ast(code)),
+			(unsigned long) bc_bytes(sc_get_bc(code)));
+
+	ast = fastest(code, &options, RUN_AST, runs);
+	vm = fastest(code, &options, RUN_VM, runs);
+
+	fprintf(stderr, "%-8s %10s %8s\n", "engine", "time/s", "speedup");
+	fprintf(stderr, "%-8s %10.3f %8.1f\n", "ast", ast, 1.0);
+	fprintf(stderr, "%-8s %10.3f %8.1f\n", "vm", vm, ast / vm);
+
+	fclose(options.input);
+	fclose(options.output);
+	sc_destroy(code);
+}
+
+int main(int argc, char *argv[]) {
+	const char *text = fact_loop;
+	size_t length = sizeof(fact_loop) - 1;
+	long input = INPUT;
+	int runs = RUNS, i;
+	char *file = NULL;
+	long size;
+	FILE *f;
+
+	for (i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "input=", 6) == 0)
+			input = atol(argv[i] + 6);
+		else if (strncmp(argv[i], "runs=", 5) == 0)
+			runs = atoi(argv[i] + 5);
+		else if ((f = fopen(argv[i], "rb")) != NULL) {
+			fseek(f, 0, SEEK_END);
+			size = ftell(f);
+			fseek(f, 0, SEEK_SET);
+
+			if ((file = malloc(size + 1)) == NULL)
+				error("runbench", __FILE__, __func__, __LINE__, ERR_MEMORY);
+
+			length = fread(file, 1, size, f);
+			text = file;
+			fclose(f);
+		} else
+			fprintf(stderr, "Couldn't open %s!\n", argv[i]);
+	}
+
+	fprintf(stderr, "%lu bytes, input %ld, %d runs\n", (unsigned long) length,
+			input, runs);
+	bench(text, length, input, runs);
+
+	free(file);
+	return EXIT_SUCCESS;
+}
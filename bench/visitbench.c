@@ -0,0 +1,247 @@
+/*
+ * PiL0 - PL0 Compiler for Raspberry PI
+ * Copyright (C) 2013  Philipp Wiesner
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file visitbench.c Benchmark for walking the AST
+ *
+ * Parses a generated program and walks its AST several times: with a walker
+ * and pre / post callbacks, with a walker whose pre callback prunes every
+ * expression, and with a recursive walk over ast_child() calling the same
+ * callbacks for comparison.
+ * Reports knots visited per second and the deepest nesting seen.
+ *
+ * Build from the repository root:
+ *
+ *     gcc -ansi -pedantic -O2 -DPLGEN_NO_MAIN -IPiL0/header -Ibench bench/visitbench.c bench/plgen.c PiL0/header/[a-z]*.c -lpthread -o visitbench
+ *
+ * Usage: visitbench [vars=N consts=N depth=N statements=N operands=N seed=N] [walks=N]
+ */
+
+#include"frontend.h"
+#include"plgen.h"
+#include<time.h>
+
+#define WALKS 20
+
+/**
+ * @struct COUNT
+ *
+ * @brief counters of one walk
+ */
+struct COUNT {
+	unsigned long knots; 		/**< knots visited */
+	unsigned long depth; 		/**< deepest knot */
+	AWPTR walker; 				/**< walker, for depth */
+};
+
+/**
+ * @brief seconds since start
+ *
+ * @param start clock value at start
+ * @retval double
+ */
+static double elapsed(clock_t start) {
+	return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/**
+ * @brief pre callback, counts knot and depth
+ */
+static int count_pre(void *data, const ASTPTR ast, const int class,
+		const unsigned int ref) {
+	struct COUNT *c = data;
+
+	(void) ast;
+	(void) class;
+	(void) ref;
+
+	c->knots++;
+
+	if (c->walker != NULL && walker_depth(c->walker) > c->depth)
+		c->depth = (unsigned long) walker_depth(c->walker);
+
+	return VISIT_CONTINUE;
+}
+
+/**
+ * @brief post callback, does nothing
+ */
+static int count_post(void *data, const ASTPTR ast, const int class,
+		const unsigned int ref) {
+	(void) data;
+	(void) ast;
+	(void) class;
+	(void) ref;
+
+	return VISIT_CONTINUE;
+}
+
+/**
+ * @brief pre callback, counts knot and prunes expressions
+ */
+static int prune_pre(void *data, const ASTPTR ast, const int class,
+		const unsigned int ref) {
+	(void) ast;
+	(void) ref;
+
+	((struct COUNT *) data)->knots++;
+	return (class == AST_CLASS_EXPR) ? VISIT_PRUNE : VISIT_CONTINUE;
+}
+
+/**
+ * @brief visit knot and its branches by recursion
+ *
+ * The counterpart of walk_ast() without walker, depth is counted instead.
+ *
+ * @param ast AST
+ * @param class one of ast_classes
+ * @param ref knot
+ * @param depth depth of knot
+ * @param *v visitor, data points to counters
+ * @retval void
+ */
+static void walk_recursive(const ASTPTR ast, const int class,
+		const unsigned int ref, unsigned long depth, const AST_VISITOR *v) {
+	struct COUNT *c = v->data;
+	unsigned int child;
+	int child_class;
+	size_t i;
+
+	v->pre(v->data, ast, class, ref);
+
+	if (depth > c->depth)
+		c->depth = depth;
+
+	for (i = 0; (child_class = ast_child(ast, class, ref, i, &child)) >= 0; i++)
+		walk_recursive(ast, child_class, child, depth + 1, v);
+
+	v->post(v->data, ast, class, ref);
+}
+
+/**
+ * @brief print one line of the report
+ *
+ * @param *what kind of walk
+ * @param *c counters summed over all walks
+ * @param seconds time of all walks
+ * @retval void
+ */
+static void report(const char *what, const struct COUNT *c, double seconds) {
+	if (seconds <= 0)
+		seconds = 1e-9;
+
+	fprintf(stderr, "%-10s %12lu %8.3f %14.0f %8lu\n", what, c->knots, seconds,
+			c->knots / seconds, c->depth);
+}
+
+/**
+ * @brief parse program and walk its AST
+ *
+ * @param *text source text
+ * @param length length of text
+ * @param walks number of walks of each kind
+ * @retval void
+ */
+static void bench(const char *text, size_t length, int walks) {
+	SOURCECODE code = sc_init();
+	AWPTR w = init_walker(0);
+	struct COUNT c;
+	AST_VISITOR v;
+	ASTPTR ast;
+	clock_t start;
+	int i;
+
+	sc_set_text(code, text, length);
+	lexer(code);
+
+	init_parsing(code);
+
+	ast = sc_get_ast(code);
+	fprintf(stderr, "%lu knots\n", (unsigned long) ast_knots(ast));
+
+	c.knots = c.depth = 0;
+	c.walker = w;
+	v.pre = count_pre;
+	v.post = count_post;
+	v.data = &c;
+	start = clock();
+	for (i = 0; i < walks; i++)
+		walk_ast(w, ast, AST_CLASS_BLOCK, 0, &v);
+	report("walker", &c, elapsed(start));
+
+	c.knots = c.depth = 0;
+	v.pre = prune_pre;
+	v.post = NULL;
+	start = clock();
+	for (i = 0; i < walks; i++)
+		walk_ast(w, ast, AST_CLASS_BLOCK, 0, &v);
+	report("pruned", &c, elapsed(start));
+
+	c.knots = c.depth = 0;
+	c.walker = NULL;
+	v.pre = count_pre;
+	v.post = count_post;
+	start = clock();
+	for (i = 0; i < walks; i++)
+		walk_recursive(ast, AST_CLASS_BLOCK, 0, 0, &v);
+	report("recursive", &c, elapsed(start));
+
+	free_walker(w);
+	sc_destroy(code);
+}
+
+int main(int argc, char *argv[]) {
+	struct program_shape shape;
+	int walks = WALKS, i;
+	size_t length;
+	long size;
+	char *text;
+	FILE *f;
+
+	plgen_default(&shape);
+
+	for (i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "walks=", 6) == 0)
+			walks = atoi(argv[i] + 6);
+		else if (!plgen_option(&shape, argv[i]))
+			fprintf(stderr, "Unknown option %s!\n", argv[i]);
+	}
+
+	if ((f = tmpfile()) == NULL) {
+		fputs("Couldn't create temporary file!\n", stderr);
+		return EXIT_FAILURE;
+	}
+
+	plgen(f, &shape);
+	size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	if ((text = malloc(size + 1)) == NULL)
+		error("visitbench", __FILE__, __func__, __LINE__, ERR_MEMORY);
+
+	length = fread(text, 1, size, f);
+	fclose(f);
+
+	fprintf(stderr, "%lu bytes, %d walks\n", (unsigned long) length, walks);
+	fprintf(stderr, "%-10s %12s %8s %14s %8s\n", "walk", "knots", "time/s",
+			"knots/s", "depth");
+	bench(text, length, walks);
+
+	free(text);
+	return EXIT_SUCCESS;
+}